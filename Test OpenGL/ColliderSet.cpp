@@ -0,0 +1,298 @@
+//  ColliderSet.cpp
+// Class for a set of static colliders with analytic shapes: planes, axis-aligned boxes, spheres and capsules.
+
+#include "ColliderSet.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COLLIDERSET_X86
+#include <immintrin.h>
+#endif
+
+//Function to add the half-space below a plane
+void ColliderSet::addPlane(float nx, float ny, float nz, float offset, float restitution, float friction){
+    float length = sqrtf(nx*nx + ny*ny + nz*nz);
+    Collider c = { COLLIDER_PLANE, { nx / length, ny / length, nz / length }, { 0.0f, 0.0f, 0.0f }, offset, restitution, friction };
+    colliders.push_back(c);
+}
+
+//Function to add an axis-aligned box
+void ColliderSet::addBox(float cx, float cy, float cz, float xsize, float ysize, float zsize, float restitution, float friction){
+    Collider c = { COLLIDER_BOX, { cx, cy, cz }, { xsize, ysize, zsize }, 0.0f, restitution, friction };
+    colliders.push_back(c);
+}
+
+//Function to add a sphere
+void ColliderSet::addSphere(float cx, float cy, float cz, float radius, float restitution, float friction){
+    Collider c = { COLLIDER_SPHERE, { cx, cy, cz }, { 0.0f, 0.0f, 0.0f }, radius, restitution, friction };
+    colliders.push_back(c);
+}
+
+//Function to add a capsule
+void ColliderSet::addCapsule(float ax, float ay, float az, float bx, float by, float bz, float radius,
+                             float restitution, float friction){
+    Collider c = { COLLIDER_CAPSULE, { ax, ay, az }, { bx, by, bz }, radius, restitution, friction };
+    colliders.push_back(c);
+}
+
+
+/********************************* Collision kernels ******************************/
+
+// Every kernel computes, for each mass and collider, how deep the mass is inside the collider and the normal of
+// the nearest point of the surface. If the mass is inside and not fixed:
+//   x += n * depth
+//   vn = v.n, vt = v - vn * n
+//   if vn < 0:  v = vt * max(0, 1 - friction * (1 + restitution) * -vn / |vt|) - restitution * vn * n
+// A mass at the centre of a sphere or on the axis of a capsule is pushed upwards.
+// The operations are done in the same order in all kernels so they give the same result.
+
+//Depth and normal of a point inside a sphere around q, or a capsule with q the nearest point of its axis
+template<class T>
+static inline void roundPenetration(T radius, T dx, T dy, T dz,
+                                    T& depth, T& nx, T& ny, T& nz){
+    T length = std::sqrt(dx*dx + dy*dy + dz*dz);
+    depth = radius - length;
+    T inverse = 1 / length;
+    bool centred = !(length > 0);
+    nx = centred ? 0 : dx * inverse;
+    ny = centred ? 1 : dy * inverse;
+    nz = centred ? 0 : dz * inverse;
+}
+
+template<class T>
+static inline void penetrationScalar(const Collider& c, T x, T y, T z,
+                                     T& depth, T& nx, T& ny, T& nz){
+    switch(c.type) {
+        case COLLIDER_PLANE:
+            depth = c.radius - (c.a[0] * x + c.a[1] * y + c.a[2] * z);
+            nx = c.a[0];
+            ny = c.a[1];
+            nz = c.a[2];
+            break;
+        case COLLIDER_BOX: {
+            T qx = x - c.a[0], qy = y - c.a[1], qz = z - c.a[2];
+            T dx = c.b[0] - std::fabs(qx), dy = c.b[1] - std::fabs(qy), dz = c.b[2] - std::fabs(qz);
+            depth = std::fmin(std::fmin(dx, dy), dz);
+            bool useX = dx <= dy && dx <= dz;
+            bool useY = !useX && dy <= dz;
+            bool useZ = !useX && !useY;
+            nx = useX ? std::copysign((T)1, qx) : 0;
+            ny = useY ? std::copysign((T)1, qy) : 0;
+            nz = useZ ? std::copysign((T)1, qz) : 0;
+            break;
+        }
+        case COLLIDER_SPHERE:
+            roundPenetration<T>(c.radius, x - c.a[0], y - c.a[1], z - c.a[2], depth, nx, ny, nz);
+            break;
+        case COLLIDER_CAPSULE: {
+            T abx = c.b[0] - c.a[0], aby = c.b[1] - c.a[1], abz = c.b[2] - c.a[2];
+            T length2 = abx*abx + aby*aby + abz*abz;
+            T inverse = length2 > 0 ? 1 / length2 : 0;
+            T t = ((x - c.a[0]) * abx + (y - c.a[1]) * aby + (z - c.a[2]) * abz) * inverse;
+            t = std::fmin(std::fmax(t, (T)0), (T)1);
+            roundPenetration<T>(c.radius, x - (c.a[0] + t * abx), y - (c.a[1] + t * aby), z - (c.a[2] + t * abz),
+                             depth, nx, ny, nz);
+            break;
+        }
+        default:
+            //An unknown shape never contains a mass
+            depth = -1;
+            nx = 0;
+            ny = 1;
+            nz = 0;
+            break;
+    }
+}
+
+template<class Precision>
+static int collideScalar(const ColliderSet& set, BasicParticleSystem<Precision>& p){
+    typedef typename Precision::Scalar T;
+    int contacts = 0;
+    for(int i = 0; i < p.nParticles; i++) {
+        if(!(p.invMass[i] > 0)) {
+            continue;
+        }
+        for(size_t k = 0; k < set.colliders.size(); k++) {
+            const Collider& c = set.colliders[k];
+            T depth, nx, ny, nz;
+            penetrationScalar(c, p.x[i], p.y[i], p.z[i], depth, nx, ny, nz);
+            if(!(depth > 0)) {
+                continue;
+            }
+            contacts++;
+            p.x[i] = (T)(p.x[i] + nx * depth);
+            p.y[i] = (T)(p.y[i] + ny * depth);
+            p.z[i] = (T)(p.z[i] + nz * depth);
+            T vn = p.vx[i] * nx + p.vy[i] * ny + p.vz[i] * nz;
+            if(vn < 0) {
+                T tx = p.vx[i] - vn * nx, ty = p.vy[i] - vn * ny, tz = p.vz[i] - vn * nz;
+                T tangent = std::sqrt(tx*tx + ty*ty + tz*tz);
+                T scale = std::fmax(1 - c.friction * ((1 + c.restitution) * -vn) / std::fmax(tangent, (T)1e-20f), (T)0);
+                T bounce = -c.restitution * vn;
+                p.vx[i] = tx * scale + nx * bounce;
+                p.vy[i] = ty * scale + ny * bounce;
+                p.vz[i] = tz * scale + nz * bounce;
+            }
+        }
+    }
+    return contacts;
+}
+
+#ifdef COLLIDERSET_X86
+
+//Function to select b where the mask is set and a elsewhere
+static inline __m128 select(__m128 mask, __m128 a, __m128 b){
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+static inline void roundPenetrationSSE(__m128 radius, __m128 dx, __m128 dy, __m128 dz,
+                                       __m128& depth, __m128& nx, __m128& ny, __m128& nz){
+    const __m128 zero = _mm_setzero_ps();
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    depth = _mm_sub_ps(radius, length);
+    __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), length);
+    __m128 centred = _mm_cmpngt_ps(length, zero);
+    nx = select(centred, _mm_mul_ps(dx, inverse), zero);
+    ny = select(centred, _mm_mul_ps(dy, inverse), _mm_set1_ps(1.0f));
+    nz = select(centred, _mm_mul_ps(dz, inverse), zero);
+}
+
+static inline void penetrationSSE(const Collider& c, __m128 x, __m128 y, __m128 z,
+                                  __m128& depth, __m128& nx, __m128& ny, __m128& nz){
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_set1_ps(c.a[0]), ay = _mm_set1_ps(c.a[1]), az = _mm_set1_ps(c.a[2]);
+    switch(c.type) {
+        case COLLIDER_PLANE:
+            depth = _mm_sub_ps(_mm_set1_ps(c.radius),
+                               _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, x), _mm_mul_ps(ay, y)), _mm_mul_ps(az, z)));
+            nx = ax;
+            ny = ay;
+            nz = az;
+            break;
+        case COLLIDER_BOX: {
+            __m128 qx = _mm_sub_ps(x, ax), qy = _mm_sub_ps(y, ay), qz = _mm_sub_ps(z, az);
+            __m128 dx = _mm_sub_ps(_mm_set1_ps(c.b[0]), _mm_andnot_ps(sign, qx));
+            __m128 dy = _mm_sub_ps(_mm_set1_ps(c.b[1]), _mm_andnot_ps(sign, qy));
+            __m128 dz = _mm_sub_ps(_mm_set1_ps(c.b[2]), _mm_andnot_ps(sign, qz));
+            depth = _mm_min_ps(_mm_min_ps(dx, dy), dz);
+            __m128 useX = _mm_and_ps(_mm_cmple_ps(dx, dy), _mm_cmple_ps(dx, dz));
+            __m128 useY = _mm_andnot_ps(useX, _mm_cmple_ps(dy, dz));
+            __m128 useZ = _mm_andnot_ps(_mm_or_ps(useX, useY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+            nx = _mm_and_ps(useX, _mm_or_ps(_mm_and_ps(sign, qx), one));
+            ny = _mm_and_ps(useY, _mm_or_ps(_mm_and_ps(sign, qy), one));
+            nz = _mm_and_ps(useZ, _mm_or_ps(_mm_and_ps(sign, qz), one));
+            break;
+        }
+        case COLLIDER_SPHERE:
+            roundPenetrationSSE(_mm_set1_ps(c.radius), _mm_sub_ps(x, ax), _mm_sub_ps(y, ay), _mm_sub_ps(z, az),
+                                depth, nx, ny, nz);
+            break;
+        case COLLIDER_CAPSULE: {
+            float abx = c.b[0] - c.a[0], aby = c.b[1] - c.a[1], abz = c.b[2] - c.a[2];
+            float length2 = abx*abx + aby*aby + abz*abz;
+            float inverse = length2 > 0.0f ? 1.0f / length2 : 0.0f;
+            __m128 vabx = _mm_set1_ps(abx), vaby = _mm_set1_ps(aby), vabz = _mm_set1_ps(abz);
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, ax), vabx),
+                                                        _mm_mul_ps(_mm_sub_ps(y, ay), vaby)),
+                                             _mm_mul_ps(_mm_sub_ps(z, az), vabz)), _mm_set1_ps(inverse));
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            roundPenetrationSSE(_mm_set1_ps(c.radius),
+                                _mm_sub_ps(x, _mm_add_ps(ax, _mm_mul_ps(t, vabx))),
+                                _mm_sub_ps(y, _mm_add_ps(ay, _mm_mul_ps(t, vaby))),
+                                _mm_sub_ps(z, _mm_add_ps(az, _mm_mul_ps(t, vabz))),
+                                depth, nx, ny, nz);
+            break;
+        }
+        default:
+            //An unknown shape never contains a mass
+            depth = _mm_set1_ps(-1.0f);
+            nx = zero;
+            ny = one;
+            nz = zero;
+            break;
+    }
+}
+
+//The arrays are padded to a multiple of 8 floats, so the kernel runs over whole registers. Each block of masses
+//is loaded once, tested against all colliders and stored once
+static int collideSSE(const ColliderSet& set, ParticleSystem& p){
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 tiny = _mm_set1_ps(1e-20f);
+    int contacts = 0;
+    for(int i = 0; i < p.nParticles; i += 4) {
+        __m128 movable = _mm_cmpgt_ps(_mm_load_ps(p.invMass + i), zero);
+        if(_mm_movemask_ps(movable) == 0) {
+            continue;
+        }
+        __m128 x = _mm_load_ps(p.x + i), y = _mm_load_ps(p.y + i), z = _mm_load_ps(p.z + i);
+        __m128 vx = _mm_load_ps(p.vx + i), vy = _mm_load_ps(p.vy + i), vz = _mm_load_ps(p.vz + i);
+        for(size_t k = 0; k < set.colliders.size(); k++) {
+            const Collider& c = set.colliders[k];
+            __m128 depth, nx, ny, nz;
+            penetrationSSE(c, x, y, z, depth, nx, ny, nz);
+            __m128 inside = _mm_and_ps(movable, _mm_cmpgt_ps(depth, zero));
+            int mask = _mm_movemask_ps(inside);
+            if(mask == 0) {
+                continue;
+            }
+            contacts += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+            depth = _mm_and_ps(inside, depth);
+            x = _mm_add_ps(x, _mm_mul_ps(nx, depth));
+            y = _mm_add_ps(y, _mm_mul_ps(ny, depth));
+            z = _mm_add_ps(z, _mm_mul_ps(nz, depth));
+            __m128 vn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, nx), _mm_mul_ps(vy, ny)), _mm_mul_ps(vz, nz));
+            __m128 hit = _mm_and_ps(inside, _mm_cmplt_ps(vn, zero));
+            __m128 tx = _mm_sub_ps(vx, _mm_mul_ps(vn, nx));
+            __m128 ty = _mm_sub_ps(vy, _mm_mul_ps(vn, ny));
+            __m128 tz = _mm_sub_ps(vz, _mm_mul_ps(vn, nz));
+            __m128 tangent = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+            __m128 impulse = _mm_mul_ps(_mm_set1_ps(1.0f + c.restitution), _mm_sub_ps(zero, vn));
+            __m128 scale = _mm_max_ps(_mm_sub_ps(one, _mm_div_ps(_mm_mul_ps(_mm_set1_ps(c.friction), impulse),
+                                                                 _mm_max_ps(tangent, tiny))), zero);
+            __m128 bounce = _mm_mul_ps(_mm_set1_ps(-c.restitution), vn);
+            vx = select(hit, vx, _mm_add_ps(_mm_mul_ps(tx, scale), _mm_mul_ps(nx, bounce)));
+            vy = select(hit, vy, _mm_add_ps(_mm_mul_ps(ty, scale), _mm_mul_ps(ny, bounce)));
+            vz = select(hit, vz, _mm_add_ps(_mm_mul_ps(tz, scale), _mm_mul_ps(nz, bounce)));
+        }
+        _mm_store_ps(p.x + i, x); _mm_store_ps(p.y + i, y); _mm_store_ps(p.z + i, z);
+        _mm_store_ps(p.vx + i, vx); _mm_store_ps(p.vy + i, vy); _mm_store_ps(p.vz + i, vz);
+    }
+    return contacts;
+}
+
+#endif
+
+//Function to push the masses of a system of floats out of the colliders, with the SSE kernel unless a lower SIMD
+//level is selected
+static int collideKernel(const ColliderSet& set, ParticleSystem& p){
+#ifdef COLLIDERSET_X86
+    if(ParticleSystem::getSimdLevel() >= SIMD_SSE) {
+        return collideSSE(set, p);
+    }
+#endif
+    return collideScalar(set, p);
+}
+
+//The SSE kernel is written for floats only, the other precisions use the scalar kernel
+template<class Precision>
+static int collideKernel(const ColliderSet& set, BasicParticleSystem<Precision>& p){
+    return collideScalar(set, p);
+}
+
+//Function to push the masses out of the colliders
+template<class Precision>
+int ColliderSet::collide(BasicParticleSystem<Precision>& particles) const {
+    if(colliders.empty()) {
+        return 0;
+    }
+    return collideKernel(*this, particles);
+}
+
+//The precisions the function is compiled for
+template int ColliderSet::collide(BasicParticleSystem<FloatPrecision>&) const;
+template int ColliderSet::collide(BasicParticleSystem<DoublePrecision>&) const;
+template int ColliderSet::collide(BasicParticleSystem<MixedPrecision>&) const;
@@ -0,0 +1,57 @@
+//  ColliderSet.hpp
+// Class for a set of static colliders with analytic shapes: planes, axis-aligned boxes, spheres and capsules.
+// All masses of a body are tested against all colliders in one pass over the arrays of the particle system, four
+// masses at a time with SSE when the processor has it. A mass inside a collider is projected out to the nearest
+// point of its surface, the velocity into the surface is reflected with the restitution of the collider and the
+// velocity along the surface is reduced by Coulomb friction.
+// The SSE kernel is used for particle systems of floats, the other precisions are tested with the scalar kernel.
+
+#ifndef ColliderSet_hpp
+#define ColliderSet_hpp
+
+#include <vector>
+
+#include "ParticleSystem.hpp"
+
+//Shapes of the colliders
+enum ColliderType {
+    COLLIDER_PLANE,
+    COLLIDER_BOX,
+    COLLIDER_SPHERE,
+    COLLIDER_CAPSULE
+};
+
+struct Collider {
+    ColliderType type;
+    float a[3];             // Plane: unit normal. Box and sphere: centre. Capsule: first end of the axis
+    float b[3];             // Box: half of the size along each axis. Capsule: second end of the axis
+    float radius;           // Plane: distance from the origin along the normal. Sphere and capsule: radius
+    float restitution;      // The part of the velocity into the surface kept when a mass bounces
+    float friction;         // Coulomb friction coefficient of the surface
+};
+
+class ColliderSet {
+public:
+
+    std::vector<Collider> colliders;    // The colliders, tested in this order
+
+    //Function to add the half-space below a plane: the points p with n.p < offset. The normal is normalized
+    void addPlane(float nx, float ny, float nz, float offset, float restitution, float friction);
+
+    //Function to add an axis-aligned box given by its centre and half of its size along each axis
+    void addBox(float cx, float cy, float cz, float xsize, float ysize, float zsize, float restitution, float friction);
+
+    //Function to add a sphere
+    void addSphere(float cx, float cy, float cz, float radius, float restitution, float friction);
+
+    //Function to add a capsule: all points closer than radius to the segment between two points
+    void addCapsule(float ax, float ay, float az, float bx, float by, float bz, float radius,
+                    float restitution, float friction);
+
+    //Function to push the masses out of the colliders and change their velocities. Fixed masses are not moved.
+    //Returns the number of times a mass was found inside a collider
+    template<class Precision>
+    int collide(BasicParticleSystem<Precision>& particles) const;
+};
+
+#endif /* ColliderSet_hpp */
@@ -0,0 +1,58 @@
+//  FixedTimestep.cpp
+// Class used to advance the simulation in fixed timesteps independently of the frame rate.
+
+#include "FixedTimestep.hpp"
+
+#include <cmath>
+
+//Constructor
+FixedTimestep::FixedTimestep(double dt, int maxSubsteps){
+    this->dt = dt;
+    this->maxSubsteps = maxSubsteps;
+    accumulator = 0.0;
+    lastTime = 0.0;
+    frames = 0;
+    framesBehind = 0;
+    steps = 0;
+    droppedTime = 0.0;
+    started = false;
+}
+
+//Function to return the number of substeps to run this frame
+int FixedTimestep::beginFrame(double time){
+    if(!started) {
+        started = true;
+        lastTime = time;
+        return 0;
+    }
+
+    accumulator += time - lastTime;
+    lastTime = time;
+    frames++;
+
+    //Compared in double before the conversion, since after a long stall the number of steps does not fit in an int
+    double wholeSteps = floor(accumulator / dt);
+    if(wholeSteps > maxSubsteps) {
+        //The simulation can not keep up with real time. The time that does not fit in the budget is dropped,
+        //so the simulation slows down instead of trying to catch up in later frames
+        framesBehind++;
+        droppedTime += (wholeSteps - maxSubsteps) * dt;
+        accumulator -= (wholeSteps - maxSubsteps) * dt;
+        wholeSteps = maxSubsteps;
+    }
+    int substeps = wholeSteps > 0.0 ? (int)wholeSteps : 0;
+    accumulator -= substeps * dt;
+    steps += substeps;
+    return substeps;
+}
+
+//Function to return the interpolation factor between the previous and the current simulated state
+float FixedTimestep::alpha() const {
+    float a = (float)(accumulator / dt);
+    return a < 0.0f ? 0.0f : (a > 1.0f ? 1.0f : a);
+}
+
+//Function to return the part of the frames where the simulation fell behind real time
+double FixedTimestep::behindRatio() const {
+    return frames > 0 ? (double)framesBehind / frames : 0.0;
+}
@@ -0,0 +1,42 @@
+//  FixedTimestep.hpp
+// Class used to advance the simulation in fixed timesteps independently of the frame rate. The wall-clock time
+// of every rendered frame is added to an accumulator and as many fixed substeps are run as fit in it, up to a
+// budget of substeps per frame. The time left in the accumulator gives the factor used to interpolate the
+// rendered state between the last two simulated states.
+// The class keeps statistics of how often the simulation falls behind real time.
+
+#ifndef FixedTimestep_hpp
+#define FixedTimestep_hpp
+
+class FixedTimestep {
+public:
+
+    double dt;              // The fixed timestep of the simulation
+    int maxSubsteps;        // The largest number of substeps run in one frame
+    double accumulator;     // Wall-clock time not yet simulated
+    double lastTime;        // Wall-clock time of the previous frame
+
+    long frames;            // Number of frames
+    long framesBehind;      // Number of frames where the budget of substeps was not enough
+    long steps;             // Number of substeps run
+    double droppedTime;     // Wall-clock time that was never simulated because the budget was exceeded
+
+    //Constructor
+    FixedTimestep(double dt, int maxSubsteps);
+
+    //Function to call once per frame with the current wall-clock time, for example from glfwGetTime().
+    //Returns the number of substeps to run this frame. The first call only starts the clock and returns 0
+    int beginFrame(double time);
+
+    //Function to return the interpolation factor between the previous and the current simulated state,
+    //between 0 and 1
+    float alpha() const;
+
+    //Function to return the part of the frames where the simulation fell behind real time
+    double behindRatio() const;
+
+private:
+    bool started;           // Whether the clock has been started
+};
+
+#endif /* FixedTimestep_hpp */
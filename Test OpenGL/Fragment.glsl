@@ -1,6 +1,5 @@
 #version 330 core
 uniform float time;
-uniform mat4 M2;
 out vec4 finalcolor;
 in vec3 interpolatedColor;
 in vec3 interpolatedNormal;
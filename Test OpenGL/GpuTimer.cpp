@@ -0,0 +1,91 @@
+//  GpuTimer.cpp
+// Class that measures the GPU time of passes with GL_TIME_ELAPSED queries, read back without waiting.
+
+#include "GpuTimer.hpp"
+
+#include <cstring>
+
+//Constructor
+GpuTimer::GpuTimer(){
+    active = -1;
+    depth = 0;
+}
+
+//Destructor
+GpuTimer::~GpuTimer(){
+    clean();
+}
+
+//Function to start measuring a pass, if no other pass is measured and the next query of the pass is free
+void GpuTimer::begin(const char* name){
+    if(depth++ > 0) {
+        return;
+    }
+    size_t p = 0;
+    while(p < passes.size() && strcmp(passes[p].name, name) != 0) {
+        p++;
+    }
+    if(p == passes.size()) {
+        Pass pass;
+        pass.name = name;
+        glGenQueries(LATENCY, pass.queries);
+        for(int i = 0; i < LATENCY; i++) {
+            pass.sent[i] = 0;
+            pass.waiting[i] = false;
+        }
+        pass.next = 0;
+        passes.push_back(pass);
+    }
+    Pass& pass = passes[p];
+    if(pass.waiting[pass.next]) {
+        return;
+    }
+    pass.sent[pass.next] = Profiler::now();
+    glBeginQuery(GL_TIME_ELAPSED, pass.queries[pass.next]);
+    active = (int)p;
+}
+
+//Function to stop measuring the pass started last
+void GpuTimer::end(){
+    if(depth == 0 || --depth > 0 || active < 0) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    Pass& pass = passes[active];
+    pass.waiting[pass.next] = true;
+    pass.next = (pass.next + 1) % LATENCY;
+    active = -1;
+}
+
+//Function to add the results that have arrived to the Profiler. The queries of a pass finish in the order they
+//were sent, so the first one that has not arrived ends the search
+void GpuTimer::collect(){
+    for(size_t p = 0; p < passes.size(); p++) {
+        Pass& pass = passes[p];
+        for(int i = 0; i < LATENCY; i++) {
+            int q = (pass.next + i) % LATENCY;
+            if(!pass.waiting[q]) {
+                continue;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(pass.queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) {
+                break;
+            }
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(pass.queries[q], GL_QUERY_RESULT, &nanoseconds);
+            Profiler::recordGpu(pass.name, pass.sent[q], (int64_t)nanoseconds);
+            pass.waiting[q] = false;
+        }
+    }
+}
+
+//Function to free the queries
+void GpuTimer::clean(){
+    for(size_t p = 0; p < passes.size(); p++) {
+        glDeleteQueries(LATENCY, passes[p].queries);
+    }
+    passes.clear();
+    active = -1;
+    depth = 0;
+}
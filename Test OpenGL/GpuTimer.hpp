@@ -0,0 +1,94 @@
+//  GpuTimer.hpp
+// Class that measures how long the GPU works on the commands of a pass, such as the draw of the bodies, with
+// GL_TIME_ELAPSED queries. The result of a query is only known when the GPU has finished the pass, a frame or two
+// later, so every pass has a ring of queries. collect() reads the results that have arrived, without waiting for
+// any, and adds them to the Profiler. A pass is not measured in a frame where all its queries are still waiting.
+// Queries of the same kind can not be nested, so a pass started while another is measured is not measured.
+// Used through the macros, which are empty unless BOX3D_PROFILE is defined:
+//   PROFILE_GPU_SCOPE(timer, "name")   measures the GPU commands sent in the rest of the enclosing block
+//   PROFILE_GPU_COLLECT(timer)         reads the results that have arrived, called once per frame
+
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <stdint.h>
+
+#include "Utilities.hpp"
+#include "Profiler.hpp"
+
+class GpuTimer {
+public:
+
+    static const int LATENCY = 4;       // Queries per pass, the number of frames a result may take to arrive
+
+    //Constructor
+    GpuTimer();
+    //Destructor
+    ~GpuTimer();
+
+    //Function to start measuring a pass. The queries of a pass are created the first time it is measured
+    void begin(const char* name);
+
+    //Function to stop measuring the pass started last
+    void end();
+
+    //Function to add the results that have arrived to the Profiler
+    void collect();
+
+    //Function to free the queries
+    void clean();
+
+private:
+    //The queries of one pass
+    struct Pass {
+        const char* name;               // Name of the pass
+        GLuint queries[LATENCY];        // Ring of queries
+        int64_t sent[LATENCY];          // Profiler time when each query was started
+        bool waiting[LATENCY];          // Whether each query has a result that has not been read
+        int next;                       // The query used next
+    };
+
+    std::vector<Pass> passes;
+    int active;                         // The pass being measured, or -1
+    int depth;                          // Number of passes started and not yet ended
+
+    //Copying would share the queries, so it is not allowed
+    GpuTimer(const GpuTimer&);
+    GpuTimer& operator=(const GpuTimer&);
+};
+
+//Measures the GPU commands of the block it is declared in
+class GpuScope {
+public:
+    //Constructor, starts measuring
+    GpuScope(GpuTimer& timer, const char* name) : timer(timer) {
+        timer.begin(name);
+    }
+    //Destructor, stops measuring
+    ~GpuScope() {
+        timer.end();
+    }
+
+private:
+    GpuTimer& timer;
+
+    GpuScope(const GpuScope&);
+    GpuScope& operator=(const GpuScope&);
+};
+
+#ifdef BOX3D_PROFILE
+#define PROFILE_GPU_SCOPE(timer, name) GpuScope PROFILE_JOIN(gpuScope, __LINE__)(timer, name)
+#define PROFILE_GPU_COLLECT(timer) (timer).collect()
+#else
+#define PROFILE_GPU_SCOPE(timer, name) ((void)0)
+#define PROFILE_GPU_COLLECT(timer) ((void)0)
+#endif
+
+#endif /* GpuTimer_hpp */
@@ -0,0 +1,212 @@
+//  ImplicitEuler.cpp
+// Class used to simulate a body one step with the implicit (backward) Euler method, solved with a matrix-free
+// preconditioned conjugate gradient method.
+
+#include "ImplicitEuler.hpp"
+#include "Profiler.hpp"
+
+//Constructor
+template<class Precision>
+BasicImplicitEuler<Precision>::BasicImplicitEuler(){
+    maxIterations = 100;
+    tolerance = 1e-4f;
+    lastIterations = 0;
+    lastResidual = 0.0f;
+}
+
+//Function to simulate the masses connected by the springs one step
+template<class Precision>
+void BasicImplicitEuler<Precision>::step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt,
+                                         ThreadPool* pool){
+    PROFILE_SCOPE("implicit solve");
+    int n = particles.nParticles;
+
+    //The forces at the start of the step, including gravity
+    particles.clearForces();
+    springs.addForces(particles, pool);
+
+    assemble(particles, springs, dt);
+    solve(springs, n);
+
+    //Update the velocities with the solution, then the positions with the new velocities
+    for(int i = 0; i < n; i++) {
+        particles.vx[i] = (Scalar)(particles.vx[i] + dv[3*i]);
+        particles.vy[i] = (Scalar)(particles.vy[i] + dv[3*i+1]);
+        particles.vz[i] = (Scalar)(particles.vz[i] + dv[3*i+2]);
+        particles.x[i] = (Scalar)(particles.x[i] + particles.vx[i] * dt);
+        particles.y[i] = (Scalar)(particles.y[i] + particles.vy[i] * dt);
+        particles.z[i] = (Scalar)(particles.z[i] + particles.vz[i] * dt);
+    }
+}
+
+//Function to compute the matrix blocks of the springs and the right-hand side of the system.
+//For a spring between masses 1 and 2 with direction u, length l and rest length L, the derivative of the force
+//on mass 1 with respect to its position is -k*(a*I + (1-a)*u*u^T) with a = 1 - L/l. a is clamped to zero for
+//compressed springs, which keeps the matrix positive definite. The damper adds -c*I to the velocity derivative.
+template<class Precision>
+void BasicImplicitEuler<Precision>::assemble(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt){
+    int n = particles.nParticles;
+    int nSprings = springs.nSprings;
+
+    //Memory is only allocated the first time, or when the body has grown
+    blocks.resize(6 * nSprings);
+    mass.resize(n);
+    dv.assign(3 * n, 0);
+    r.resize(3 * n);
+    z.resize(3 * n);
+    p.resize(3 * n);
+    q.resize(3 * n);
+    diagonal.resize(3 * n);
+
+    //The mass matrix, and the right-hand side dt*f
+    for(int i = 0; i < n; i++) {
+        mass[i] = particles.invMass[i] > 0 ? 1 / particles.invMass[i] : 0;
+        r[3*i]   = dt * particles.fx[i];
+        r[3*i+1] = dt * (particles.fy[i] - mass[i] * particles.gravity);
+        r[3*i+2] = dt * particles.fz[i];
+        //Fixed masses are left out of the system, they only need a non-zero diagonal for the preconditioner
+        diagonal[3*i] = diagonal[3*i+1] = diagonal[3*i+2] = mass[i] > 0 ? mass[i] : 1;
+    }
+
+    Accumulator h2 = dt * dt;
+    for(int s = 0; s < nSprings; s++) {
+        int m1 = springs.mass1[s];
+        int m2 = springs.mass2[s];
+        Accumulator dx = (Accumulator)particles.x[m1] - particles.x[m2];
+        Accumulator dy = (Accumulator)particles.y[m1] - particles.y[m2];
+        Accumulator dz = (Accumulator)particles.z[m1] - particles.z[m2];
+        Accumulator length = sqrt(dx*dx + dy*dy + dz*dz);
+        Accumulator ux = 0, uy = 0, uz = 0;
+        Accumulator a = 1;
+        if(length > (Accumulator)1e-9f) {
+            ux = dx / length;
+            uy = dy / length;
+            uz = dz / length;
+            a = 1 - springs.springLength[s] / length;
+            a = a > 0 ? a : 0;
+        }
+        Accumulator k = springs.springConstant[s];
+        Accumulator c = springs.damperConstant[s];
+
+        //B = dt^2*k*(a*I + (1-a)*u*u^T) + dt*c*I
+        Accumulator* B = &blocks[6*s];
+        B[0] = h2 * k * (a + (1 - a) * ux * ux) + dt * c;
+        B[1] = h2 * k * (1 - a) * ux * uy;
+        B[2] = h2 * k * (1 - a) * ux * uz;
+        B[3] = h2 * k * (a + (1 - a) * uy * uy) + dt * c;
+        B[4] = h2 * k * (1 - a) * uy * uz;
+        B[5] = h2 * k * (a + (1 - a) * uz * uz) + dt * c;
+
+        diagonal[3*m1]   += B[0];
+        diagonal[3*m1+1] += B[3];
+        diagonal[3*m1+2] += B[5];
+        diagonal[3*m2]   += B[0];
+        diagonal[3*m2+1] += B[3];
+        diagonal[3*m2+2] += B[5];
+
+        //The right-hand side term dt^2*K*v, using only the stiffness part of the block
+        Accumulator wx = (Accumulator)particles.vx[m1] - particles.vx[m2];
+        Accumulator wy = (Accumulator)particles.vy[m1] - particles.vy[m2];
+        Accumulator wz = (Accumulator)particles.vz[m1] - particles.vz[m2];
+        Accumulator kx = (B[0] - dt * c) * wx + B[1] * wy + B[2] * wz;
+        Accumulator ky = B[1] * wx + (B[3] - dt * c) * wy + B[4] * wz;
+        Accumulator kz = B[2] * wx + B[4] * wy + (B[5] - dt * c) * wz;
+        r[3*m1]   -= kx;
+        r[3*m1+1] -= ky;
+        r[3*m1+2] -= kz;
+        r[3*m2]   += kx;
+        r[3*m2+1] += ky;
+        r[3*m2+2] += kz;
+    }
+}
+
+//Function to compute q = A*p, with A = M + sum of the spring blocks. Fixed masses do not move, so their
+//rows and columns are left out
+template<class Precision>
+void BasicImplicitEuler<Precision>::apply(const SpringNetwork& springs, const std::vector<Accumulator>& p,
+                                          std::vector<Accumulator>& q){
+    int n = (int)mass.size();
+    for(int i = 0; i < n; i++) {
+        q[3*i]   = mass[i] * p[3*i];
+        q[3*i+1] = mass[i] * p[3*i+1];
+        q[3*i+2] = mass[i] * p[3*i+2];
+    }
+    for(int s = 0; s < springs.nSprings; s++) {
+        int m1 = springs.mass1[s];
+        int m2 = springs.mass2[s];
+        const Accumulator* B = &blocks[6*s];
+        Accumulator wx = p[3*m1]   - p[3*m2];
+        Accumulator wy = p[3*m1+1] - p[3*m2+1];
+        Accumulator wz = p[3*m1+2] - p[3*m2+2];
+        Accumulator bx = B[0] * wx + B[1] * wy + B[2] * wz;
+        Accumulator by = B[1] * wx + B[3] * wy + B[4] * wz;
+        Accumulator bz = B[2] * wx + B[4] * wy + B[5] * wz;
+        q[3*m1]   += bx;
+        q[3*m1+1] += by;
+        q[3*m1+2] += bz;
+        q[3*m2]   -= bx;
+        q[3*m2+1] -= by;
+        q[3*m2+2] -= bz;
+    }
+    for(int i = 0; i < n; i++) {
+        if(mass[i] == 0) {
+            q[3*i] = q[3*i+1] = q[3*i+2] = 0;
+        }
+    }
+}
+
+//Function to solve A*dv = r with the preconditioned conjugate gradient method. r holds the right-hand side
+//on entry and is used for the residual
+template<class Precision>
+void BasicImplicitEuler<Precision>::solve(const SpringNetwork& springs, int n){
+    double rz = 0.0, bb = 0.0;
+    for(int i = 0; i < 3*n; i++) {
+        if(mass[i/3] == 0) {
+            r[i] = 0;
+        }
+        z[i] = r[i] / diagonal[i];
+        p[i] = z[i];
+        rz += (double)r[i] * z[i];
+        bb += (double)r[i] * r[i];
+    }
+
+    lastIterations = 0;
+    lastResidual = 0;
+    if(bb == 0.0) {
+        return;
+    }
+    double threshold = (double)tolerance * tolerance * bb;
+    double rr = bb;
+    while(lastIterations < maxIterations && rr > threshold) {
+        apply(springs, p, q);
+        double pq = 0.0;
+        for(int i = 0; i < 3*n; i++) {
+            pq += (double)p[i] * q[i];
+        }
+        if(pq <= 0.0) {
+            break;
+        }
+        Accumulator alpha = (Accumulator)(rz / pq);
+        double rzNew = 0.0;
+        rr = 0.0;
+        for(int i = 0; i < 3*n; i++) {
+            dv[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+            z[i] = r[i] / diagonal[i];
+            rzNew += (double)r[i] * z[i];
+            rr += (double)r[i] * r[i];
+        }
+        Accumulator beta = (Accumulator)(rzNew / rz);
+        rz = rzNew;
+        for(int i = 0; i < 3*n; i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+        lastIterations++;
+    }
+    lastResidual = (float)sqrt(rr / bb);
+}
+
+//The precisions the class is compiled for
+template class BasicImplicitEuler<FloatPrecision>;
+template class BasicImplicitEuler<DoublePrecision>;
+template class BasicImplicitEuler<MixedPrecision>;
@@ -0,0 +1,52 @@
+//  ImplicitEuler.hpp
+// Class used to simulate a body one step with the implicit (backward) Euler method, which stays stable for
+// stiff springs at timesteps where the explicit method explodes. Each step solves
+//     (M - dt*D - dt^2*K) dv = dt*(f + dt*K*v)
+// for the change in velocity dv, where K and D are the derivatives of the spring and damper forces with
+// respect to position and velocity. The system is solved with the conjugate gradient method, preconditioned
+// with the diagonal of the matrix. The matrix is never assembled: the 3x3 stiffness block of every spring is
+// computed once per step and applied spring by spring.
+// The class is a template on the precision of the particle system, and the system is solved in its Accumulator.
+
+#ifndef ImplicitEuler_hpp
+#define ImplicitEuler_hpp
+
+#include <vector>
+
+#include "ParticleSystem.hpp"
+#include "SpringNetwork.hpp"
+
+template<class Precision>
+class BasicImplicitEuler {
+public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    int maxIterations;      // The largest number of conjugate gradient iterations per step
+    float tolerance;        // The solve stops when the residual is this small relative to the right-hand side
+    int lastIterations;     // Number of iterations used in the last step
+    float lastResidual;     // Relative residual after the last step
+
+    //Constructor
+    BasicImplicitEuler();
+
+    //Function to simulate the masses connected by the springs one step
+    void step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt, ThreadPool* pool);
+
+private:
+    std::vector<Accumulator> blocks;            // Symmetric 3x3 block dt^2*K + dt*D of every spring, 6 values per spring
+    std::vector<Accumulator> mass;              // The weight of every mass, zero for fixed masses
+    std::vector<Accumulator> dv, r, z, p, q;    // Vectors of the solver, 3 values per mass
+    std::vector<Accumulator> diagonal;          // The diagonal of the matrix, 3 values per mass
+
+    //Function to compute the matrix blocks of the springs and the right-hand side of the system
+    void assemble(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt);
+    //Function to compute q = A*p without assembling A
+    void apply(const SpringNetwork& springs, const std::vector<Accumulator>& p, std::vector<Accumulator>& q);
+    //Function to solve the system with the preconditioned conjugate gradient method
+    void solve(const SpringNetwork& springs, int n);
+};
+
+typedef BasicImplicitEuler<FloatPrecision> ImplicitEuler;
+
+#endif /* ImplicitEuler_hpp */
@@ -0,0 +1,140 @@
+//  InstancedMesh.cpp
+// Class for drawing many deformed copies of the same triangle mesh with one draw call.
+
+#include "InstancedMesh.hpp"
+
+#include <cstring>
+
+//Constructor
+InstancedMesh::InstancedMesh(){
+    vao = 0;
+    vertexbuffer = 0;
+    indexbuffer = 0;
+    for(int i = 0; i < StreamBuffer::RING_SIZE; i++) {
+        positiontextures[i] = 0;
+    }
+    nverts = 0;
+    ntris = 0;
+    ninstances = 0;
+}
+
+//Destructor
+InstancedMesh::~InstancedMesh(){
+    clean();
+}
+
+//Function to upload the shared data of a mesh and allocate the positions and normals of n copies
+void InstancedMesh::create(const TriangleSoup& mesh, int n){
+    clean();
+    nverts = mesh.nverts;
+    ntris = mesh.ntris;
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if(nverts > 0 && (long long)6 * nverts * n > maxTexels) {
+        int fitting = maxTexels / (6 * nverts);
+        fprintf(stderr, "InstancedMesh: only %d of %d copies fit in a texture buffer\n", fitting, n);
+        n = fitting;
+    }
+    ninstances = n;
+    positions.resize((size_t)3 * nverts * ninstances);
+    normals.resize((size_t)3 * nverts * ninstances);
+    for(int b = 0; b < ninstances; b++) {
+        for(int i = 0; i < nverts; i++) {
+            for(int d = 0; d < 3; d++) {
+                positions[(size_t)3 * (b * nverts + i) + d] = mesh.vertexarray[8 * i + d];
+                normals[(size_t)3 * (b * nverts + i) + d] = mesh.vertexarray[8 * i + 3 + d];
+            }
+        }
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    //The positions and normals come from the texture buffer, so only the texture coordinates are an attribute
+    glGenBuffers(1, &vertexbuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+    glBufferData(GL_ARRAY_BUFFER, 8 * nverts * sizeof(GLfloat), mesh.vertexarray, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(2); // Texture coordinates
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+
+    glGenBuffers(1, &indexbuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexbuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * ntris * sizeof(GLuint), mesh.indexarray, GL_STATIC_DRAW);
+
+    //The index buffer is part of the VAO state, so it is unbound after the VAO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    if(positions.empty()) {
+        return;
+    }
+    positionstream.create(GL_TEXTURE_BUFFER, 2 * positions.size() * sizeof(GLfloat));
+    glGenTextures(StreamBuffer::RING_SIZE, positiontextures);
+    for(int i = 0; i < StreamBuffer::RING_SIZE; i++) {
+        glBindTexture(GL_TEXTURE_BUFFER, positiontextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, positionstream.buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+//Function to free the OpenGL objects
+void InstancedMesh::clean(){
+    if(positiontextures[0] != 0) {
+        glDeleteTextures(StreamBuffer::RING_SIZE, positiontextures);
+    }
+    positionstream.clean();
+    if(vao != 0) {
+        glDeleteBuffers(1, &indexbuffer);
+        glDeleteBuffers(1, &vertexbuffer);
+        glDeleteVertexArrays(1, &vao);
+    }
+    vao = 0;
+    vertexbuffer = 0;
+    indexbuffer = 0;
+    for(int i = 0; i < StreamBuffer::RING_SIZE; i++) {
+        positiontextures[i] = 0;
+    }
+    positions.clear();
+    normals.clear();
+    ninstances = 0;
+}
+
+//Function to return the positions of one copy
+GLfloat* InstancedMesh::instancePositions(int instance){
+    return &positions[(size_t)3 * nverts * instance];
+}
+
+//Function to return the normals of one copy
+GLfloat* InstancedMesh::instanceNormals(int instance){
+    return &normals[(size_t)3 * nverts * instance];
+}
+
+//Function to send the positions and normals of all copies to OpenGL, the normals after the positions
+void InstancedMesh::upload(){
+    if(positions.empty()) {
+        return;
+    }
+    GLfloat* data = (GLfloat*)positionstream.map();
+    if(data) {
+        memcpy(data, &positions[0], positions.size() * sizeof(GLfloat));
+        memcpy(data + positions.size(), &normals[0], normals.size() * sizeof(GLfloat));
+        positionstream.unmap();
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+//Function to draw all copies
+void InstancedMesh::render(){
+    if(ninstances == 0) {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, positiontextures[positionstream.current]);
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, 3 * ntris, GL_UNSIGNED_INT, (void*)0, ninstances);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    positionstream.fence();
+}
@@ -0,0 +1,71 @@
+//  InstancedMesh.hpp
+// Class for drawing many deformed copies of the same triangle mesh, such as the bodies of a scene, with one draw call.
+// The indices and texture coordinates are shared by all copies and uploaded once. The deformed positions of all
+// copies are packed into one large buffer, 3 floats per vertex with the copies after each other, which the vertex
+// shader reads as a texture buffer at 3 * (gl_InstanceID * VertexCount + gl_VertexID), see InstancedVertex.glsl.
+// The normals of all copies follow the positions in the same buffer, in the same order, since they change with them.
+// A frame takes one upload of the positions and one call to glDrawElementsInstanced(), however many copies there are.
+// The positions are streamed through a ring of buffers with fences, each read through its own texture buffer object.
+
+#ifndef InstancedMesh_hpp
+#define InstancedMesh_hpp
+
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "Utilities.hpp"
+#include "TriangleSoup.hpp"
+#include "StreamBuffer.hpp"
+
+class InstancedMesh {
+public:
+
+    GLuint vao;                     // Vertex array object with the shared attributes and indices
+    GLuint vertexbuffer;            // The vertices of the mesh, 8 floats per vertex, for the texture coordinates
+    GLuint indexbuffer;             // The indices of the mesh
+    StreamBuffer positionstream;    // Ring of buffers the positions and normals of all copies are streamed through
+    GLuint positiontextures[StreamBuffer::RING_SIZE]; // Texture buffer object reading each buffer of the ring
+    int nverts;                     // Number of vertices of the mesh
+    int ntris;                      // Number of triangles of the mesh
+    int ninstances;                 // Number of copies
+    std::vector<GLfloat> positions; // The positions of all copies, 3 floats per vertex
+    std::vector<GLfloat> normals;   // The normals of all copies, 3 floats per vertex
+
+    //Constructor
+    InstancedMesh();
+    //Destructor
+    ~InstancedMesh();
+
+    //Function to upload the shared data of a mesh and allocate the positions and normals of n copies, which start
+    //as those of the mesh. The number of copies is reduced if they do not fit in the largest texture buffer of the
+    //OpenGL implementation
+    void create(const TriangleSoup& mesh, int n);
+
+    //Function to free the OpenGL objects
+    void clean();
+
+    //Function to return the positions of one copy, 3 floats for each vertex of the mesh
+    GLfloat* instancePositions(int instance);
+
+    //Function to return the normals of one copy, 3 floats for each vertex of the mesh
+    GLfloat* instanceNormals(int instance);
+
+    //Function to send the positions and normals of all copies to OpenGL, through the next buffer of the ring
+    void upload();
+
+    //Function to draw all copies. The texture buffer is bound to texture unit 0, which the sampler Positions of
+    //the shader must use
+    void render();
+
+private:
+    //Copying would share the OpenGL objects, so it is not allowed
+    InstancedMesh(const InstancedMesh&);
+    InstancedMesh& operator=(const InstancedMesh&);
+};
+
+#endif /* InstancedMesh_hpp */
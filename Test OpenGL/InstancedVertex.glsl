@@ -0,0 +1,22 @@
+#version 330 core
+layout(std140) uniform Matrices { // Shared by all programs, see MatrixBlock in UniformBuffer.hpp
+    mat4 MV;
+    mat4 P;
+    mat4 M2;
+};
+uniform samplerBuffer Positions; // 3 floats per vertex, one copy of the mesh after the other, then the normals
+uniform int VertexCount;         // Number of vertices of one copy
+uniform int InstanceCount;       // Number of copies, to find the normals after the positions
+out vec2 st;
+out vec3 interpolatedNormal;
+layout(location=2) in vec2 TexCoord;
+void main() {
+    int base = 3*(gl_InstanceID*VertexCount + gl_VertexID);
+    vec3 Position = vec3(texelFetch(Positions, base).r, texelFetch(Positions, base+1).r, texelFetch(Positions, base+2).r);
+    int normalBase = base + 3*InstanceCount*VertexCount;
+    vec3 Normal = vec3(texelFetch(Positions, normalBase).r, texelFetch(Positions, normalBase+1).r, texelFetch(Positions, normalBase+2).r);
+    gl_Position = P*MV*M2*vec4(Position, 1.0); // Special , required output
+    vec3 transformedNormal = mat3(MV)*Normal;
+    interpolatedNormal = normalize(transformedNormal);
+    st = TexCoord; // Will also be interpolated across the triangle
+}
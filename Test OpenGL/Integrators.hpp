@@ -0,0 +1,166 @@
+//  Integrators.hpp
+// Integration methods used as compile-time policies of SoftBody::stepWith<Integrator>(). Each policy has a static
+// function step() that simulates the masses connected by a spring network one step, so every method compiles to
+// its own loop without any virtual function calls. step() is a template on the precision of the particle system.
+//   SymplecticEuler  v += a*dt, then x += v*dt with the new velocity. One force evaluation per step.
+//   VelocityVerlet   half a velocity step, a full position step and another half velocity step with the new
+//                    forces. One force evaluation per step, second order accurate.
+//   RungeKutta4      the classical fourth order Runge-Kutta method. Four force evaluations per step.
+
+#ifndef Integrators_hpp
+#define Integrators_hpp
+
+#include <vector>
+
+#include "ParticleSystem.hpp"
+#include "SpringNetwork.hpp"
+
+//Memory used by the integration methods between force evaluations. It is kept by the body so that it is only
+//allocated the first time a method is used. The saved state has the type of the masses, the accelerations and
+//the sums of the derivatives the Accumulator of the precision
+template<class Precision>
+struct BasicIntegratorScratch {
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    std::vector<Accumulator> ax, ay, az;    // Accelerations of the previous step, used by VelocityVerlet
+    std::vector<Scalar> x0, y0, z0;         // Positions at the start of the step, used by RungeKutta4
+    std::vector<Scalar> vx0, vy0, vz0;      // Velocities at the start of the step, used by RungeKutta4
+    std::vector<Accumulator> sx, sy, sz;    // Weighted sum of the position derivatives, used by RungeKutta4
+    std::vector<Accumulator> svx, svy, svz; // Weighted sum of the velocity derivatives, used by RungeKutta4
+    bool accelerationsValid;                // Whether ax, ay and az hold the accelerations of the current state. Every
+                                            // other method and every change of the masses outside a step clears it
+
+    BasicIntegratorScratch() : accelerationsValid(false) {}
+};
+
+typedef BasicIntegratorScratch<FloatPrecision> IntegratorScratch;
+
+//Function to compute the forces on the masses and turn them into accelerations, stored in fx, fy and fz
+template<class Precision>
+inline void computeAccelerations(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, ThreadPool* pool){
+    typedef typename Precision::Accumulator Accumulator;
+    particles.clearForces();
+    springs.addForces(particles, pool);
+    for(int i = 0; i < particles.capacity; i++) {
+        Accumulator g = particles.invMass[i] > 0 ? particles.gravity : 0;
+        particles.fx[i] = particles.fx[i] * particles.invMass[i];
+        particles.fy[i] = particles.fy[i] * particles.invMass[i] - g;
+        particles.fz[i] = particles.fz[i] * particles.invMass[i];
+    }
+}
+
+//The symplectic Euler method. This is the method the masses have always been simulated with, using the
+//SIMD kernel of the particle system
+struct SymplecticEuler {
+    static const char* name() { return "symplectic Euler"; }
+
+    template<class Precision>
+    static void step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, typename Precision::Accumulator dt,
+                     ThreadPool* pool, BasicIntegratorScratch<Precision>& s){
+        springs.simulateEuler(particles, dt, pool);
+        s.accelerationsValid = false;
+    }
+};
+
+//The velocity Verlet method, in kick-drift-kick form. The dampers use the velocity after the first half step
+struct VelocityVerlet {
+    static const char* name() { return "velocity Verlet"; }
+
+    template<class Precision>
+    static void step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, typename Precision::Accumulator dt,
+                     ThreadPool* pool, BasicIntegratorScratch<Precision>& s){
+        typedef typename Precision::Scalar Scalar;
+        typedef typename Precision::Accumulator Accumulator;
+        int n = particles.capacity;
+        if(!s.accelerationsValid || (int)s.ax.size() != n) {
+            computeAccelerations(particles, springs, pool);
+            s.ax.assign(particles.fx, particles.fx + n);
+            s.ay.assign(particles.fy, particles.fy + n);
+            s.az.assign(particles.fz, particles.fz + n);
+            s.accelerationsValid = true;
+        }
+        Accumulator halfDt = (Accumulator)0.5 * dt;
+        for(int i = 0; i < n; i++) {
+            particles.vx[i] = (Scalar)(particles.vx[i] + s.ax[i] * halfDt);
+            particles.vy[i] = (Scalar)(particles.vy[i] + s.ay[i] * halfDt);
+            particles.vz[i] = (Scalar)(particles.vz[i] + s.az[i] * halfDt);
+            particles.x[i] = (Scalar)(particles.x[i] + particles.vx[i] * dt);
+            particles.y[i] = (Scalar)(particles.y[i] + particles.vy[i] * dt);
+            particles.z[i] = (Scalar)(particles.z[i] + particles.vz[i] * dt);
+        }
+        computeAccelerations(particles, springs, pool);
+        for(int i = 0; i < n; i++) {
+            s.ax[i] = particles.fx[i];
+            s.ay[i] = particles.fy[i];
+            s.az[i] = particles.fz[i];
+            particles.vx[i] = (Scalar)(particles.vx[i] + s.ax[i] * halfDt);
+            particles.vy[i] = (Scalar)(particles.vy[i] + s.ay[i] * halfDt);
+            particles.vz[i] = (Scalar)(particles.vz[i] + s.az[i] * halfDt);
+        }
+    }
+};
+
+//The classical fourth order Runge-Kutta method
+struct RungeKutta4 {
+    static const char* name() { return "Runge-Kutta 4"; }
+
+    template<class Precision>
+    static void step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, typename Precision::Accumulator dt,
+                     ThreadPool* pool, BasicIntegratorScratch<Precision>& s){
+        typedef typename Precision::Scalar Scalar;
+        typedef typename Precision::Accumulator Accumulator;
+        int n = particles.capacity;
+        s.accelerationsValid = false;
+        s.x0.assign(particles.x, particles.x + n);
+        s.y0.assign(particles.y, particles.y + n);
+        s.z0.assign(particles.z, particles.z + n);
+        s.vx0.assign(particles.vx, particles.vx + n);
+        s.vy0.assign(particles.vy, particles.vy + n);
+        s.vz0.assign(particles.vz, particles.vz + n);
+        s.sx.assign(n, 0);
+        s.sy.assign(n, 0);
+        s.sz.assign(n, 0);
+        s.svx.assign(n, 0);
+        s.svy.assign(n, 0);
+        s.svz.assign(n, 0);
+
+        const Accumulator weight[4] = { 1, 2, 2, 1 };       // Weights of the four derivatives
+        const Accumulator offset[3] = { 0.5, 0.5, 1 };      // Where the next derivative is evaluated
+        for(int k = 0; k < 4; k++) {
+            //The derivative of the state at the current evaluation point: the velocity and the acceleration
+            computeAccelerations(particles, springs, pool);
+            for(int i = 0; i < n; i++) {
+                s.sx[i] += weight[k] * particles.vx[i];
+                s.sy[i] += weight[k] * particles.vy[i];
+                s.sz[i] += weight[k] * particles.vz[i];
+                s.svx[i] += weight[k] * particles.fx[i];
+                s.svy[i] += weight[k] * particles.fy[i];
+                s.svz[i] += weight[k] * particles.fz[i];
+            }
+            if(k < 3) {
+                Accumulator h = offset[k] * dt;
+                for(int i = 0; i < n; i++) {
+                    Scalar vx = particles.vx[i], vy = particles.vy[i], vz = particles.vz[i];
+                    particles.x[i] = (Scalar)(s.x0[i] + h * vx);
+                    particles.y[i] = (Scalar)(s.y0[i] + h * vy);
+                    particles.z[i] = (Scalar)(s.z0[i] + h * vz);
+                    particles.vx[i] = (Scalar)(s.vx0[i] + h * particles.fx[i]);
+                    particles.vy[i] = (Scalar)(s.vy0[i] + h * particles.fy[i]);
+                    particles.vz[i] = (Scalar)(s.vz0[i] + h * particles.fz[i]);
+                }
+            }
+        }
+        Accumulator h = dt / 6;
+        for(int i = 0; i < n; i++) {
+            particles.x[i] = (Scalar)(s.x0[i] + h * s.sx[i]);
+            particles.y[i] = (Scalar)(s.y0[i] + h * s.sy[i]);
+            particles.z[i] = (Scalar)(s.z0[i] + h * s.sz[i]);
+            particles.vx[i] = (Scalar)(s.vx0[i] + h * s.svx[i]);
+            particles.vy[i] = (Scalar)(s.vy0[i] + h * s.svy[i]);
+            particles.vz[i] = (Scalar)(s.vz0[i] + h * s.svz[i]);
+        }
+    }
+};
+
+#endif /* Integrators_hpp */
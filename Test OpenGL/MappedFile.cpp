@@ -0,0 +1,97 @@
+//  MappedFile.cpp
+// Class that gives access to the contents of a file, memory-mapped where possible.
+
+#include "MappedFile.hpp"
+
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Constructor
+MappedFile::MappedFile(){
+    data = NULL;
+    size = 0;
+    mapped = false;
+    empty[0] = 0;
+}
+
+//Destructor
+MappedFile::~MappedFile(){
+    close();
+}
+
+//Function to open a file and map it into memory
+bool MappedFile::open(const char* filename, bool copyOnWrite, FileAccess access){
+    close();
+#ifndef _WIN32
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size = (size_t)info.st_size;
+    if(size == 0) {
+        //An empty file can not be mapped, but it is still a valid file
+        ::close(fd);
+        data = empty;
+        return true;
+    }
+    //With MAP_PRIVATE, written pages are copied and the file is left unchanged
+    int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* memory = mmap(NULL, size, protection, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(memory == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    int advice = access == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : (access == ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL);
+    madvise(memory, size, advice);
+    data = (char*)memory;
+    mapped = true;
+    return true;
+#else
+    FILE* file = fopen(filename, "rb");
+    if(file == NULL) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(length < 0) {
+        fclose(file);
+        return false;
+    }
+    (void)copyOnWrite;
+    (void)access;
+    char* buffer = new char[length > 0 ? length : 1];
+    size = fread(buffer, 1, (size_t)length, file);
+    fclose(file);
+    data = buffer;
+    return true;
+#endif
+}
+
+//Function to close the file
+void MappedFile::close(){
+#ifndef _WIN32
+    if(mapped) {
+        munmap((void*)data, size);
+    }
+#else
+    if(data != empty) {
+        delete[] data;
+    }
+#endif
+    data = NULL;
+    size = 0;
+    mapped = false;
+}
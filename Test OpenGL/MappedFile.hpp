@@ -0,0 +1,45 @@
+//  MappedFile.hpp
+// Class that gives access to the contents of a file. On POSIX systems the file is memory-mapped, so nothing is
+// copied and pages are only read from disk when they are used. On other systems the file is read into memory
+// with fread(). A file opened copy-on-write may be written to in memory; the changes never reach the file.
+
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <cstddef>
+
+//How the contents of a mapped file are read, passed to the system so it reads ahead or keeps pages accordingly
+enum FileAccess {
+    ACCESS_SEQUENTIAL,      // Read once from start to end, such as a file that is parsed. Pages behind may be dropped
+    ACCESS_NORMAL,          // Read in any order and more than once, such as a file kept mapped while it is used
+    ACCESS_RANDOM           // Small reads in any order, without reading ahead
+};
+
+class MappedFile {
+public:
+
+    char* data;             // The contents of the file, NULL if no file is open. Only writable if copy-on-write
+    size_t size;            // Size of the file in bytes
+
+    //Constructor
+    MappedFile();
+    //Destructor, closes the file
+    ~MappedFile();
+
+    //Function to open a file, read-only or copy-on-write, that is read as access tells. Returns false if the file
+    //could not be opened
+    bool open(const char* filename, bool copyOnWrite = false, FileAccess access = ACCESS_SEQUENTIAL);
+
+    //Function to close the file and release the memory
+    void close();
+
+private:
+    bool mapped;            // Whether data is a memory mapping, or memory allocated with new[]
+    char empty[1];          // What data points to for an empty file
+
+    //Copying a mapped file is not allowed
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif /* MappedFile_hpp */
@@ -1,10 +1,13 @@
 //  Mass.cpp
 // This class creates a mass with a weight, position and velocity.
+// Forces acting on the mass are accumulated in force before the mass is simulated one step.
+// The functions are compiled for the precisions of Precision.hpp at the end of the file.
 
 #include "Mass.hpp"
 
 //Constructor
-Mass::Mass(float weight){
+template<class Precision>
+BasicMass<Precision>::BasicMass(Scalar weight){
     this->weight = weight;
     this->velocity.x = 0;
     this->velocity.y = 0;
@@ -12,40 +15,74 @@ Mass::Mass(float weight){
 }
 
 //Function used to set starting position of mass
-void Mass::setStartPos(float x, float y, float z){
+template<class Precision>
+void BasicMass<Precision>::setStartPos(Scalar x, Scalar y, Scalar z){
     this->position.x = x;
     this->position.y = y;
     this->position.z = z;
     
 }
 //Function used to set velocity of the mass
-void Mass::setVelocity(float vel_x, float vel_y, float vel_z){
+template<class Precision>
+void BasicMass<Precision>::setVelocity(Scalar vel_x, Scalar vel_y, Scalar vel_z){
     this->velocity.x = vel_x;
     this->velocity.y = vel_y;
     this->velocity.z = vel_z;
 }
 //Function used to set velocity in the x-direction of the mass
-void Mass::setVelocityX(float vel_x){
+template<class Precision>
+void BasicMass<Precision>::setVelocityX(Scalar vel_x){
     this->velocity.x = vel_x;
 }
 //Function used to set velocity in the y-direction of the mass
-void Mass::setVelocityY(float vel_y){
+template<class Precision>
+void BasicMass<Precision>::setVelocityY(Scalar vel_y){
     this->velocity.y = vel_y;
 }
 //Function used to set velocity in the z-direction of the mass
-void Mass::setVelocityZ(float vel_z){
+template<class Precision>
+void BasicMass<Precision>::setVelocityZ(Scalar vel_z){
     this->velocity.z = vel_z;
 }
 //Function used to add to the velocity in the x-direction of the mass
-void Mass::addVelocityX(float vel_x){
+template<class Precision>
+void BasicMass<Precision>::addVelocityX(Scalar vel_x){
     this->velocity.x += vel_x;
 }
 //Function used to add to the velocity in the y-direction of the mass
-void Mass::addVelocityY(float vel_y){
+template<class Precision>
+void BasicMass<Precision>::addVelocityY(Scalar vel_y){
     this->velocity.y += vel_y;
 }
 //Function used to add to the velocity in the z-direction of the mass
-void Mass::addVelocityZ(float vel_z){
+template<class Precision>
+void BasicMass<Precision>::addVelocityZ(Scalar vel_z){
     this->velocity.z += vel_z;
 }
+//Function used to reset the accumulated force before a new step
+template<class Precision>
+void BasicMass<Precision>::clearForce(){
+    this->force.x = 0;
+    this->force.y = 0;
+    this->force.z = 0;
+}
+//Function used to add a force acting on the mass
+template<class Precision>
+void BasicMass<Precision>::addForce(Accumulator f_x, Accumulator f_y, Accumulator f_z){
+    this->force.x += f_x;
+    this->force.y += f_y;
+    this->force.z += f_z;
+}
+//Function used to simulate the position and velocity of the mass one step using the Euler method.
+//Gravity is added to the y-component, once per mass and step
+template<class Precision>
+void BasicMass<Precision>::simulateEuler(Scalar dt){
+    const BasicVector<Accumulator> gravity(0, Precision::gravity(), 0);
+    this->velocity += dt * (force / weight - gravity);
+    this->position += dt * velocity;
+}
 
+//The precisions the class is compiled for
+template class BasicMass<FloatPrecision>;
+template class BasicMass<DoublePrecision>;
+template class BasicMass<MixedPrecision>;
@@ -1,41 +1,58 @@
 //  Mass.hpp
 // This class creates a mass with a weight, position and velocity.
+// Forces acting on the mass are accumulated in force before the mass is simulated one step.
+// The class is a template on the precision, see Precision.hpp: BasicMass<DoublePrecision> is a mass simulated in
+// double, and Mass is the mass of floats. The functions are compiled once for each precision in Mass.cpp.
 
 #ifndef Mass_hpp
 #define Mass_hpp
 
 
 #include "Vector.hpp"
-#include "TriangleSoup.hpp"
+#include "Precision.hpp"
 
-
-class Mass {
+template<class Precision>
+class BasicMass {
 public:
-    float weight;           // The weight
-    Vector position;		// Position in space
-    Vector velocity;        // Velocity
+    typedef typename Precision::Scalar Scalar;              // Type of the weight, position and velocity
+    typedef typename Precision::Accumulator Accumulator;    // Type the forces are summed in
+
+    Scalar weight;                      // The weight
+    BasicVector<Scalar> position;       // Position in space
+    BasicVector<Scalar> velocity;       // Velocity
+    BasicVector<Accumulator> force;     // Sum of the forces acting on the mass during the current step
     
     //Constructor
-    Mass(float m);
+    BasicMass(Scalar m);
     
     //Function used to set starting position of mass
-    void setStartPos(float x, float y, float z);
+    void setStartPos(Scalar x, Scalar y, Scalar z);
     //Function used to set velocity of the mass
-    void setVelocity(float vel_x, float vel_y, float vel_z);
+    void setVelocity(Scalar vel_x, Scalar vel_y, Scalar vel_z);
     //Function used to set velocity in the x-direction of the mass
-    void setVelocityX(float vel_x);
+    void setVelocityX(Scalar vel_x);
     //Function used to set velocity in the y-direction of the mass
-    void setVelocityY(float vel_y);
+    void setVelocityY(Scalar vel_y);
     //Function used to set velocity in the z-direction of the mass
-    void setVelocityZ(float vel_z);
+    void setVelocityZ(Scalar vel_z);
     //Function used to add to the velocity in the x-direction of the mass
-    void addVelocityX(float vel_x);
+    void addVelocityX(Scalar vel_x);
     //Function used to add to the velocity in the y-direction of the mass
-    void addVelocityY(float vel_y);
+    void addVelocityY(Scalar vel_y);
     //Function used to add to the velocity in the z-direction of the mass
-    void addVelocityZ(float vel_z);
+    void addVelocityZ(Scalar vel_z);
+    
+    //Function used to reset the accumulated force before a new step
+    void clearForce();
+    //Function used to add a force acting on the mass
+    void addForce(Accumulator f_x, Accumulator f_y, Accumulator f_z);
+    //Function used to simulate the position and velocity of the mass one step using the Euler method
+    void simulateEuler(Scalar dt);
     
 };
 
+//The mass of the simulation, stored and simulated in float
+typedef BasicMass<FloatPrecision> Mass;
+
 
 #endif /* Mass_hpp */
@@ -0,0 +1,115 @@
+//  Mat4.cpp
+// Class for 4x4 matrices of transforms, with the products computed with SSE.
+
+#include "Mat4.hpp"
+#include "ParticleSystem.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MAT4_X86
+#include <immintrin.h>
+#endif
+
+//Function to return a rotation around the x-axis
+Mat4 Mat4::rotationX(float angle){
+    float c = cosf(angle), s = sinf(angle);
+    return Mat4(1.0f, 0.0f, 0.0f, 0.0f,  0.0f, c, s, 0.0f,  0.0f, -s, c, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+//Function to return a rotation around the y-axis
+Mat4 Mat4::rotationY(float angle){
+    float c = cosf(angle), s = sinf(angle);
+    return Mat4(c, 0.0f, -s, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  s, 0.0f, c, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+//Function to return a rotation around the z-axis
+Mat4 Mat4::rotationZ(float angle){
+    float c = cosf(angle), s = sinf(angle);
+    return Mat4(c, s, 0.0f, 0.0f,  -s, c, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+//Function to return a perspective projection
+Mat4 Mat4::perspective(float vfov, float aspect, float znear, float zfar){
+    float f = cosf(vfov / 2) / sinf(vfov / 2);
+    float A = -(zfar + znear) / (zfar - znear);
+    float B = -(2 * zfar * znear) / (zfar - znear);
+    return Mat4(f / aspect, 0.0f, 0.0f, 0.0f,  0.0f, f, 0.0f, 0.0f,  0.0f, 0.0f, A, -1.0f,  0.0f, 0.0f, B, 0.0f);
+}
+
+//Function to return a scaling, rotation and translation in one matrix. The columns of the rotation
+//Rz * Ry * Rx are written out and scaled
+Mat4 Mat4::trs(float tx, float ty, float tz, float rx, float ry, float rz, float sx, float sy, float sz){
+    float cx = cosf(rx), snx = sinf(rx);
+    float cy = cosf(ry), sny = sinf(ry);
+    float cz = cosf(rz), snz = sinf(rz);
+    return Mat4(cy * cz * sx, cy * snz * sx, -sny * sx, 0.0f,
+                (cz * sny * snx - snz * cx) * sy, (snz * sny * snx + cz * cx) * sy, cy * snx * sy, 0.0f,
+                (cz * sny * cx + snz * snx) * sz, (snz * sny * cx - cz * snx) * sz, cy * cx * sz, 0.0f,
+                tx, ty, tz, 1.0f);
+}
+
+//Function to multiply two matrices one element at a time
+static inline void multiplyScalar(const float* a, const float* b, float* out){
+    float result[16];
+    for(int column = 0; column < 4; column++) {
+        for(int row = 0; row < 4; row++) {
+            result[4*column + row] = a[row] * b[4*column] + a[4 + row] * b[4*column + 1]
+                                   + a[8 + row] * b[4*column + 2] + a[12 + row] * b[4*column + 3];
+        }
+    }
+    for(int i = 0; i < 16; i++) {
+        out[i] = result[i];
+    }
+}
+
+#ifdef MAT4_X86
+
+//Function to multiply a matrix, given by its columns, by another with SSE: every column of the product is the
+//columns of a weighted by the elements of the same column of b. The sums are in the same order as in the scalar
+//version, so the results are the same
+static inline void multiplySSE(__m128 a0, __m128 a1, __m128 a2, __m128 a3, const float* b, float* out){
+    __m128 columns[4];
+    for(int column = 0; column < 4; column++) {
+        const float* bc = b + 4 * column;
+        __m128 sum = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(bc[0])), _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        columns[column] = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+    }
+    _mm_store_ps(out, columns[0]);
+    _mm_store_ps(out + 4, columns[1]);
+    _mm_store_ps(out + 8, columns[2]);
+    _mm_store_ps(out + 12, columns[3]);
+}
+
+#endif
+
+//Function to multiply two matrices, with SSE unless a lower SIMD level is selected
+Mat4 operator*(const Mat4& a, const Mat4& b){
+    Mat4 product;
+#ifdef MAT4_X86
+    if(ParticleSystem::getSimdLevel() >= SIMD_SSE) {
+        multiplySSE(_mm_load_ps(a.m), _mm_load_ps(a.m + 4), _mm_load_ps(a.m + 8), _mm_load_ps(a.m + 12),
+                    b.m, product.m);
+        return product;
+    }
+#endif
+    multiplyScalar(a.m, b.m, product.m);
+    return product;
+}
+
+//Function to multiply many matrices by the same one. The columns of a stay in registers for all of them
+void Mat4::transform(const Mat4& a, const Mat4* in, Mat4* out, int n){
+#ifdef MAT4_X86
+    if(ParticleSystem::getSimdLevel() >= SIMD_SSE) {
+        __m128 a0 = _mm_load_ps(a.m), a1 = _mm_load_ps(a.m + 4), a2 = _mm_load_ps(a.m + 8), a3 = _mm_load_ps(a.m + 12);
+        for(int i = 0; i < n; i++) {
+            multiplySSE(a0, a1, a2, a3, in[i].m, out[i].m);
+        }
+        return;
+    }
+#endif
+    for(int i = 0; i < n; i++) {
+        multiplyScalar(a.m, in[i].m, out[i].m);
+    }
+}
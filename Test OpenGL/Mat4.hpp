@@ -0,0 +1,63 @@
+//  Mat4.hpp
+// Class for 4x4 matrices of transforms, stored column by column as OpenGL expects, so a Mat4 can be handed directly
+// to glUniformMatrix4fv() or copied into a uniform block. The matrix is aligned to 16 bytes, so each column is one
+// SSE register, and the products are computed with SSE when the processor has it. Transforms with constant
+// arguments, such as identity(), translation() and scaling(), are constexpr and can be computed by the compiler.
+
+#ifndef Mat4_hpp
+#define Mat4_hpp
+
+class alignas(16) Mat4 {
+public:
+
+    float m[16];            // The elements, column by column: m[4*column + row]
+
+    //Constructor for the identity matrix
+    constexpr Mat4() : m{1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f} {}
+
+    //Constructor from the four columns
+    constexpr Mat4(float m0, float m1, float m2, float m3, float m4, float m5, float m6, float m7,
+                   float m8, float m9, float m10, float m11, float m12, float m13, float m14, float m15)
+        : m{m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14, m15} {}
+
+    //Functions to return constant transforms
+    static constexpr Mat4 identity() {
+        return Mat4();
+    }
+    static constexpr Mat4 translation(float x, float y, float z) {
+        return Mat4(1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  x, y, z, 1.0f);
+    }
+    static constexpr Mat4 scaling(float x, float y, float z) {
+        return Mat4(x, 0.0f, 0.0f, 0.0f,  0.0f, y, 0.0f, 0.0f,  0.0f, 0.0f, z, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    static constexpr Mat4 scaling(float s) {
+        return scaling(s, s, s);
+    }
+
+    //Functions to return rotations by an angle in radians around the x-, y- and z-axis
+    static Mat4 rotationX(float angle);
+    static Mat4 rotationY(float angle);
+    static Mat4 rotationZ(float angle);
+
+    //Function to return a perspective projection. vfov is the vertical field of view in radians, aspect the
+    //width divided by the height of the viewport, and znear and zfar the distances to the clip planes
+    static Mat4 perspective(float vfov, float aspect, float znear, float zfar);
+
+    //Function to return translation(t) * rotationZ(rz) * rotationY(ry) * rotationX(rx) * scaling(s), the model
+    //matrix of an object scaled, rotated and then moved, built directly instead of with four products
+    static Mat4 trs(float tx, float ty, float tz, float rx, float ry, float rz, float sx, float sy, float sz);
+
+    //Function to return the pointer to the elements, for OpenGL
+    const float* data() const {
+        return m;
+    }
+
+    //Function to compute out[i] = a * in[i] for n matrices, for example the model matrices of many bodies
+    //under the same camera. out may be the same array as in
+    static void transform(const Mat4& a, const Mat4* in, Mat4* out, int n);
+};
+
+//Function to multiply two matrices: the transform b followed by a
+Mat4 operator*(const Mat4& a, const Mat4& b);
+
+#endif /* Mat4_hpp */
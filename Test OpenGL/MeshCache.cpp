@@ -0,0 +1,402 @@
+//  MeshCache.cpp
+// Class for the binary .b3dmesh cache of a mesh loaded from an OBJ file.
+
+#include "MeshCache.hpp"
+#include "ObjLoader.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+// Every section starts at a multiple of this many bytes
+static const uint64_t SECTION_ALIGNMENT = 64;
+// Written in the byte order of the machine, so a file from a machine with another byte order is rejected
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const char MAGIC[8] = { 'B', '3', 'D', 'M', 'E', 'S', 'H', 0 };
+
+//The header at the start of a cache file
+struct MeshCacheHeader {
+    char magic[8];              // "B3DMESH" followed by a zero
+    uint32_t version;           // MeshCache::VERSION
+    uint32_t byteOrder;         // BYTE_ORDER_MARK
+    uint64_t sourceHash;        // FNV-1a hash of the source file
+    uint64_t sourceSize;        // Size of the source file in bytes
+    uint64_t springHash;        // Hash of the options the springs were generated with
+    uint32_t nVertices;         // Number of vertices
+    uint32_t nTriangles;        // Number of triangles
+    uint32_t nSprings;          // Number of springs, zero if there is no spring section
+    uint32_t nColours;          // Number of colours of the springs
+    uint32_t nMasses;           // Number of masses, zero if the vertices are not mapped to masses
+    uint32_t reserved;          // Always zero
+    uint64_t vertexOffset;      // Start of the vertex section
+    uint64_t indexOffset;       // Start of the index section
+    uint64_t springOffset;      // Start of the spring section, zero if there is none
+    uint64_t fileSize;          // Size of the whole file
+};
+
+//Where the sections of a file start
+struct MeshCacheLayout {
+    uint64_t vertices, indices, springs;
+    uint64_t mass1, mass2, springConstant, springLength, springMax, springMin, damperConstant, colourStart, vertexMass;
+    uint64_t end;
+};
+
+//Function to round an offset up to the start of the next section
+static uint64_t alignSection(uint64_t offset){
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+//Function to compute the layout of a file with the given contents
+static MeshCacheLayout computeLayout(uint64_t nVertices, uint64_t nTriangles, uint64_t nSprings, uint64_t nColours, uint64_t nMasses){
+    MeshCacheLayout layout;
+    layout.vertices = alignSection(sizeof(MeshCacheHeader));
+    layout.indices = alignSection(layout.vertices + 8 * nVertices * sizeof(float));
+    uint64_t offset = alignSection(layout.indices + 3 * nTriangles * sizeof(unsigned));
+    layout.springs = nSprings > 0 ? offset : 0;
+    layout.mass1 = offset;
+    layout.mass2 = alignSection(layout.mass1 + nSprings * sizeof(int));
+    layout.springConstant = alignSection(layout.mass2 + nSprings * sizeof(int));
+    layout.springLength = alignSection(layout.springConstant + nSprings * sizeof(float));
+    layout.springMax = alignSection(layout.springLength + nSprings * sizeof(float));
+    layout.springMin = alignSection(layout.springMax + nSprings * sizeof(float));
+    layout.damperConstant = alignSection(layout.springMin + nSprings * sizeof(float));
+    layout.colourStart = alignSection(layout.damperConstant + nSprings * sizeof(float));
+    layout.vertexMass = alignSection(layout.colourStart + (nColours + 1) * sizeof(int));
+    layout.end = layout.vertexMass + (nMasses > 0 ? nVertices * sizeof(int) : 0);
+    if(nSprings == 0) {
+        layout.end = offset;
+    }
+    return layout;
+}
+
+//Function to check that every index in a file refers to a vertex or mass that exists, so a damaged file is
+//rejected instead of read out of bounds. The colours must split the springs into consecutive ranges
+static bool validIndices(const char* data, const MeshCacheHeader& header, const MeshCacheLayout& layout){
+    const unsigned* indices = (const unsigned*)(data + layout.indices);
+    for(uint64_t i = 0; i < 3 * (uint64_t)header.nTriangles; i++) {
+        if(indices[i] >= header.nVertices) {
+            return false;
+        }
+    }
+    if(header.nSprings == 0) {
+        return true;
+    }
+    //Without a vertex to mass map every vertex is its own mass
+    uint32_t nMasses = header.nMasses > 0 ? header.nMasses : header.nVertices;
+    const int* mass1 = (const int*)(data + layout.mass1);
+    const int* mass2 = (const int*)(data + layout.mass2);
+    for(uint32_t i = 0; i < header.nSprings; i++) {
+        if(mass1[i] < 0 || (uint32_t)mass1[i] >= nMasses || mass2[i] < 0 || (uint32_t)mass2[i] >= nMasses) {
+            return false;
+        }
+    }
+    const int* colourStart = (const int*)(data + layout.colourStart);
+    if(colourStart[0] != 0 || (uint32_t)colourStart[header.nColours] != header.nSprings) {
+        return false;
+    }
+    for(uint32_t c = 0; c < header.nColours; c++) {
+        if(colourStart[c + 1] < colourStart[c]) {
+            return false;
+        }
+    }
+    if(header.nMasses > 0) {
+        const int* vertexMass = (const int*)(data + layout.vertexMass);
+        for(uint32_t i = 0; i < header.nVertices; i++) {
+            if(vertexMass[i] < 0 || (uint32_t)vertexMass[i] >= header.nMasses) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Constructor
+MeshCache::MeshCache(){
+    vertices = NULL;
+    indices = NULL;
+    nVertices = 0;
+    nTriangles = 0;
+    nSprings = 0;
+    nMasses = 0;
+    springData = NULL;
+    nColours = 0;
+    springHash = 0;
+    sourceHash = 0;
+    sourceSize = 0;
+}
+
+//Function to open a cache file and check that it belongs to the source file
+bool MeshCache::open(const char* filename, uint64_t sourceHash, uint64_t sourceSize){
+    close();
+    //The vertices and indices stay mapped while the mesh is used
+    if(!file.open(filename, true, ACCESS_NORMAL)) {
+        return false;
+    }
+    MeshCacheHeader header;
+    if(file.size < sizeof(header)) {
+        close();
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    MeshCacheLayout layout = computeLayout(header.nVertices, header.nTriangles, header.nSprings, header.nColours, header.nMasses);
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.byteOrder != BYTE_ORDER_MARK
+       || header.sourceHash != sourceHash || header.sourceSize != sourceSize
+       || header.vertexOffset != layout.vertices || header.indexOffset != layout.indices
+       || header.springOffset != layout.springs || header.fileSize != layout.end || file.size != layout.end
+       || !validIndices(file.data, header, layout)) {
+        close();
+        return false;
+    }
+
+    vertices = (float*)(file.data + header.vertexOffset);
+    indices = (unsigned*)(file.data + header.indexOffset);
+    nVertices = (int)header.nVertices;
+    nTriangles = (int)header.nTriangles;
+    nSprings = (int)header.nSprings;
+    nColours = (int)header.nColours;
+    nMasses = (int)header.nMasses;
+    springData = header.nSprings > 0 ? file.data : NULL;
+    springHash = header.springHash;
+    this->sourceHash = sourceHash;
+    this->sourceSize = sourceSize;
+    this->filename = filename;
+    return true;
+}
+
+//Function to load an OBJ file through its cache
+bool MeshCache::load(const char* objFilename, ThreadPool* pool){
+    close();
+    MappedFile source;
+    if(!source.open(objFilename)) {
+        error = std::string("could not open ") + objFilename;
+        return false;
+    }
+    uint64_t hash = MeshCache::hash(source.data, source.size);
+    std::string cacheName = cacheFilename(objFilename);
+    if(open(cacheName.c_str(), hash, source.size)) {
+        return true;
+    }
+
+    ObjLoader loader;
+    if(!loader.parse(source.data, source.size, pool)) {
+        error = loader.error;
+        return false;
+    }
+    if(write(cacheName.c_str(), hash, source.size, loader.vertices.data(), loader.nVertices,
+             loader.indices.data(), loader.nTriangles) && open(cacheName.c_str(), hash, source.size)) {
+        return true;
+    }
+
+    //The cache could not be written, for example because the directory is read-only
+    ownedVertices.swap(loader.vertices);
+    ownedIndices.swap(loader.indices);
+    vertices = ownedVertices.data();
+    indices = ownedIndices.data();
+    nVertices = loader.nVertices;
+    nTriangles = loader.nTriangles;
+    return true;
+}
+
+//Function to close the cache file
+void MeshCache::close(){
+    file.close();
+    springFile.close();
+    vertices = NULL;
+    indices = NULL;
+    nVertices = 0;
+    nTriangles = 0;
+    nSprings = 0;
+    nMasses = 0;
+    springData = NULL;
+    nColours = 0;
+    springHash = 0;
+    sourceHash = 0;
+    sourceSize = 0;
+    filename.clear();
+    error.clear();
+    std::vector<float>().swap(ownedVertices);
+    std::vector<unsigned>().swap(ownedIndices);
+}
+
+//Function to copy the springs of the cache to a spring network. The springs are stored already coloured, so
+//they do not have to be coloured again. Without a map, every vertex is its own mass
+bool MeshCache::loadSprings(SpringNetwork& springs, int* vertexMass, uint64_t springHash) const {
+    if(springData == NULL || springHash != this->springHash) {
+        return false;
+    }
+    MeshCacheLayout layout = computeLayout(nVertices, nTriangles, nSprings, nColours, nMasses);
+    const int* mass1 = (const int*)(springData + layout.mass1);
+    const int* mass2 = (const int*)(springData + layout.mass2);
+    const float* springConstant = (const float*)(springData + layout.springConstant);
+    const float* springLength = (const float*)(springData + layout.springLength);
+    const float* springMax = (const float*)(springData + layout.springMax);
+    const float* springMin = (const float*)(springData + layout.springMin);
+    const float* damperConstant = (const float*)(springData + layout.damperConstant);
+    const int* colourStart = (const int*)(springData + layout.colourStart);
+
+    springs.clean();
+    springs.nSprings = nSprings;
+    springs.mass1.assign(mass1, mass1 + nSprings);
+    springs.mass2.assign(mass2, mass2 + nSprings);
+    springs.springConstant.assign(springConstant, springConstant + nSprings);
+    springs.springLength.assign(springLength, springLength + nSprings);
+    springs.springMax.assign(springMax, springMax + nSprings);
+    springs.springMin.assign(springMin, springMin + nSprings);
+    springs.damperConstant.assign(damperConstant, damperConstant + nSprings);
+    springs.nColours = nColours;
+    springs.colourStart.assign(colourStart, colourStart + nColours + 1);
+
+    if(vertexMass != NULL) {
+        if(nMasses > 0) {
+            memcpy(vertexMass, springData + layout.vertexMass, nVertices * sizeof(int));
+        }
+        else {
+            for(int i = 0; i < nVertices; i++) {
+                vertexMass[i] = i;
+            }
+        }
+    }
+    return true;
+}
+
+//Function to add springs to the cache file. The vertices and indices are copied from a new read-only mapping of
+//the file, since the arrays of this object may have been written to. The vertices and indices stay in the mapping
+//they were opened in, which the arrays of the caller may point to, and only the springs are taken from the new file
+bool MeshCache::saveSprings(const SpringNetwork& springs, const int* vertexMass, int nMasses, uint64_t springHash){
+    if(filename.empty()) {
+        return false;
+    }
+    MappedFile original;
+    if(!original.open(filename.c_str())) {
+        return false;
+    }
+    const float* originalVertices = (const float*)(original.data + ((const char*)vertices - file.data));
+    const unsigned* originalIndices = (const unsigned*)(original.data + ((const char*)indices - file.data));
+    if(original.size != file.size
+       || !write(filename.c_str(), sourceHash, sourceSize, originalVertices, nVertices, originalIndices, nTriangles,
+                 &springs, vertexMass, nMasses, springHash)) {
+        return false;
+    }
+    original.close();
+
+    //The layout of the vertices and indices does not depend on the springs, so the spring sections of the new file
+    //are found from its start like those of a file that was opened
+    springData = NULL;
+    this->nSprings = 0;
+    MeshCacheLayout layout = computeLayout(nVertices, nTriangles, springs.nSprings, springs.nColours, nMasses);
+    if(!springFile.open(filename.c_str(), false, ACCESS_NORMAL) || springFile.size != layout.end) {
+        springFile.close();
+        return true;
+    }
+    springData = springs.nSprings > 0 ? springFile.data : NULL;
+    this->nSprings = springs.nSprings;
+    this->nColours = springs.nColours;
+    this->nMasses = nMasses;
+    this->springHash = springHash;
+    return true;
+}
+
+//Function to write a section at its offset, padding the file with zeros up to it
+static bool writeSection(FILE* file, uint64_t& position, uint64_t offset, const void* data, size_t size){
+    static const char zeros[SECTION_ALIGNMENT] = { 0 };
+    while(position < offset) {
+        size_t padding = (size_t)(offset - position < SECTION_ALIGNMENT ? offset - position : SECTION_ALIGNMENT);
+        if(fwrite(zeros, 1, padding, file) != padding) {
+            return false;
+        }
+        position += padding;
+    }
+    if(size > 0 && fwrite(data, 1, size, file) != size) {
+        return false;
+    }
+    position += size;
+    return true;
+}
+
+//Function to write a cache file
+bool MeshCache::write(const char* filename, uint64_t sourceHash, uint64_t sourceSize,
+                      const float* vertices, int nVertices, const unsigned* indices, int nTriangles,
+                      const SpringNetwork* springs, const int* vertexMass, int nMasses, uint64_t springHash){
+    int nSprings = springs != NULL ? springs->nSprings : 0;
+    int nColours = springs != NULL ? springs->nColours : 0;
+    if(nSprings > 0 && nColours == 0) {
+        //The springs are stored coloured
+        return false;
+    }
+    if(vertexMass == NULL) {
+        nMasses = 0;
+    }
+    MeshCacheLayout layout = computeLayout(nVertices, nTriangles, nSprings, nColours, nMasses);
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.springHash = nSprings > 0 ? springHash : 0;
+    header.nVertices = nVertices;
+    header.nTriangles = nTriangles;
+    header.nSprings = nSprings;
+    header.nColours = nColours;
+    header.nMasses = nMasses;
+    header.vertexOffset = layout.vertices;
+    header.indexOffset = layout.indices;
+    header.springOffset = layout.springs;
+    header.fileSize = layout.end;
+
+    std::string temporary = std::string(filename) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if(file == NULL) {
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = writeSection(file, position, 0, &header, sizeof(header))
+           && writeSection(file, position, layout.vertices, vertices, 8 * (size_t)nVertices * sizeof(float))
+           && writeSection(file, position, layout.indices, indices, 3 * (size_t)nTriangles * sizeof(unsigned));
+    if(ok && nSprings > 0) {
+        ok = writeSection(file, position, layout.mass1, &springs->mass1[0], nSprings * sizeof(int))
+          && writeSection(file, position, layout.mass2, &springs->mass2[0], nSprings * sizeof(int))
+          && writeSection(file, position, layout.springConstant, &springs->springConstant[0], nSprings * sizeof(float))
+          && writeSection(file, position, layout.springLength, &springs->springLength[0], nSprings * sizeof(float))
+          && writeSection(file, position, layout.springMax, &springs->springMax[0], nSprings * sizeof(float))
+          && writeSection(file, position, layout.springMin, &springs->springMin[0], nSprings * sizeof(float))
+          && writeSection(file, position, layout.damperConstant, &springs->damperConstant[0], nSprings * sizeof(float))
+          && writeSection(file, position, layout.colourStart, &springs->colourStart[0], (nColours + 1) * sizeof(int))
+          && writeSection(file, position, layout.vertexMass, vertexMass, nMasses > 0 ? nVertices * sizeof(int) : 0);
+    }
+    ok = writeSection(file, position, layout.end, NULL, 0) && ok;
+    ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    //rename() does not replace an existing file on Windows
+    if(ok) {
+        remove(filename);
+    }
+#endif
+    if(!ok || rename(temporary.c_str(), filename) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+//Function to return the 64-bit FNV-1a hash of the source file
+uint64_t MeshCache::hash(const char* data, size_t size){
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+//Function to return the name of the cache of a source file
+std::string MeshCache::cacheFilename(const char* sourceFilename){
+    std::string name(sourceFilename);
+    size_t dot = name.find_last_of('.');
+    size_t slash = name.find_last_of("/\\");
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        name.erase(dot);
+    }
+    return name + ".b3dmesh";
+}
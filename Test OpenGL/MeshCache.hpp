@@ -0,0 +1,98 @@
+//  MeshCache.hpp
+// Class for the binary .b3dmesh cache of a mesh loaded from an OBJ file. The file holds the vertex and index arrays
+// in the layout of TriangleSoup, and optionally the springs derived from the mesh, so the OBJ only has to be parsed
+// once. The cache is opened with a copy-on-write memory mapping: the arrays are used where they lie in the file
+// and can be handed directly to glBufferData(), and writing to them never changes the file.
+// A cache is only valid for the OBJ file it was made from. It stores the size and the 64-bit FNV-1a hash of the
+// source file, and a version number that is increased whenever the layout changes. The springs are only valid for
+// the options they were generated with, so they are stored with a hash of the options.
+//
+// Layout, all numbers in the byte order of the machine that wrote the file:
+//   header                 MeshCacheHeader, see MeshCache.cpp
+//   vertices               8 floats per vertex: x y z nx ny nz s t
+//   indices                3 unsigned per triangle
+//   springs (optional)     mass1, mass2, springConstant, springLength, springMax, springMin and damperConstant of
+//                          every spring, then colourStart of the spring network, then the mass of every vertex
+// Every section starts at a multiple of 64 bytes from the start of the file.
+
+#ifndef MeshCache_hpp
+#define MeshCache_hpp
+
+#include <string>
+#include <stdint.h>
+
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "SpringNetwork.hpp"
+#include "ThreadPool.hpp"
+
+class MeshCache {
+public:
+
+    static const uint32_t VERSION = 2;  // Version of the layout
+
+    float* vertices;                    // 8 floats per vertex, pointing into the mapped file
+    unsigned* indices;                  // 3 vertex indices per triangle, pointing into the mapped file
+    int nVertices;                      // Number of vertices
+    int nTriangles;                     // Number of triangles
+    int nSprings;                       // Number of springs, zero if the cache holds no springs
+    int nMasses;                        // Number of masses the vertices are mapped to
+    std::string error;                  // Description of the error if load() failed
+
+    //Constructor
+    MeshCache();
+
+    //Function to open a cache file. Returns false if it does not exist, is damaged, was written with another
+    //version or byte order, or was not made from a source file with the given hash and size
+    bool open(const char* filename, uint64_t sourceHash, uint64_t sourceSize);
+
+    //Function to load an OBJ file through its cache. The cache is opened if it was made from the file, otherwise
+    //the file is parsed, on the threads of pool if it is given, and the cache is written and opened. If the cache
+    //can not be written, the arrays point to memory owned by this object instead. Returns false if the OBJ file
+    //could not be loaded
+    bool load(const char* objFilename, ThreadPool* pool = NULL);
+
+    //Function to close the cache file
+    void close();
+
+    //Function to copy the springs of the cache to a spring network, and the mass of every vertex to vertexMass
+    //if it is not NULL. Returns false if the cache holds no springs generated with options of the given hash
+    bool loadSprings(SpringNetwork& springs, int* vertexMass, uint64_t springHash) const;
+
+    //Function to add springs, and the mass of every vertex, to the cache file opened by load(). The vertices and
+    //indices are written as they are in the file, even if they have been changed in memory. The new springs are
+    //mapped, so loadSprings() finds them without opening the cache again
+    bool saveSprings(const SpringNetwork& springs, const int* vertexMass, int nMasses, uint64_t springHash);
+
+    //Function to write a cache file. The springs and the mass of every vertex are optional. The file is written
+    //under a temporary name and then renamed, so a cache that is open elsewhere stays valid
+    static bool write(const char* filename, uint64_t sourceHash, uint64_t sourceSize,
+                      const float* vertices, int nVertices, const unsigned* indices, int nTriangles,
+                      const SpringNetwork* springs = NULL, const int* vertexMass = NULL, int nMasses = 0,
+                      uint64_t springHash = 0);
+
+    //Function to return the 64-bit FNV-1a hash of the source file
+    static uint64_t hash(const char* data, size_t size);
+
+    //Function to return the name of the cache of a source file: the extension is replaced by .b3dmesh
+    static std::string cacheFilename(const char* sourceFilename);
+
+private:
+    MappedFile file;                    // The mapped cache file
+    MappedFile springFile;              // The cache file written by saveSprings(), mapped for its springs
+    const char* springData;             // The mapped file if it has a spring section, NULL otherwise
+    int nColours;                       // Number of colours of the springs
+    uint64_t springHash;                // Hash of the options the springs were generated with
+    uint64_t sourceHash;                // Hash of the source file
+    uint64_t sourceSize;                // Size of the source file
+    std::string filename;               // Name of the cache file, empty if it could not be written
+    std::vector<float> ownedVertices;   // The vertices if the cache could not be written
+    std::vector<unsigned> ownedIndices; // The indices if the cache could not be written
+
+    //Copying a cache is not allowed
+    MeshCache(const MeshCache&);
+    MeshCache& operator=(const MeshCache&);
+};
+
+#endif /* MeshCache_hpp */
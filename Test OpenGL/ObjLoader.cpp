@@ -0,0 +1,501 @@
+//  ObjLoader.cpp
+// Class that loads the geometry of a Wavefront OBJ file into the interleaved vertex layout of TriangleSoup.
+
+#include "ObjLoader.hpp"
+#include "MappedFile.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+
+// Flags marking the indices of a corner that were negative (relative to the end of the list) in the file
+static const unsigned char RELATIVE_POSITION = 1;
+static const unsigned char RELATIVE_TEXCOORD = 2;
+static const unsigned char RELATIVE_NORMAL = 4;
+
+// Exact powers of ten used by the float scanner
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//The lines of the file parsed by one thread, and everything parsed from them. The indices of the corners are
+//zero-based; relative indices are stored relative to the lists of this chunk and fixed when the chunks are merged
+struct ObjLoader::Chunk {
+    const char* begin;                  // First character of the range
+    const char* end;                    // One past the last character of the range
+    std::vector<float> positions;       // 3 floats per position
+    std::vector<float> texcoords;       // 2 floats per texture coordinate
+    std::vector<float> normals;         // 3 floats per normal
+    std::vector<int> corners;           // Position, texture coordinate and normal of every triangle corner, -1 if missing
+    std::vector<unsigned char> relative;// RELATIVE_* flags of every triangle corner
+    std::vector<int> polygon;           // Corners of the face being parsed
+    std::vector<unsigned char> polygonRelative;
+    const char* errorAt;                // Where parsing failed, NULL if it did not
+    const char* errorMessage;           // Why parsing failed
+};
+
+//Function to skip spaces and tabs
+static inline const char* skipSpaces(const char* p, const char* end){
+    while(p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+//Function to check if a character ends a number
+static inline bool isSeparator(const char* p, const char* end){
+    return p >= end || *p == ' ' || *p == '\t' || *p == '\r' || *p == '/';
+}
+
+//Function to scan a decimal floating point number, with optional sign, fraction and exponent. Up to 18
+//significant digits are kept, which is far more than a float can hold
+static bool scanFloat(const char*& p, const char* end, float& value){
+    p = skipSpaces(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    bool digits = false;
+    while(p < end && *p >= '0' && *p <= '9') {
+        if(mantissa < 100000000000000000ULL) {
+            mantissa = 10 * mantissa + (*p - '0');
+        }
+        else {
+            exponent++;
+        }
+        digits = true;
+        p++;
+    }
+    if(p < end && *p == '.') {
+        p++;
+        while(p < end && *p >= '0' && *p <= '9') {
+            if(mantissa < 100000000000000000ULL) {
+                mantissa = 10 * mantissa + (*p - '0');
+                exponent--;
+            }
+            digits = true;
+            p++;
+        }
+    }
+    if(!digits) {
+        return false;
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        if(p >= end || *p < '0' || *p > '9') {
+            return false;
+        }
+        int e = 0;
+        while(p < end && *p >= '0' && *p <= '9') {
+            if(e < 10000) {
+                e = 10 * e + (*p - '0');
+            }
+            p++;
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+    if(!isSeparator(p, end)) {
+        return false;
+    }
+
+    double v = (double)mantissa;
+    if(exponent < 0) {
+        v = -exponent <= 22 ? v / POWERS_OF_TEN[-exponent] : v * pow(10.0, exponent);
+    }
+    else if(exponent > 0) {
+        v = exponent <= 22 ? v * POWERS_OF_TEN[exponent] : v * pow(10.0, exponent);
+    }
+    value = (float)(negative ? -v : v);
+    return true;
+}
+
+//Function to scan a decimal integer with optional sign
+static bool scanInt(const char*& p, const char* end, int& value){
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if(p >= end || *p < '0' || *p > '9') {
+        return false;
+    }
+    long long v = 0;
+    while(p < end && *p >= '0' && *p <= '9') {
+        if(v < 0x7fffffff) {
+            v = 10 * v + (*p - '0');
+        }
+        p++;
+    }
+    if(v > 0x7fffffff) {
+        return false;
+    }
+    value = (int)(negative ? -v : v);
+    return true;
+}
+
+//Function to scan a vertex index of a face. An index is one-based, or negative to count from the end of the
+//list parsed so far. It is stored zero-based, and a negative index is stored relative to the chunk
+static bool scanIndex(const char*& p, const char* end, int count, unsigned char flag, int& index, unsigned char& relative){
+    int value;
+    if(!scanInt(p, end, value) || value == 0) {
+        return false;
+    }
+    if(value > 0) {
+        index = value - 1;
+    }
+    else {
+        index = count + value;
+        relative |= flag;
+    }
+    return true;
+}
+
+//Function to parse one line. Returns false and sets the error of the chunk if the line is not valid
+static bool parseLine(const char* p, const char* end, std::vector<float>& positions, std::vector<float>& texcoords,
+                      std::vector<float>& normals, std::vector<int>& corners, std::vector<unsigned char>& relative,
+                      std::vector<int>& polygon, std::vector<unsigned char>& polygonRelative, const char*& errorMessage){
+    p = skipSpaces(p, end);
+    if(p >= end || (*p != 'v' && *p != 'f')) {
+        return true;
+    }
+
+    if(*p == 'v') {
+        p++;
+        if(p < end && (*p == ' ' || *p == '\t')) {
+            float x, y, z;
+            if(!scanFloat(p, end, x) || !scanFloat(p, end, y) || !scanFloat(p, end, z)) {
+                errorMessage = "invalid vertex position";
+                return false;
+            }
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+        }
+        else if(p + 1 < end && *p == 'n' && (p[1] == ' ' || p[1] == '\t')) {
+            p++;
+            float x, y, z;
+            if(!scanFloat(p, end, x) || !scanFloat(p, end, y) || !scanFloat(p, end, z)) {
+                errorMessage = "invalid vertex normal";
+                return false;
+            }
+            normals.push_back(x);
+            normals.push_back(y);
+            normals.push_back(z);
+        }
+        else if(p + 1 < end && *p == 't' && (p[1] == ' ' || p[1] == '\t')) {
+            p++;
+            float s, t = 0.0f;
+            if(!scanFloat(p, end, s)) {
+                errorMessage = "invalid texture coordinate";
+                return false;
+            }
+            //The second coordinate is optional
+            const char* q = skipSpaces(p, end);
+            if(q < end && *q != '\r' && !scanFloat(p, end, t)) {
+                errorMessage = "invalid texture coordinate";
+                return false;
+            }
+            texcoords.push_back(s);
+            texcoords.push_back(t);
+        }
+        return true;
+    }
+
+    //A face: a list of corners v, v/t, v//n or v/t/n
+    p++;
+    if(p < end && *p != ' ' && *p != '\t') {
+        return true;
+    }
+    int nPositions = (int)positions.size() / 3;
+    int nTexcoords = (int)texcoords.size() / 2;
+    int nNormals = (int)normals.size() / 3;
+    polygon.clear();
+    polygonRelative.clear();
+    while(true) {
+        p = skipSpaces(p, end);
+        if(p >= end || *p == '\r' || *p == '#') {
+            break;
+        }
+        int v, t = -1, n = -1;
+        unsigned char flags = 0;
+        if(!scanIndex(p, end, nPositions, RELATIVE_POSITION, v, flags)) {
+            errorMessage = "invalid face";
+            return false;
+        }
+        if(p < end && *p == '/') {
+            p++;
+            if(p < end && *p != '/' && !scanIndex(p, end, nTexcoords, RELATIVE_TEXCOORD, t, flags)) {
+                errorMessage = "invalid face";
+                return false;
+            }
+            if(p < end && *p == '/') {
+                p++;
+                if(!scanIndex(p, end, nNormals, RELATIVE_NORMAL, n, flags)) {
+                    errorMessage = "invalid face";
+                    return false;
+                }
+            }
+        }
+        if(!isSeparator(p, end) || (p < end && *p == '/')) {
+            errorMessage = "invalid face";
+            return false;
+        }
+        polygon.push_back(v);
+        polygon.push_back(t);
+        polygon.push_back(n);
+        polygonRelative.push_back(flags);
+    }
+    int nCorners = (int)polygonRelative.size();
+    if(nCorners < 3) {
+        errorMessage = "face with fewer than three corners";
+        return false;
+    }
+    //Split the face into a fan of triangles around the first corner
+    for(int i = 1; i + 1 < nCorners; i++) {
+        int triangle[3] = { 0, i, i + 1 };
+        for(int j = 0; j < 3; j++) {
+            corners.insert(corners.end(), &polygon[3*triangle[j]], &polygon[3*triangle[j]] + 3);
+            relative.push_back(polygonRelative[triangle[j]]);
+        }
+    }
+    return true;
+}
+
+//Function to parse all lines of a chunk
+static void parseChunk(ObjLoader::Chunk& chunk){
+    const char* p = chunk.begin;
+    while(p < chunk.end) {
+        const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+        if(lineEnd == NULL) {
+            lineEnd = chunk.end;
+        }
+        if(!parseLine(p, lineEnd, chunk.positions, chunk.texcoords, chunk.normals, chunk.corners, chunk.relative,
+                      chunk.polygon, chunk.polygonRelative, chunk.errorMessage)) {
+            chunk.errorAt = p;
+            return;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+//Constructor
+ObjLoader::ObjLoader(){
+    nVertices = 0;
+    nTriangles = 0;
+    minParallelBytes = 1 << 20;
+}
+
+//Function to remove the loaded geometry
+void ObjLoader::clean(){
+    vertices.clear();
+    indices.clear();
+    nVertices = 0;
+    nTriangles = 0;
+    error.clear();
+}
+
+//Function to load an OBJ file
+bool ObjLoader::load(const char* filename, ThreadPool* pool){
+    MappedFile file;
+    if(!file.open(filename)) {
+        clean();
+        error = std::string("could not open ") + filename;
+        return false;
+    }
+    return parse(file.data, file.size, pool);
+}
+
+//Data passed to the threads parsing the file
+struct ParseData {
+    std::vector<ObjLoader::Chunk>* chunks;
+};
+
+//Task run on every thread: each thread parses the chunk with its own index
+void ObjLoader::parseTask(void* data, int thread, int){
+    ParseData* d = (ParseData*)data;
+    parseChunk((*d->chunks)[thread]);
+}
+
+//Function to parse OBJ data already in memory. The data is split into one range of whole lines per thread
+bool ObjLoader::parse(const char* data, size_t size, ThreadPool* pool){
+    clean();
+    int nChunks = 1;
+    if(pool != NULL && size >= minParallelBytes) {
+        nChunks = pool->size();
+    }
+
+    std::vector<Chunk> chunks(nChunks);
+    const char* begin = data;
+    const char* end = data + size;
+    for(int i = 0; i < nChunks; i++) {
+        const char* chunkEnd = i + 1 == nChunks ? end : data + size / nChunks * (i + 1);
+        if(chunkEnd < begin) {
+            chunkEnd = begin;
+        }
+        //Move the end to the start of the next line
+        const char* newline = chunkEnd < end ? (const char*)memchr(chunkEnd, '\n', end - chunkEnd) : NULL;
+        chunkEnd = newline != NULL ? newline + 1 : end;
+        chunks[i].begin = begin;
+        chunks[i].end = chunkEnd;
+        chunks[i].errorAt = NULL;
+        chunks[i].errorMessage = NULL;
+        begin = chunkEnd;
+    }
+
+    if(nChunks == 1) {
+        parseChunk(chunks[0]);
+    }
+    else {
+        ParseData parseData = { &chunks };
+        pool->run(parseTask, &parseData);
+    }
+
+    for(int i = 0; i < nChunks; i++) {
+        if(chunks[i].errorAt != NULL) {
+            int line = 1;
+            for(const char* p = data; p < chunks[i].errorAt; p++) {
+                line += *p == '\n';
+            }
+            char message[64];
+            snprintf(message, sizeof(message), " on line %d", line);
+            error = std::string(chunks[i].errorMessage) + message;
+            return false;
+        }
+    }
+    return build(chunks);
+}
+
+//A slot of the hash table used to find the vertex of a (position, texture coordinate, normal) tuple
+struct VertexSlot {
+    int position;       // Index of the position, -1 for an empty slot
+    int texcoord;       // Index of the texture coordinate, -1 if there is none
+    int normal;         // Index of the normal, -1 if there is none
+    unsigned vertex;    // The vertex of the tuple
+};
+
+//Function to return the hash of a tuple
+static inline unsigned hashTuple(int position, int texcoord, int normal){
+    unsigned h = (unsigned)position * 0x9E3779B1u;
+    h ^= (unsigned)texcoord * 0x85EBCA77u + (h >> 15);
+    h ^= (unsigned)normal * 0xC2B2AE3Du + (h >> 13);
+    return h ^ (h >> 16);
+}
+
+//Function to insert a tuple in a hash table that is known not to contain it
+static inline void insertTuple(std::vector<VertexSlot>& table, const VertexSlot& slot){
+    size_t mask = table.size() - 1;
+    size_t i = hashTuple(slot.position, slot.texcoord, slot.normal) & mask;
+    while(table[i].position >= 0) {
+        i = (i + 1) & mask;
+    }
+    table[i] = slot;
+}
+
+//The function merges the chunks in file order, resolves the relative indices and checks that all indices are
+//valid. Then it gives every distinct (position, texture coordinate, normal) tuple a vertex, using a hash table
+//with open addressing that keeps the tuple in the slot, so a lookup usually touches a single cache line
+bool ObjLoader::build(std::vector<Chunk>& chunks){
+    std::vector<float> positions, texcoords, normals;
+    std::vector<int> offsets(3 * chunks.size());
+    size_t nCorners = 0;
+    if(chunks.size() == 1) {
+        positions.swap(chunks[0].positions);
+        texcoords.swap(chunks[0].texcoords);
+        normals.swap(chunks[0].normals);
+        nCorners = chunks[0].relative.size();
+    }
+    else {
+        for(size_t i = 0; i < chunks.size(); i++) {
+            Chunk& chunk = chunks[i];
+            offsets[3*i] = (int)positions.size() / 3;
+            offsets[3*i+1] = (int)texcoords.size() / 2;
+            offsets[3*i+2] = (int)normals.size() / 3;
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.texcoords);
+            std::vector<float>().swap(chunk.normals);
+            nCorners += chunk.relative.size();
+        }
+    }
+    int nPositions = (int)positions.size() / 3;
+    int nTexcoords = (int)texcoords.size() / 2;
+    int nNormals = (int)normals.size() / 3;
+
+    //The table starts with room for about one vertex per position and grows when it is half full
+    size_t tableSize = 16;
+    while(tableSize < 2 * (size_t)nPositions && tableSize < 2 * nCorners) {
+        tableSize *= 2;
+    }
+    VertexSlot empty = { -1, -1, -1, 0 };
+    std::vector<VertexSlot> table(tableSize, empty);
+    size_t mask = tableSize - 1;
+    indices.resize(nCorners);
+    vertices.clear();
+    vertices.reserve(8 * (size_t)nPositions);
+    nVertices = 0;
+
+    size_t corner = 0;
+    for(size_t c = 0; c < chunks.size(); c++) {
+        const Chunk& chunk = chunks[c];
+        for(size_t j = 0; j < chunk.relative.size(); j++, corner++) {
+            int v = chunk.corners[3*j];
+            int t = chunk.corners[3*j+1];
+            int n = chunk.corners[3*j+2];
+            unsigned char relative = chunk.relative[j];
+            v += relative & RELATIVE_POSITION ? offsets[3*c] : 0;
+            t += relative & RELATIVE_TEXCOORD ? offsets[3*c+1] : 0;
+            n += relative & RELATIVE_NORMAL ? offsets[3*c+2] : 0;
+            //Missing texture coordinates and normals are -1, which is only valid if the index was not relative
+            if(v < 0 || v >= nPositions || t >= nTexcoords || n >= nNormals
+               || t < ((relative & RELATIVE_TEXCOORD) ? 0 : -1) || n < ((relative & RELATIVE_NORMAL) ? 0 : -1)) {
+                error = "face index out of range";
+                return false;
+            }
+
+            size_t i = hashTuple(v, t, n) & mask;
+            while(table[i].position >= 0 && (table[i].position != v || table[i].texcoord != t || table[i].normal != n)) {
+                i = (i + 1) & mask;
+            }
+            if(table[i].position >= 0) {
+                indices[corner] = table[i].vertex;
+                continue;
+            }
+
+            //A new vertex. Vertices without a normal get the same normal as TriangleSoup::createBox
+            VertexSlot slot = { v, t, n, (unsigned)nVertices };
+            table[i] = slot;
+            indices[corner] = nVertices++;
+            float vertex[8] = {
+                positions[3*v], positions[3*v+1], positions[3*v+2],
+                n >= 0 ? normals[3*n] : 0.0f, n >= 0 ? normals[3*n+1] : 0.0f, n >= 0 ? normals[3*n+2] : 1.0f,
+                t >= 0 ? texcoords[2*t] : 0.0f, t >= 0 ? texcoords[2*t+1] : 0.0f
+            };
+            vertices.insert(vertices.end(), vertex, vertex + 8);
+
+            if(2 * (size_t)nVertices > tableSize) {
+                std::vector<VertexSlot> old(2 * tableSize, empty);
+                old.swap(table);
+                tableSize *= 2;
+                mask = tableSize - 1;
+                for(size_t k = 0; k < old.size(); k++) {
+                    if(old[k].position >= 0) {
+                        insertTuple(table, old[k]);
+                    }
+                }
+            }
+        }
+    }
+    nTriangles = (int)(nCorners / 3);
+    return true;
+}
@@ -0,0 +1,54 @@
+//  ObjLoader.hpp
+// Class that loads the geometry of a Wavefront OBJ file into the interleaved vertex layout of TriangleSoup:
+// 8 floats per vertex, x y z nx ny nz s t, and 3 indices per triangle.
+// The file is memory-mapped and parsed with a hand-written number scanner. Every distinct combination of
+// position, texture coordinate and normal used by a face becomes one vertex. Faces with more than three corners
+// are split into triangle fans. Materials, groups and all other statements are ignored.
+// Large files can be parsed on several threads: the file is split into ranges of whole lines, each thread
+// parses one range, and the ranges are merged in file order so the result does not depend on the threads.
+// It does not depend on OpenGL, so it can be used both by the viewer and by the headless simulator.
+
+#ifndef ObjLoader_hpp
+#define ObjLoader_hpp
+
+#include <vector>
+#include <string>
+
+#include "ThreadPool.hpp"
+
+class ObjLoader {
+public:
+
+    std::vector<float> vertices;        // 8 floats per vertex: position, normal and texture coordinates
+    std::vector<unsigned> indices;      // 3 vertex indices per triangle
+    int nVertices;                      // Number of vertices
+    int nTriangles;                     // Number of triangles
+    std::string error;                  // Description of the error if load() failed
+
+    size_t minParallelBytes;            // Smallest file parsed on more than one thread
+
+    //Constructor
+    ObjLoader();
+
+    //Function to load an OBJ file, parsing it on the threads of pool if it is given. Returns false if the
+    //file could not be read or is not a valid OBJ file
+    bool load(const char* filename, ThreadPool* pool = NULL);
+
+    //Function to parse OBJ data already in memory
+    bool parse(const char* data, size_t size, ThreadPool* pool = NULL);
+
+    //Function to remove the loaded geometry
+    void clean();
+
+    //The lines parsed by one thread, defined in ObjLoader.cpp
+    struct Chunk;
+
+private:
+
+    //Task run on every thread, parsing one range of lines
+    static void parseTask(void* data, int thread, int nThreads);
+    //Function to merge the parsed ranges and build the vertices and triangles
+    bool build(std::vector<Chunk>& chunks);
+};
+
+#endif /* ObjLoader_hpp */
@@ -0,0 +1,413 @@
+//  ParticleSystem.cpp
+// Class that stores the masses of a body as a structure of arrays, with SIMD kernels for the integration step.
+
+#include "ParticleSystem.hpp"
+#include "Profiler.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+//Every x86-64 processor has SSE2, so the SSE kernels need no target attribute. The AVX2 kernel and the processor
+//check use GCC and Clang built-ins
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PARTICLESYSTEM_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// All arrays are aligned for AVX and padded to a multiple of 8 floats, so the kernels never need a scalar tail
+static const int SIMD_WIDTH = 8;
+static const size_t SIMD_ALIGNMENT = 32;
+
+
+/********************************* VectorRef ******************************/
+
+//Constructor
+template<class T>
+BasicVectorRef<T>::BasicVectorRef(T& x, T& y, T& z) : x(x), y(y), z(z) {
+}
+
+//Assign the values of a Vector to the referenced components
+template<class T>
+BasicVectorRef<T>& BasicVectorRef<T>::operator=(const BasicVector<T>& v){
+    x = v.x;
+    y = v.y;
+    z = v.z;
+    return *this;
+}
+
+//Copy the referenced components to a Vector
+template<class T>
+BasicVectorRef<T>::operator BasicVector<T>() const {
+    return BasicVector<T>(x, y, z);
+}
+
+//Function to return the length of the vector
+template<class T>
+T BasicVectorRef<T>::length() const {
+    return (T) sqrt(x * x + y * y + z * z);
+}
+
+
+/********************************* MassView ******************************/
+
+//Constructor
+template<class Precision>
+BasicMassView<Precision>::BasicMassView(Scalar* invMass, BasicVectorRef<Scalar> position, BasicVectorRef<Scalar> velocity,
+                                        BasicVectorRef<Accumulator> force)
+    : position(position), velocity(velocity), force(force), invMass(invMass) {
+}
+
+//Allows the view to be used with the same syntax as a Mass*
+template<class Precision>
+BasicMassView<Precision>* BasicMassView<Precision>::operator->(){
+    return this;
+}
+
+//Function used to get the weight of the mass
+template<class Precision>
+typename Precision::Scalar BasicMassView<Precision>::getWeight() const {
+    return *invMass > 0 ? 1 / *invMass : 0;
+}
+//Function used to set the weight of the mass
+template<class Precision>
+void BasicMassView<Precision>::setWeight(Scalar weight){
+    *invMass = weight > 0 ? 1 / weight : 0;
+}
+//Function used to set starting position of mass
+template<class Precision>
+void BasicMassView<Precision>::setStartPos(Scalar x, Scalar y, Scalar z){
+    position.x = x;
+    position.y = y;
+    position.z = z;
+}
+//Function used to set velocity of the mass
+template<class Precision>
+void BasicMassView<Precision>::setVelocity(Scalar vel_x, Scalar vel_y, Scalar vel_z){
+    velocity.x = vel_x;
+    velocity.y = vel_y;
+    velocity.z = vel_z;
+}
+//Function used to set velocity in the x-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::setVelocityX(Scalar vel_x){
+    velocity.x = vel_x;
+}
+//Function used to set velocity in the y-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::setVelocityY(Scalar vel_y){
+    velocity.y = vel_y;
+}
+//Function used to set velocity in the z-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::setVelocityZ(Scalar vel_z){
+    velocity.z = vel_z;
+}
+//Function used to add to the velocity in the x-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::addVelocityX(Scalar vel_x){
+    velocity.x += vel_x;
+}
+//Function used to add to the velocity in the y-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::addVelocityY(Scalar vel_y){
+    velocity.y += vel_y;
+}
+//Function used to add to the velocity in the z-direction of the mass
+template<class Precision>
+void BasicMassView<Precision>::addVelocityZ(Scalar vel_z){
+    velocity.z += vel_z;
+}
+//Function used to add a force acting on the mass
+template<class Precision>
+void BasicMassView<Precision>::addForce(Accumulator f_x, Accumulator f_y, Accumulator f_z){
+    force.x += f_x;
+    force.y += f_y;
+    force.z += f_z;
+}
+
+
+/********************************* Integration kernels ******************************/
+
+// Every kernel computes, for each mass:
+//   v += (f * invMass - g) * dt    (gravity only for masses that are not fixed)
+//   x += v * dt
+// The operations are done in the same order in all kernels so they give the same result. The scalar kernel
+// computes the increments in the Accumulator of the precision and rounds the sums to the stored Scalar.
+
+template<class Precision>
+static void simulateEulerScalar(BasicParticleSystem<Precision>& p, typename Precision::Accumulator dt){
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+    for(int i = 0; i < p.capacity; i++) {
+        Accumulator g = p.invMass[i] > 0 ? p.gravity : 0;
+        p.vx[i] = (Scalar)(p.vx[i] + (p.fx[i] * p.invMass[i]) * dt);
+        p.vy[i] = (Scalar)(p.vy[i] + (p.fy[i] * p.invMass[i] - g) * dt);
+        p.vz[i] = (Scalar)(p.vz[i] + (p.fz[i] * p.invMass[i]) * dt);
+        p.x[i] = (Scalar)(p.x[i] + p.vx[i] * dt);
+        p.y[i] = (Scalar)(p.y[i] + p.vy[i] * dt);
+        p.z[i] = (Scalar)(p.z[i] + p.vz[i] * dt);
+    }
+}
+
+#ifdef PARTICLESYSTEM_X86
+
+static void simulateEulerSSE(ParticleSystem& p, float dt){
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 vg = _mm_set1_ps(p.gravity);
+    const __m128 zero = _mm_setzero_ps();
+    for(int i = 0; i < p.capacity; i += 4) {
+        __m128 im = _mm_load_ps(p.invMass + i);
+        __m128 g = _mm_and_ps(_mm_cmpgt_ps(im, zero), vg);
+        __m128 vx = _mm_add_ps(_mm_load_ps(p.vx + i), _mm_mul_ps(_mm_mul_ps(_mm_load_ps(p.fx + i), im), vdt));
+        __m128 vy = _mm_add_ps(_mm_load_ps(p.vy + i), _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_load_ps(p.fy + i), im), g), vdt));
+        __m128 vz = _mm_add_ps(_mm_load_ps(p.vz + i), _mm_mul_ps(_mm_mul_ps(_mm_load_ps(p.fz + i), im), vdt));
+        _mm_store_ps(p.vx + i, vx);
+        _mm_store_ps(p.vy + i, vy);
+        _mm_store_ps(p.vz + i, vz);
+        _mm_store_ps(p.x + i, _mm_add_ps(_mm_load_ps(p.x + i), _mm_mul_ps(vx, vdt)));
+        _mm_store_ps(p.y + i, _mm_add_ps(_mm_load_ps(p.y + i), _mm_mul_ps(vy, vdt)));
+        _mm_store_ps(p.z + i, _mm_add_ps(_mm_load_ps(p.z + i), _mm_mul_ps(vz, vdt)));
+    }
+}
+
+__attribute__((target("avx2")))
+static void simulateEulerAVX2(ParticleSystem& p, float dt){
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 vg = _mm256_set1_ps(p.gravity);
+    const __m256 zero = _mm256_setzero_ps();
+    for(int i = 0; i < p.capacity; i += 8) {
+        __m256 im = _mm256_load_ps(p.invMass + i);
+        __m256 g = _mm256_and_ps(_mm256_cmp_ps(im, zero, _CMP_GT_OQ), vg);
+        __m256 vx = _mm256_add_ps(_mm256_load_ps(p.vx + i), _mm256_mul_ps(_mm256_mul_ps(_mm256_load_ps(p.fx + i), im), vdt));
+        __m256 vy = _mm256_add_ps(_mm256_load_ps(p.vy + i), _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(p.fy + i), im), g), vdt));
+        __m256 vz = _mm256_add_ps(_mm256_load_ps(p.vz + i), _mm256_mul_ps(_mm256_mul_ps(_mm256_load_ps(p.fz + i), im), vdt));
+        _mm256_store_ps(p.vx + i, vx);
+        _mm256_store_ps(p.vy + i, vy);
+        _mm256_store_ps(p.vz + i, vz);
+        _mm256_store_ps(p.x + i, _mm256_add_ps(_mm256_load_ps(p.x + i), _mm256_mul_ps(vx, vdt)));
+        _mm256_store_ps(p.y + i, _mm256_add_ps(_mm256_load_ps(p.y + i), _mm256_mul_ps(vy, vdt)));
+        _mm256_store_ps(p.z + i, _mm256_add_ps(_mm256_load_ps(p.z + i), _mm256_mul_ps(vz, vdt)));
+    }
+}
+
+#endif
+
+//The highest SIMD level supported by the processor
+static SimdLevel detectSimdLevel(){
+#ifdef PARTICLESYSTEM_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return SIMD_SSE;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+static SimdLevel maxSimdLevel = detectSimdLevel();
+static SimdLevel currentSimdLevel = maxSimdLevel;
+
+
+//Whether the SIMD kernels are written for a precision. They are only written for floats
+template<class Precision>
+static bool hasSimdKernels(){
+    return false;
+}
+template<>
+bool hasSimdKernels<FloatPrecision>(){
+    return true;
+}
+
+//Integrates a system of floats with the kernel of the selected SIMD level
+static void simulateEulerKernel(ParticleSystem& p, float dt){
+    switch(currentSimdLevel) {
+#ifdef PARTICLESYSTEM_X86
+        case SIMD_AVX2:
+            simulateEulerAVX2(p, dt);
+            break;
+        case SIMD_SSE:
+            simulateEulerSSE(p, dt);
+            break;
+#endif
+        default:
+            simulateEulerScalar(p, dt);
+            break;
+    }
+}
+
+//The SIMD kernels are written for floats only, the other precisions use the scalar kernel
+template<class Precision>
+static void simulateEulerKernel(BasicParticleSystem<Precision>& p, typename Precision::Accumulator dt){
+    simulateEulerScalar(p, dt);
+}
+
+
+/********************************* ParticleSystem ******************************/
+
+//Allocates an array of n values aligned for SIMD loads and stores, filled with zeros
+template<class T>
+static T* allocateAligned(int n){
+    void* ptr = NULL;
+#ifdef _WIN32
+    ptr = _aligned_malloc(n * sizeof(T), SIMD_ALIGNMENT);
+#else
+    if(posix_memalign(&ptr, SIMD_ALIGNMENT, n * sizeof(T)) != 0) {
+        ptr = NULL;
+    }
+#endif
+    if(ptr) {
+        memset(ptr, 0, n * sizeof(T));
+    }
+    return (T*)ptr;
+}
+
+//Frees an array allocated with allocateAligned
+template<class T>
+static void freeAligned(T*& ptr){
+    if(ptr) {
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+        ptr = NULL;
+    }
+}
+
+//Constructor
+template<class Precision>
+BasicParticleSystem<Precision>::BasicParticleSystem(){
+    nParticles = 0;
+    capacity = 0;
+    x = y = z = NULL;
+    vx = vy = vz = NULL;
+    fx = fy = fz = NULL;
+    px = py = pz = NULL;
+    invMass = NULL;
+    gravity = Precision::gravity();
+}
+
+//Destructor
+template<class Precision>
+BasicParticleSystem<Precision>::~BasicParticleSystem(){
+    clean();
+}
+
+//Function to allocate n masses with the same weight
+template<class Precision>
+void BasicParticleSystem<Precision>::create(int n, float weight){
+    clean();
+    nParticles = n;
+    capacity = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    x = allocateAligned<Scalar>(capacity);
+    y = allocateAligned<Scalar>(capacity);
+    z = allocateAligned<Scalar>(capacity);
+    vx = allocateAligned<Scalar>(capacity);
+    vy = allocateAligned<Scalar>(capacity);
+    vz = allocateAligned<Scalar>(capacity);
+    fx = allocateAligned<Accumulator>(capacity);
+    fy = allocateAligned<Accumulator>(capacity);
+    fz = allocateAligned<Accumulator>(capacity);
+    px = allocateAligned<Scalar>(capacity);
+    py = allocateAligned<Scalar>(capacity);
+    pz = allocateAligned<Scalar>(capacity);
+    invMass = allocateAligned<Scalar>(capacity);
+    for(int i = 0; i < n; i++) {
+        invMass[i] = weight > 0.0f ? 1 / (Scalar)weight : 0;
+    }
+}
+
+//Function to free all allocated data
+template<class Precision>
+void BasicParticleSystem<Precision>::clean(){
+    Scalar** arrays[] = { &x, &y, &z, &vx, &vy, &vz, &px, &py, &pz, &invMass };
+    for(int i = 0; i < 10; i++) {
+        freeAligned(*arrays[i]);
+    }
+    freeAligned(fx);
+    freeAligned(fy);
+    freeAligned(fz);
+    nParticles = 0;
+    capacity = 0;
+}
+
+//Function to access one mass with the same interface as Mass
+template<class Precision>
+BasicMassView<Precision> BasicParticleSystem<Precision>::operator[](int i){
+    return BasicMassView<Precision>(&invMass[i], BasicVectorRef<Scalar>(x[i], y[i], z[i]),
+                                    BasicVectorRef<Scalar>(vx[i], vy[i], vz[i]),
+                                    BasicVectorRef<Accumulator>(fx[i], fy[i], fz[i]));
+}
+
+//Function used to reset the accumulated forces before a new step
+template<class Precision>
+void BasicParticleSystem<Precision>::clearForces(){
+    memset(fx, 0, capacity * sizeof(Accumulator));
+    memset(fy, 0, capacity * sizeof(Accumulator));
+    memset(fz, 0, capacity * sizeof(Accumulator));
+}
+
+//Function used to simulate all masses one step with the selected kernel
+template<class Precision>
+void BasicParticleSystem<Precision>::simulateEuler(Accumulator dt){
+    PROFILE_SCOPE("integrate");
+    simulateEulerKernel(*this, dt);
+}
+
+//Function used to save the current positions as the previous state
+template<class Precision>
+void BasicParticleSystem<Precision>::storePreviousPositions(){
+    memcpy(px, x, capacity * sizeof(Scalar));
+    memcpy(py, y, capacity * sizeof(Scalar));
+    memcpy(pz, z, capacity * sizeof(Scalar));
+}
+
+//Function to return the position of mass i interpolated between the previous and the current state
+template<class Precision>
+BasicVector<typename Precision::Scalar> BasicParticleSystem<Precision>::interpolatedPosition(int i, float alpha) const {
+    return BasicVector<Scalar>(px[i] + (x[i] - px[i]) * alpha,
+                               py[i] + (y[i] - py[i]) * alpha,
+                               pz[i] + (z[i] - pz[i]) * alpha);
+}
+
+//Function to get the SIMD level used by the integration kernel. Precisions without SIMD kernels always use the
+//scalar kernel
+template<class Precision>
+SimdLevel BasicParticleSystem<Precision>::getSimdLevel(){
+    return hasSimdKernels<Precision>() ? currentSimdLevel : SIMD_SCALAR;
+}
+
+//Function to force a SIMD level
+template<class Precision>
+void BasicParticleSystem<Precision>::setSimdLevel(SimdLevel level){
+    currentSimdLevel = level < maxSimdLevel ? level : maxSimdLevel;
+}
+
+//Function to get the name of a SIMD level
+template<class Precision>
+const char* BasicParticleSystem<Precision>::simdLevelName(SimdLevel level){
+    switch(level) {
+        case SIMD_AVX2:
+            return "AVX2";
+        case SIMD_SSE:
+            return "SSE";
+        default:
+            return "scalar";
+    }
+}
+
+//The precisions the classes are compiled for
+template class BasicVectorRef<float>;
+template class BasicVectorRef<double>;
+template class BasicMassView<FloatPrecision>;
+template class BasicMassView<DoublePrecision>;
+template class BasicMassView<MixedPrecision>;
+template class BasicParticleSystem<FloatPrecision>;
+template class BasicParticleSystem<DoublePrecision>;
+template class BasicParticleSystem<MixedPrecision>;
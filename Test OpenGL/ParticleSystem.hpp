@@ -0,0 +1,145 @@
+//  ParticleSystem.hpp
+// Class that stores the masses of a body as a structure of arrays: the x, y and z components of the position,
+// velocity and force of all masses are kept in separate aligned arrays together with the inverse mass. This
+// lets the integration step run over all masses with SIMD instructions. The SIMD kernel (scalar, SSE or AVX2)
+// is selected at runtime depending on what the processor supports.
+// The class is a template on the precision, see Precision.hpp: the positions, velocities and inverse masses are
+// stored as the Scalar of the precision and the forces as its Accumulator. ParticleSystem is the system of floats,
+// the only one the SIMD kernels are written for; the other precisions are integrated with the scalar kernel.
+// MassView gives access to a single mass with the same interface as the Mass class.
+
+#ifndef ParticleSystem_hpp
+#define ParticleSystem_hpp
+
+#include "Vector.hpp"
+#include "Precision.hpp"
+
+//Levels of SIMD support used by the integration kernels
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE = 1,
+    SIMD_AVX2 = 2
+};
+
+//Reference to the x, y and z components of a vector stored in a ParticleSystem
+template<class T>
+class BasicVectorRef {
+public:
+    T& x; // the x value of the Vector
+    T& y; // the y value of the Vector
+    T& z; // the z value of the Vector
+
+    //Constructor
+    BasicVectorRef(T& x, T& y, T& z);
+    //Assign the values of a Vector to the referenced components
+    BasicVectorRef& operator=(const BasicVector<T>& v);
+    //Copy the referenced components to a Vector
+    operator BasicVector<T>() const;
+    //Function to return the length of the vector
+    T length() const;
+};
+
+typedef BasicVectorRef<float> VectorRef;
+
+//View of one mass in a ParticleSystem with the same interface as Mass
+template<class Precision>
+class BasicMassView {
+public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    BasicVectorRef<Scalar> position;        // Position in space
+    BasicVectorRef<Scalar> velocity;        // Velocity
+    BasicVectorRef<Accumulator> force;      // Sum of the forces acting on the mass during the current step
+
+    //Constructor
+    BasicMassView(Scalar* invMass, BasicVectorRef<Scalar> position, BasicVectorRef<Scalar> velocity,
+                  BasicVectorRef<Accumulator> force);
+
+    //Allows the view to be used with the same syntax as a Mass*
+    BasicMassView* operator->();
+
+    //Function used to get the weight of the mass
+    Scalar getWeight() const;
+    //Function used to set the weight of the mass. A weight of zero makes the mass fixed in space
+    void setWeight(Scalar weight);
+    //Function used to set starting position of mass
+    void setStartPos(Scalar x, Scalar y, Scalar z);
+    //Function used to set velocity of the mass
+    void setVelocity(Scalar vel_x, Scalar vel_y, Scalar vel_z);
+    //Function used to set velocity in the x-direction of the mass
+    void setVelocityX(Scalar vel_x);
+    //Function used to set velocity in the y-direction of the mass
+    void setVelocityY(Scalar vel_y);
+    //Function used to set velocity in the z-direction of the mass
+    void setVelocityZ(Scalar vel_z);
+    //Function used to add to the velocity in the x-direction of the mass
+    void addVelocityX(Scalar vel_x);
+    //Function used to add to the velocity in the y-direction of the mass
+    void addVelocityY(Scalar vel_y);
+    //Function used to add to the velocity in the z-direction of the mass
+    void addVelocityZ(Scalar vel_z);
+    //Function used to add a force acting on the mass
+    void addForce(Accumulator f_x, Accumulator f_y, Accumulator f_z);
+
+private:
+    Scalar* invMass;        // The inverse weight of the mass
+};
+
+typedef BasicMassView<FloatPrecision> MassView;
+
+template<class Precision>
+class BasicParticleSystem {
+public:
+    typedef typename Precision::Scalar Scalar;              // Type of the positions, velocities and inverse weights
+    typedef typename Precision::Accumulator Accumulator;    // Type the forces are summed and the steps computed in
+
+    int nParticles;         // Number of masses in the system
+    int capacity;           // Allocated length of the arrays, padded to a whole number of SIMD registers
+    Scalar *x, *y, *z;      // Positions
+    Scalar *vx, *vy, *vz;   // Velocities
+    Accumulator *fx, *fy, *fz; // Accumulated forces
+    Scalar *px, *py, *pz;   // Positions before the last step, used to interpolate the rendered state
+    Scalar *invMass;        // Inverse weights. Zero for fixed masses and for the padding
+    Accumulator gravity;    // Gravitational acceleration in the negative y-direction
+
+    //Constructor, creates an empty system
+    BasicParticleSystem();
+    //Destructor
+    ~BasicParticleSystem();
+
+    //Function to allocate n masses with the same weight, placed at the origin with zero velocity
+    void create(int n, float weight);
+    //Function to free all allocated data
+    void clean();
+
+    //Function to access one mass with the same interface as Mass
+    BasicMassView<Precision> operator[](int i);
+
+    //Function used to reset the accumulated forces before a new step
+    void clearForces();
+    //Function used to simulate the positions and velocities of all masses one step using the Euler method
+    void simulateEuler(Accumulator dt);
+
+    //Function used to save the current positions as the previous state, before the last step of a frame
+    void storePreviousPositions();
+    //Function to return the position of mass i interpolated between the previous and the current state.
+    //alpha = 0 gives the previous position and alpha = 1 the current position
+    BasicVector<Scalar> interpolatedPosition(int i, float alpha) const;
+
+    //Function to get the SIMD level used by the integration kernel. Always SIMD_SCALAR for precisions other than float
+    static SimdLevel getSimdLevel();
+    //Function to force a SIMD level, for testing. Levels the processor does not support are clamped
+    static void setSimdLevel(SimdLevel level);
+    //Function to get the name of a SIMD level
+    static const char* simdLevelName(SimdLevel level);
+
+private:
+    //Copying would share the arrays, so it is not allowed
+    BasicParticleSystem(const BasicParticleSystem&);
+    BasicParticleSystem& operator=(const BasicParticleSystem&);
+};
+
+typedef BasicParticleSystem<FloatPrecision> ParticleSystem;
+
+#endif /* ParticleSystem_hpp */
@@ -0,0 +1,39 @@
+//  Precision.hpp
+// Precisions used as compile-time policies of the simulation: BasicParticleSystem<Precision>, BasicSoftBody<Precision>
+// and BasicScene<Precision>, and the original BasicMass<Precision> and BasicSpringDamper<Precision>. Each policy
+// names the type the positions, velocities and constants are stored in (Scalar) and the type the forces are
+// computed and summed in (Accumulator), so every precision compiles to its own code without any run-time cost.
+// gravity() is GRAVITY rounded to the Accumulator, not to float.
+//   FloatPrecision   floats for everything. The precision the simulation has always used, and the fastest
+//   DoublePrecision  doubles for everything. For long offline runs, where a float position far from the origin
+//                    no longer changes by the small velocity increments of a short timestep
+//   MixedPrecision   positions and velocities stored as floats, forces and velocity increments computed in double,
+//                    so the forces of many springs on one mass are summed without rounding errors
+
+#ifndef Precision_hpp
+#define Precision_hpp
+
+const double GRAVITY = 9.82;    // Gravitational acceleration in the negative y-direction
+
+struct FloatPrecision {
+    typedef float Scalar;
+    typedef float Accumulator;
+    static const char* name() { return "float"; }
+    static Accumulator gravity() { return (Accumulator)GRAVITY; }
+};
+
+struct DoublePrecision {
+    typedef double Scalar;
+    typedef double Accumulator;
+    static const char* name() { return "double"; }
+    static Accumulator gravity() { return (Accumulator)GRAVITY; }
+};
+
+struct MixedPrecision {
+    typedef float Scalar;
+    typedef double Accumulator;
+    static const char* name() { return "mixed"; }
+    static Accumulator gravity() { return (Accumulator)GRAVITY; }
+};
+
+#endif /* Precision_hpp */
@@ -0,0 +1,284 @@
+//  Profiler.cpp
+// Frame profiler with a lock-free buffer of timings per thread.
+
+#include "Profiler.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+//Number of timings kept per thread between two frames. Older timings are lost if a thread writes more in a frame
+static const int RING_SIZE = 1 << 16;
+//Largest number of timings kept for the trace. The trace covers the frames until it is full
+static const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+//The timings of one thread. Only the thread itself writes to it, and it publishes every timing by incrementing
+//written. The thread that ends the frames reads the timings up to written
+struct ProfileThreadBuffer {
+    ProfileEvent events[RING_SIZE];     // Ring of timings, timing i is at i % RING_SIZE
+    std::atomic<uint64_t> written;      // Number of timings written
+    uint64_t collected;                 // Number of timings read by endFrame()
+    int depth;                          // Number of phases the thread is in
+    int thread;                         // Number of the thread in the trace
+
+    ProfileThreadBuffer() : written(0), collected(0), depth(0), thread(0) {}
+};
+
+//Timing of all phases with the same name during one frame
+struct PhaseTotal {
+    const char* name;
+    int thread;
+    int64_t total;
+};
+
+//Time per frame of one phase, in milliseconds, for every frame the phase was in
+struct PhaseTimes {
+    std::string name;
+    std::vector<float> times;
+};
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+static std::mutex registryMutex;                    // Protects threadBuffers while a thread is added
+static std::vector<ProfileThreadBuffer*> threadBuffers;
+static thread_local ProfileThreadBuffer* localBuffer = NULL;
+
+//Only used by the thread that ends the frames
+static std::vector<ProfileEvent> gpuEvents;         // GPU timings since the last frame
+static std::vector<ProfileEvent> frameEvents;       // Timings of the frame being ended
+static std::vector<PhaseTotal> frameTotals;
+static std::vector<PhaseTimes> phases;
+static std::vector<ProfileEvent> traceEvents;
+static int64_t lastFrameEnd = 0;
+static long frames = 0;
+static uint64_t lostEvents = 0;                     // Timings overwritten before they were read
+static uint64_t droppedTraceEvents = 0;             // Timings left out of the full trace
+
+//Function to return the buffer of the calling thread, created the first time the thread uses the profiler
+static ProfileThreadBuffer* threadBuffer(){
+    ProfileThreadBuffer* buffer = localBuffer;
+    if(buffer == NULL) {
+        buffer = new ProfileThreadBuffer();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->thread = (int)threadBuffers.size();
+        threadBuffers.push_back(buffer);
+        localBuffer = buffer;
+    }
+    return buffer;
+}
+
+//Function to return the time in nanoseconds since the profiler was started
+int64_t Profiler::now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+//Function to start a phase on the calling thread. Returns the depth of the phase
+int Profiler::enter(){
+    return threadBuffer()->depth++;
+}
+
+//Function to end a phase on the calling thread and write its timing
+void Profiler::leave(const char* name, int64_t start, int depth){
+    int64_t end = now();
+    ProfileThreadBuffer* buffer = localBuffer;
+    buffer->depth = depth;
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer->events[index & (RING_SIZE - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.depth = depth;
+    event.thread = buffer->thread;
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+//Function to add a phase measured on the GPU
+void Profiler::recordGpu(const char* name, int64_t start, int64_t duration){
+    ProfileEvent event = { name, start, start + duration, 0, GPU_THREAD };
+    gpuEvents.push_back(event);
+}
+
+//Function to read the timings a thread has written since the last frame. The timings that the thread may have
+//overwritten while they were copied are left out
+static void collect(ProfileThreadBuffer& buffer){
+    uint64_t written = buffer.written.load(std::memory_order_acquire);
+    uint64_t from = buffer.collected;
+    if(written - from > (uint64_t)RING_SIZE) {
+        lostEvents += written - from - RING_SIZE;
+        from = written - RING_SIZE;
+    }
+    size_t first = frameEvents.size();
+    for(uint64_t i = from; i < written; i++) {
+        frameEvents.push_back(buffer.events[i & (RING_SIZE - 1)]);
+    }
+    uint64_t after = buffer.written.load(std::memory_order_acquire);
+    if(after - from > (uint64_t)RING_SIZE) {
+        size_t overwritten = (size_t)(after - from - RING_SIZE);
+        overwritten = std::min(overwritten, (size_t)(written - from));
+        frameEvents.erase(frameEvents.begin() + first, frameEvents.begin() + first + overwritten);
+        lostEvents += overwritten;
+    }
+    buffer.collected = written;
+}
+
+//Function to add the time of a phase in the last frame to its times
+static void addPhaseTime(const char* name, int64_t nanoseconds){
+    size_t p = 0;
+    while(p < phases.size() && phases[p].name != name) {
+        p++;
+    }
+    if(p == phases.size()) {
+        phases.push_back(PhaseTimes());
+        phases.back().name = name;
+    }
+    phases[p].times.push_back(1e-6f * nanoseconds);
+}
+
+//Function to end a frame. The time of a phase in the frame is the sum of its timings on each thread, and the
+//longest of these sums if the phase ran on several threads at once
+void Profiler::endFrame(){
+    int64_t frameEnd = now();
+    ProfileThreadBuffer* caller = threadBuffer();
+
+    frameEvents.clear();
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for(size_t t = 0; t < threadBuffers.size(); t++) {
+            collect(*threadBuffers[t]);
+        }
+    }
+    frameEvents.insert(frameEvents.end(), gpuEvents.begin(), gpuEvents.end());
+    gpuEvents.clear();
+
+    //The sums per thread
+    frameTotals.clear();
+    for(size_t e = 0; e < frameEvents.size(); e++) {
+        const ProfileEvent& event = frameEvents[e];
+        size_t t = 0;
+        while(t < frameTotals.size() && (frameTotals[t].thread != event.thread || strcmp(frameTotals[t].name, event.name) != 0)) {
+            t++;
+        }
+        if(t == frameTotals.size()) {
+            PhaseTotal total = { event.name, event.thread, 0 };
+            frameTotals.push_back(total);
+        }
+        frameTotals[t].total += event.end - event.start;
+    }
+
+    //The frame itself, and the longest sum of every phase
+    addPhaseTime("frame", frameEnd - lastFrameEnd);
+    for(size_t t = 0; t < frameTotals.size(); t++) {
+        if(frameTotals[t].name == NULL) {
+            continue;
+        }
+        int64_t longest = frameTotals[t].total;
+        for(size_t u = t + 1; u < frameTotals.size(); u++) {
+            if(frameTotals[u].name != NULL && strcmp(frameTotals[u].name, frameTotals[t].name) == 0) {
+                longest = std::max(longest, frameTotals[u].total);
+                frameTotals[u].name = NULL;
+            }
+        }
+        addPhaseTime(frameTotals[t].name, longest);
+    }
+
+    //The trace, with the frame as a phase of the thread that ends the frames
+    ProfileEvent frame = { "frame", lastFrameEnd, frameEnd, -1, caller->thread };
+    if(traceEvents.size() + frameEvents.size() + 1 <= MAX_TRACE_EVENTS) {
+        traceEvents.push_back(frame);
+        traceEvents.insert(traceEvents.end(), frameEvents.begin(), frameEvents.end());
+    }
+    else {
+        droppedTraceEvents += frameEvents.size() + 1;
+    }
+
+    lastFrameEnd = frameEnd;
+    frames++;
+}
+
+//Function to return the p-th percentile of a set of times, the smallest time that at least p percent of the
+//times are not larger than
+static float percentile(std::vector<float>& times, float p){
+    size_t rank = (size_t)(p / 100.0f * times.size() + 0.999f);
+    rank = rank > 0 ? rank - 1 : 0;
+    rank = std::min(rank, times.size() - 1);
+    std::nth_element(times.begin(), times.begin() + rank, times.end());
+    return times[rank];
+}
+
+//Function to print the time per frame of every phase, in the order they were first measured
+void Profiler::printReport(std::ostream& out){
+    if(frames == 0) {
+        return;
+    }
+    char line[200];
+    snprintf(line, sizeof(line), "%-24s %8s %10s %10s %10s\n", "Phase", "frames", "p50 ms", "p99 ms", "max ms");
+    out << line;
+    for(size_t p = 0; p < phases.size(); p++) {
+        std::vector<float> times = phases[p].times;
+        float p50 = percentile(times, 50.0f);
+        float p99 = percentile(times, 99.0f);
+        float longest = *std::max_element(times.begin(), times.end());
+        snprintf(line, sizeof(line), "%-24s %8d %10.3f %10.3f %10.3f\n", phases[p].name.c_str(), (int)times.size(), p50, p99, longest);
+        out << line;
+    }
+    if(lostEvents > 0) {
+        out << lostEvents << " timings were overwritten before they were read" << std::endl;
+    }
+}
+
+//Function to write a name as a JSON string
+static void writeName(FILE* file, const char* name){
+    fputc('"', file);
+    for(const char* c = name; *c; c++) {
+        if(*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+//Function to write the timings as a Chrome trace, one complete event ("ph":"X") per phase, with the times in
+//microseconds
+bool Profiler::writeTrace(const char* filename){
+    FILE* file = fopen(filename, "w");
+    if(file == NULL) {
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int nThreads;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        nThreads = (int)threadBuffers.size();
+    }
+    for(int t = 0; t < nThreads; t++) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}},\n", t, t);
+    }
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", GPU_THREAD);
+    for(size_t e = 0; e < traceEvents.size(); e++) {
+        const ProfileEvent& event = traceEvents[e];
+        fprintf(file, ",\n{\"name\":");
+        writeName(file, event.name);
+        fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event.thread, 1e-3 * event.start, 1e-3 * (event.end - event.start));
+    }
+    fprintf(file, "\n]}\n");
+    bool written = !ferror(file);
+    if(fclose(file) != 0) {
+        written = false;
+    }
+    if(droppedTraceEvents > 0) {
+        fprintf(stderr, "%s: the trace is full, the last %llu timings were left out\n", filename, (unsigned long long)droppedTraceEvents);
+    }
+    return written;
+}
+
+//Function to return the number of frames ended so far
+long Profiler::frameCount(){
+    return frames;
+}
@@ -0,0 +1,88 @@
+//  Profiler.hpp
+// Frame profiler. The code is instrumented with macros that are empty unless BOX3D_PROFILE is defined (the CMake
+// option BOX3D_PROFILE), so the profiler costs nothing when it is compiled out:
+//   PROFILE_SCOPE("name")  times the rest of the enclosing block as the phase "name", a string literal
+//   PROFILE_FRAME()        ends a frame, called once per frame by the thread that runs the frames
+// Every thread writes its timings to its own ring buffer without any locks. PROFILE_FRAME() reads the new
+// timings of all threads, adds up the time of every phase in the frame and keeps them for the report. Timings of
+// the GPU, measured by the viewer with GpuTimer, are added with recordGpu().
+// printReport() prints the median and 99th percentile time per frame of every phase, and writeTrace() writes the
+// timings in the trace event format of Chrome (chrome://tracing or https://ui.perfetto.dev).
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <stdint.h>
+#include <ostream>
+
+//One timed phase
+struct ProfileEvent {
+    const char* name;       // Name of the phase
+    int64_t start;          // Start time in nanoseconds since the profiler was started
+    int64_t end;            // End time in nanoseconds since the profiler was started
+    int depth;              // Number of enclosing phases on the same thread
+    int thread;             // Thread that measured the phase, GPU_THREAD for the GPU
+};
+
+class Profiler {
+public:
+
+    //The thread number of the timings of the GPU in the trace
+    static const int GPU_THREAD = 1000;
+
+    //Function to return the time in nanoseconds since the profiler was started
+    static int64_t now();
+
+    //Functions used by ProfileScope to start and end a phase on the calling thread
+    static int enter();
+    static void leave(const char* name, int64_t start, int depth);
+
+    //Function to add a phase measured on the GPU. start is when the commands were sent, on the clock of now()
+    static void recordGpu(const char* name, int64_t start, int64_t duration);
+
+    //Function to end a frame. The timings written by all threads since the last frame are collected
+    static void endFrame();
+
+    //Function to print the median and 99th percentile time per frame of every phase
+    static void printReport(std::ostream& out);
+
+    //Function to write the collected timings as a Chrome trace. Returns false if the file can not be written
+    static bool writeTrace(const char* filename);
+
+    //Function to return the number of frames ended so far
+    static long frameCount();
+};
+
+//Times the block it is declared in, from the constructor to the destructor
+class ProfileScope {
+public:
+    //Constructor, starts the phase
+    explicit ProfileScope(const char* name) : name(name) {
+        depth = Profiler::enter();
+        start = Profiler::now();
+    }
+    //Destructor, ends the phase
+    ~ProfileScope() {
+        Profiler::leave(name, start, depth);
+    }
+
+private:
+    const char* name;
+    int64_t start;
+    int depth;
+
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+};
+
+#ifdef BOX3D_PROFILE
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::endFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
+
+#endif /* Profiler_hpp */
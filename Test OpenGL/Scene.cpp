@@ -0,0 +1,268 @@
+//  Scene.cpp
+// Class for a scene of several soft bodies that collide with each other.
+
+#include "Scene.hpp"
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <cstring>
+
+//Constructor
+template<class Precision>
+BasicScene<Precision>::BasicScene(){
+    contactDistance = 0.05f;
+    contactRestitution = 0.5f;
+    selfCollision = false;
+    nCandidates = 0;
+    nContacts = 0;
+}
+
+//Destructor
+template<class Precision>
+BasicScene<Precision>::~BasicScene(){
+    for(size_t i = 0; i < bodies.size(); i++) {
+        delete bodies[i];
+    }
+}
+
+//Function to add an empty body to the scene
+template<class Precision>
+BasicSoftBody<Precision>& BasicScene<Precision>::addBody(){
+    bodies.push_back(new BasicSoftBody<Precision>());
+    bodies.back()->colliders = &colliders;
+    return *bodies.back();
+}
+
+//Function to place the bodies in a square of columns
+template<class Precision>
+float BasicScene<Precision>::arrange(float distance){
+    int n = (int)bodies.size();
+    int columns = 1;
+    while(columns * columns < n) {
+        columns++;
+    }
+    for(int b = 0; b < n; b++) {
+        bodies[b]->translate((b % columns - 0.5f * (columns - 1)) * distance,
+                             (b / (columns * columns)) * distance,
+                             (b / columns % columns - 0.5f * (columns - 1)) * distance);
+    }
+    return 0.5f * columns * distance;
+}
+
+//Function to return the number of masses of all bodies
+template<class Precision>
+int BasicScene<Precision>::massCount() const {
+    int n = 0;
+    for(size_t i = 0; i < bodies.size(); i++) {
+        n += bodies[i]->particles.nParticles;
+    }
+    return n;
+}
+
+//Function to return the number of springs of all bodies
+template<class Precision>
+int BasicScene<Precision>::springCount() const {
+    int n = 0;
+    for(size_t i = 0; i < bodies.size(); i++) {
+        n += bodies[i]->springs.nSprings;
+    }
+    return n;
+}
+
+//Function to simulate all bodies one step and resolve the collisions between their masses
+template<class Precision>
+void BasicScene<Precision>::step(Accumulator dt){
+    for(size_t i = 0; i < bodies.size(); i++) {
+        bodies[i]->step(dt);
+    }
+    collide();
+}
+
+//Function to find the masses in contact and push them apart. The masses of all bodies are copied into one set of
+//arrays, so the broad phase sees them all at once, and copied back if any of them were in contact
+template<class Precision>
+void BasicScene<Precision>::collide(){
+    PROFILE_SCOPE("contacts");
+    nCandidates = 0;
+    nContacts = 0;
+    int n = massCount();
+    if(n < 2 || contactDistance <= 0.0f || (bodies.size() < 2 && !selfCollision)) {
+        return;
+    }
+
+    x.resize(n); y.resize(n); z.resize(n);
+    vx.resize(n); vy.resize(n); vz.resize(n);
+    invMass.resize(n);
+    massBody.resize(n);
+    int offset = 0;
+    for(size_t b = 0; b < bodies.size(); b++) {
+        const BasicParticleSystem<Precision>& particles = bodies[b]->particles;
+        int count = particles.nParticles;
+        if(count == 0) {
+            continue;
+        }
+        memcpy(&x[offset], particles.x, count * sizeof(Scalar));
+        memcpy(&y[offset], particles.y, count * sizeof(Scalar));
+        memcpy(&z[offset], particles.z, count * sizeof(Scalar));
+        memcpy(&vx[offset], particles.vx, count * sizeof(Scalar));
+        memcpy(&vy[offset], particles.vy, count * sizeof(Scalar));
+        memcpy(&vz[offset], particles.vz, count * sizeof(Scalar));
+        memcpy(&invMass[offset], particles.invMass, count * sizeof(Scalar));
+        for(int i = 0; i < count; i++) {
+            massBody[offset + i] = (int)b;
+        }
+        offset += count;
+    }
+
+    //Broad phase: the pairs of masses of different bodies in neighbouring cells of a grid with cells of the
+    //contact distance
+    first.clear();
+    second.clear();
+    grid.build(&x[0], &y[0], &z[0], n, contactDistance);
+    grid.findPairs(first, second, selfCollision ? NULL : &massBody[0]);
+    nCandidates = (int)first.size();
+    if(nCandidates == 0) {
+        return;
+    }
+
+    //Narrow phase: the positions of the candidates are read through their indices, which can not be vectorised,
+    //so their differences are first gathered into contiguous arrays. The distances are then computed from those in
+    //one loop without branches, which the compiler vectorises, and the pairs in contact are moved to the front of
+    //the lists
+    const int* a = &first[0];
+    const int* c = &second[0];
+    pairDx.resize(nCandidates);
+    pairDy.resize(nCandidates);
+    pairDz.resize(nCandidates);
+    distance2.resize(nCandidates);
+    Scalar* dx = &pairDx[0];
+    Scalar* dy = &pairDy[0];
+    Scalar* dz = &pairDz[0];
+    Scalar* d2 = &distance2[0];
+    for(int k = 0; k < nCandidates; k++) {
+        dx[k] = x[a[k]] - x[c[k]];
+        dy[k] = y[a[k]] - y[c[k]];
+        dz[k] = z[a[k]] - z[c[k]];
+    }
+    for(int k = 0; k < nCandidates; k++) {
+        d2[k] = dx[k]*dx[k] + dy[k]*dy[k] + dz[k]*dz[k];
+    }
+    Scalar contact2 = (Scalar)contactDistance * contactDistance;
+    for(int k = 0; k < nCandidates; k++) {
+        if(d2[k] < contact2) {
+            first[nContacts] = a[k];
+            second[nContacts] = c[k];
+            nContacts++;
+        }
+    }
+    if(nContacts == 0) {
+        return;
+    }
+
+    //Response: every pair in contact is pushed apart along the line between the masses, in proportion to their
+    //inverse weights, and the velocity with which they approach each other is reflected. The pairs are handled
+    //one after the other in the order the grid found them, so a mass in several contacts sees the earlier pushes
+    bodyMoved.assign(bodies.size(), 0);
+    for(int k = 0; k < nContacts; k++) {
+        int i = first[k];
+        int j = second[k];
+        Accumulator w = invMass[i] + invMass[j];
+        if(w <= 0) {
+            continue;
+        }
+        Accumulator dx = (Accumulator)x[i] - x[j];
+        Accumulator dy = (Accumulator)y[i] - y[j];
+        Accumulator dz = (Accumulator)z[i] - z[j];
+        Accumulator d = std::sqrt(dx*dx + dy*dy + dz*dz);
+        if(d >= contactDistance) {
+            continue;
+        }
+        //Masses at the same position are separated vertically
+        Accumulator nx = 0, ny = 1, nz = 0;
+        if(d > 1e-6f * contactDistance) {
+            nx = dx / d;
+            ny = dy / d;
+            nz = dz / d;
+        }
+        bodyMoved[massBody[i]] = 1;
+        bodyMoved[massBody[j]] = 1;
+        Accumulator correction = (contactDistance - d) / w;
+        x[i] = (Scalar)(x[i] + invMass[i] * correction * nx);
+        y[i] = (Scalar)(y[i] + invMass[i] * correction * ny);
+        z[i] = (Scalar)(z[i] + invMass[i] * correction * nz);
+        x[j] = (Scalar)(x[j] - invMass[j] * correction * nx);
+        y[j] = (Scalar)(y[j] - invMass[j] * correction * ny);
+        z[j] = (Scalar)(z[j] - invMass[j] * correction * nz);
+
+        Accumulator approach = (vx[i] - vx[j]) * nx + (vy[i] - vy[j]) * ny + (vz[i] - vz[j]) * nz;
+        if(approach < 0) {
+            Accumulator impulse = -(1 + contactRestitution) * approach / w;
+            vx[i] = (Scalar)(vx[i] + invMass[i] * impulse * nx);
+            vy[i] = (Scalar)(vy[i] + invMass[i] * impulse * ny);
+            vz[i] = (Scalar)(vz[i] + invMass[i] * impulse * nz);
+            vx[j] = (Scalar)(vx[j] - invMass[j] * impulse * nx);
+            vy[j] = (Scalar)(vy[j] - invMass[j] * impulse * ny);
+            vz[j] = (Scalar)(vz[j] - invMass[j] * impulse * nz);
+        }
+    }
+
+    //Only the bodies a contact moved are copied back, and their accelerations kept by velocity Verlet belong to
+    //the state before the contacts
+    offset = 0;
+    for(size_t b = 0; b < bodies.size(); b++) {
+        BasicParticleSystem<Precision>& particles = bodies[b]->particles;
+        int count = particles.nParticles;
+        if(!bodyMoved[b]) {
+            offset += count;
+            continue;
+        }
+        bodies[b]->integratorScratch.accelerationsValid = false;
+        memcpy(particles.x, &x[offset], count * sizeof(Scalar));
+        memcpy(particles.y, &y[offset], count * sizeof(Scalar));
+        memcpy(particles.z, &z[offset], count * sizeof(Scalar));
+        memcpy(particles.vx, &vx[offset], count * sizeof(Scalar));
+        memcpy(particles.vy, &vy[offset], count * sizeof(Scalar));
+        memcpy(particles.vz, &vz[offset], count * sizeof(Scalar));
+        offset += count;
+    }
+}
+
+//Function to record the positions of the masses of all bodies as a frame
+template<class Precision>
+void BasicScene<Precision>::record(TrajectoryWriter& writer) const {
+    int offset = 0;
+    for(size_t b = 0; b < bodies.size(); b++) {
+        const BasicParticleSystem<Precision>& particles = bodies[b]->particles;
+        writer.setPositions(offset, particles.x, particles.y, particles.z, particles.nParticles);
+        offset += particles.nParticles;
+    }
+    writer.endFrame();
+}
+
+//Function to set the positions of the masses of all bodies to a recorded frame
+template<class Precision>
+bool BasicScene<Precision>::replay(TrajectoryReader& reader, int frame){
+    int n = massCount();
+    if(reader.nMasses != n) {
+        return false;
+    }
+    x.resize(n); y.resize(n); z.resize(n);
+    if(!reader.readFrame(frame, &x[0], &y[0], &z[0])) {
+        return false;
+    }
+    int offset = 0;
+    for(size_t b = 0; b < bodies.size(); b++) {
+        BasicParticleSystem<Precision>& particles = bodies[b]->particles;
+        int count = particles.nParticles;
+        memcpy(particles.x, &x[offset], count * sizeof(Scalar));
+        memcpy(particles.y, &y[offset], count * sizeof(Scalar));
+        memcpy(particles.z, &z[offset], count * sizeof(Scalar));
+        offset += count;
+    }
+    return true;
+}
+
+//The precisions the class is compiled for
+template class BasicScene<FloatPrecision>;
+template class BasicScene<DoublePrecision>;
+template class BasicScene<MixedPrecision>;
@@ -0,0 +1,84 @@
+//  Scene.hpp
+// Class for a scene of several soft bodies that collide with each other.
+// Every step the bodies are simulated on their own, each colliding with the static colliders of the scene, then the
+// collisions between masses are resolved: the masses of all bodies are put in a spatial hash, the candidate pairs
+// it finds are tested for contact, and masses in contact are pushed apart to the contact distance and lose the velocity with which they approach each other. This works
+// with every integration method, since it only changes positions and velocities after the step.
+// Masses are points, so bodies only collide where their masses meet: the contact distance should be about the
+// distance between neighbouring masses of the bodies.
+// The class is a template on the precision of its bodies, see Precision.hpp. Scene is the scene of floats.
+
+#ifndef Scene_hpp
+#define Scene_hpp
+
+#include <vector>
+
+#include "SoftBody.hpp"
+#include "SpatialHash.hpp"
+#include "TrajectoryWriter.hpp"
+#include "TrajectoryReader.hpp"
+
+template<class Precision>
+class BasicScene {
+public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    std::vector<BasicSoftBody<Precision>*> bodies;  // The bodies of the scene, owned by the scene
+    ColliderSet colliders;          // The static colliders all bodies collide with
+    float contactDistance;          // Masses closer than this are in contact, zero turns the collisions off
+    float contactRestitution;       // The part of the approaching velocity kept when two masses collide
+    bool selfCollision;             // If masses of the same body collide with each other
+    int nCandidates;                // Number of pairs found by the spatial hash in the last step
+    int nContacts;                  // Number of pairs in contact in the last step
+
+    //Constructor
+    BasicScene();
+    //Destructor, deletes the bodies
+    ~BasicScene();
+
+    //Function to add an empty body, colliding with the colliders of the scene, and return it
+    BasicSoftBody<Precision>& addBody();
+
+    //Function to place the bodies, all created around the origin, in a square of columns distance apart, and fill
+    //the columns layer by layer. Returns half the width of the square
+    float arrange(float distance);
+
+    //Function to return the number of masses of all bodies
+    int massCount() const;
+
+    //Function to return the number of springs of all bodies
+    int springCount() const;
+
+    //Function to simulate all bodies one step and resolve the collisions between their masses
+    void step(Accumulator dt);
+
+    //Function to find the masses in contact and push them apart
+    void collide();
+
+    //Function to record the positions of the masses of all bodies, one body after the other, as a frame
+    void record(TrajectoryWriter& writer) const;
+
+    //Function to set the positions of the masses of all bodies to a recorded frame. The velocities are not changed.
+    //Returns false if the frame could not be read or was recorded from a scene with another number of masses
+    bool replay(TrajectoryReader& reader, int frame);
+
+private:
+    SpatialHash grid;               // The broad phase
+    std::vector<Scalar> x, y, z;    // Positions of the masses of all bodies
+    std::vector<Scalar> vx, vy, vz; // Velocities of the masses of all bodies
+    std::vector<Scalar> invMass;    // Inverse weights of the masses of all bodies
+    std::vector<int> massBody;      // The body of every mass
+    std::vector<int> first, second; // Candidate pairs, then the pairs in contact
+    std::vector<Scalar> pairDx, pairDy, pairDz; // Difference of the positions of every candidate pair
+    std::vector<Scalar> distance2;  // Squared distance of every candidate pair
+    std::vector<char> bodyMoved;    // Whether a contact moved the masses of each body
+
+    //Copying a scene is not allowed
+    BasicScene(const BasicScene&);
+    BasicScene& operator=(const BasicScene&);
+};
+
+typedef BasicScene<FloatPrecision> Scene;
+
+#endif /* Scene_hpp */
@@ -1,4 +1,20 @@
 #include "Shader.hpp"
+#include "MappedFile.hpp" // To read the program binary cache
+#include "MeshCache.hpp"  // For MeshCache::hash()
+
+#include <cstring>
+
+// The header of a program binary cache file, followed by the binary
+static const char PROGRAM_CACHE_MAGIC[8] = { 'B', '3', 'D', 'P', 'R', 'O', 'G', 0 };
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char magic[8];      // "B3DPROG" followed by a zero
+    uint32_t version;   // PROGRAM_CACHE_VERSION
+    GLenum format;      // Binary format, from glGetProgramBinary()
+    uint64_t key;       // Hash of the sources and the vendor, renderer and version strings
+    uint64_t size;      // Size of the binary in bytes
+};
 
 /*
  * Constructor without arguments.
@@ -7,6 +23,11 @@
 
 Shader::Shader() {
     this->programID = 0;
+    cached = false;
+    vertexShader = 0;
+    fragmentShader = 0;
+    cacheKey = 0;
+    parallelCompile = false;
 }
 
 
@@ -17,6 +38,12 @@ Shader::Shader() {
  * assembles the shader program.
  */
 Shader::Shader(const char *vertexshaderfile, const char *fragmentshaderfile) {
+    this->programID = 0;
+    cached = false;
+    vertexShader = 0;
+    fragmentShader = 0;
+    cacheKey = 0;
+    parallelCompile = false;
     this->createShader(vertexshaderfile, fragmentshaderfile);
 }
 
@@ -26,6 +53,10 @@ Shader::Shader(const char *vertexshaderfile, const char *fragmentshaderfile) {
  * Cleans up by deleting the program if it was compiled.
  */
 Shader::~Shader() {
+    if(vertexShader != 0)
+        glDeleteShader(vertexShader);
+    if(fragmentShader != 0)
+        glDeleteShader(fragmentShader);
     if(programID != 0)
         glDeleteProgram(programID);
 }
@@ -35,29 +66,66 @@ Shader::~Shader() {
  * createShader() - create, load, compile and link the GLSL Shader objects.
  */
 void Shader::createShader(const char *vertexshaderfile, const char *fragmentshaderfile) {
+    beginShader(vertexshaderfile, fragmentshaderfile);
+    finishShader();
+}
+
+
+/*
+ * beginShader() - start loading a program. The program binary cache is
+ * tried first. On a miss the shaders are compiled and linked, but their
+ * status is not asked for until finishShader(), since asking makes the
+ * driver finish the work at once instead of in the background.
+ */
+void Shader::beginShader(const char *vertexshaderfile, const char *fragmentshaderfile) {
 
-    GLuint programObject;
-    GLuint vertexShader;
-    GLuint fragmentShader;
     const char *vertexShaderStrings[1];
     const char *fragmentShaderStrings[1];
 	unsigned char *vertexShaderAssembly;
 	unsigned char *fragmentShaderAssembly;
 
-
-    GLint vertexCompiled;
-    GLint fragmentCompiled;
-    GLint shadersLinked;
-    char str[4096]; // For error messages from the GLSL compiler and linker
-
     // If a program is already stored in this object, delete it
+    if(vertexShader != 0)
+        glDeleteShader(vertexShader);
+    if(fragmentShader != 0)
+        glDeleteShader(fragmentShader);
+    vertexShader = 0;
+    fragmentShader = 0;
     if(programID != 0)
         glDeleteProgram(programID);
+    programID = 0;
+    uniforms.clear();
+    cached = false;
+    enableParallelCompile();
+
+    vertexShaderAssembly = readShaderFile(vertexshaderfile);
+    fragmentShaderAssembly = readShaderFile(fragmentshaderfile);
+
+    // The key of the cache: the sources and the driver that compiled them
+    std::string key;
+    if(vertexShaderAssembly)
+        key += (char*)vertexShaderAssembly;
+    key += '\0';
+    if(fragmentShaderAssembly)
+        key += (char*)fragmentShaderAssembly;
+    key += '\0';
+    key += (const char*)glGetString(GL_VENDOR);
+    key += '\0';
+    key += (const char*)glGetString(GL_RENDERER);
+    key += '\0';
+    key += (const char*)glGetString(GL_VERSION);
+    cacheKey = MeshCache::hash(key.data(), key.size());
+    cacheFilename = programCacheFilename(vertexshaderfile, fragmentshaderfile);
+
+    if(vertexShaderAssembly && fragmentShaderAssembly && loadProgramBinary()) {
+        delete[] vertexShaderAssembly;
+        delete[] fragmentShaderAssembly;
+        cached = true;
+        return;
+    }
 
     // Create the vertex shader.
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
-
-    vertexShaderAssembly = readShaderFile(vertexshaderfile);
     if(vertexShaderAssembly) { // Don't try to use a NULL pointer
         vertexShaderStrings[0] = (char*)vertexShaderAssembly;
         glShaderSource(vertexShader, 1, vertexShaderStrings, NULL);
@@ -65,18 +133,8 @@ void Shader::createShader(const char *vertexshaderfile, const char *fragmentshad
         delete[] vertexShaderAssembly;
     }
 
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS,
-                               &vertexCompiled);
-    if(vertexCompiled  == GL_FALSE)
-  	{
-        glGetShaderInfoLog(vertexShader, sizeof(str), NULL, str);
-        printError("Vertex shader compile error", str);
-  	}
-
   	// Create the fragment shader.
     fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    fragmentShaderAssembly = readShaderFile(fragmentshaderfile);
     if(fragmentShaderAssembly) { // Don't try to use a NULL pointer
     	fragmentShaderStrings[0] = (char*)fragmentShaderAssembly;
         glShaderSource(fragmentShader, 1, fragmentShaderStrings, NULL);
@@ -84,31 +142,300 @@ void Shader::createShader(const char *vertexshaderfile, const char *fragmentshad
         delete[] fragmentShaderAssembly;
     }
 
-    glGetProgramiv(fragmentShader, GL_COMPILE_STATUS, &fragmentCompiled);
-    if(fragmentCompiled == GL_FALSE)
-   	{
-        glGetShaderInfoLog(fragmentShader, sizeof(str), NULL, str);
-        printError("Fragment shader compile error", str);
+    // Create a program object, attach the two shaders and link it.
+    programID = glCreateProgram();
+    glAttachShader(programID, vertexShader);
+    glAttachShader(programID, fragmentShader);
+    if(programBinarySupported())
+        glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(programID);
+}
+
+
+/*
+ * isReady() - true when the program started by beginShader() can be
+ * finished without waiting. Without KHR_parallel_shader_compile there
+ * is no way to tell, so the answer is always true.
+ */
+bool Shader::isReady() {
+    if(cached || vertexShader == 0 || !parallelCompile)
+        return true;
+    GLint done = GL_TRUE;
+    glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+
+/*
+ * finishShader() - wait for the program started by beginShader(), print
+ * the errors of the compiler and linker, and save the program in the
+ * cache if it was compiled from source.
+ */
+void Shader::finishShader() {
+
+    GLint vertexCompiled;
+    GLint fragmentCompiled;
+    GLint shadersLinked;
+    char str[4096]; // For error messages from the GLSL compiler and linker
+
+    if(vertexShader != 0) {
+        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &vertexCompiled);
+        if(vertexCompiled  == GL_FALSE)
+      	{
+            glGetShaderInfoLog(vertexShader, sizeof(str), NULL, str);
+            printError("Vertex shader compile error", str);
+      	}
+
+        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &fragmentCompiled);
+        if(fragmentCompiled == GL_FALSE)
+       	{
+            glGetShaderInfoLog(fragmentShader, sizeof(str), NULL, str);
+            printError("Fragment shader compile error", str);
+        }
+
+        glGetProgramiv(programID, GL_LINK_STATUS, &shadersLinked);
+        if(shadersLinked == GL_FALSE)
+    	{
+    		glGetProgramInfoLog( programID, sizeof(str), NULL, str );
+    		printError("Program object linking error", str);
+    	}
+    	glDeleteShader(vertexShader);   // After successful linking,
+    	glDeleteShader(fragmentShader); // these are no longer needed
+        vertexShader = 0;
+        fragmentShader = 0;
+
+        if(shadersLinked == GL_TRUE)
+            saveProgramBinary();
+    }
+
+	reflectUniforms();
+}
+
+
+/*
+ * enableParallelCompile() - let the driver compile on as many threads as
+ * it likes, if it has KHR_parallel_shader_compile or the ARB version.
+ * The extension is looked up once, for the current context.
+ */
+void Shader::enableParallelCompile() {
+    static bool checked = false;
+    static bool supported = false;
+    if(!checked) {
+        checked = true;
+        MaxShaderCompilerThreadsProc maxThreads = NULL;
+        if(glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        else if(glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        if(maxThreads) {
+            maxThreads(0xFFFFFFFF); // As many threads as the driver wants
+            supported = true;
+        }
+    }
+    parallelCompile = supported;
+}
+
+
+/*
+ * programBinarySupported() - true if the driver can save and load
+ * programs in at least one binary format.
+ */
+bool Shader::programBinarySupported() {
+#ifdef __WIN32__
+    if(!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+        return false;
+#endif
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+
+/*
+ * programCacheFilename() - the cache of a program is next to its vertex
+ * shader, named after both shaders: Vertex.glsl and Fragment.glsl give
+ * Vertex-Fragment.b3dprog.
+ */
+std::string Shader::programCacheFilename(const char *vertexshaderfile, const char *fragmentshaderfile) {
+    std::string vertexName(vertexshaderfile);
+    std::string fragmentName(fragmentshaderfile);
+    size_t slash = fragmentName.find_last_of("/\\");
+    if(slash != std::string::npos)
+        fragmentName.erase(0, slash + 1);
+    size_t dot = fragmentName.find_last_of('.');
+    if(dot != std::string::npos)
+        fragmentName.erase(dot);
+    slash = vertexName.find_last_of("/\\");
+    dot = vertexName.find_last_of('.');
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        vertexName.erase(dot);
+    return vertexName + "-" + fragmentName + ".b3dprog";
+}
+
+
+/*
+ * loadProgramBinary() - load the program from the cache if the cache was
+ * made from the same sources by the same driver. The driver may still
+ * refuse the binary, for example after an update that kept the version
+ * string, and then the program is compiled from source instead.
+ */
+bool Shader::loadProgramBinary() {
+    if(!programBinarySupported())
+        return false;
+    MappedFile file;
+    if(!file.open(cacheFilename.c_str()))
+        return false;
+    ProgramCacheHeader header;
+    if(file.size < sizeof(header))
+        return false;
+    memcpy(&header, file.data, sizeof(header));
+    if(memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0
+       || header.version != PROGRAM_CACHE_VERSION || header.key != cacheKey
+       || header.size != file.size - sizeof(header))
+        return false;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, file.data + sizeof(header), (GLsizei)header.size);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if(linked == GL_FALSE) {
+        glDeleteProgram(program);
+        return false;
+    }
+    programID = program;
+    return true;
+}
+
+
+/*
+ * saveProgramBinary() - save the linked program in the cache. The file is
+ * written under a temporary name and then renamed, so a program that is
+ * loading it at the same time never sees half a file. A cache that can
+ * not be written only costs the compilation the next time.
+ */
+void Shader::saveProgramBinary() {
+    if(!programBinarySupported())
+        return;
+    GLint length = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+    std::vector<char> binary(length);
+    ProgramCacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.format = 0;
+    header.key = cacheKey;
+    GLsizei written = 0;
+    glGetProgramBinary(programID, length, &written, &header.format, &binary[0]);
+    if(written <= 0)
+        return;
+    header.size = (uint64_t)written;
+
+    std::string temporary = cacheFilename + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if(file == NULL)
+        return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(&binary[0], 1, written, file) == (size_t)written;
+    ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    if(ok)
+        remove(cacheFilename.c_str());
+#endif
+    if(!ok || rename(temporary.c_str(), cacheFilename.c_str()) != 0)
+        remove(temporary.c_str());
+}
+
+
+/*
+ * reflectUniforms() - ask OpenGL once for the name, type and location
+ * of every active uniform, so they are not looked up again every frame.
+ */
+void Shader::reflectUniforms() {
+
+    GLint count = 0;
+    char name[256];
+
+    uniforms.clear();
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+    for(GLint i = 0; i < count; i++) {
+        ShaderUniform uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(programID, i, sizeof(name), &length, &uniform.size, &uniform.type, name);
+        uniform.name.assign(name, length);
+        // Arrays are listed as "name[0]"
+        size_t bracket = uniform.name.find('[');
+        if(bracket != std::string::npos)
+            uniform.name.erase(bracket);
+        uniform.location = glGetUniformLocation(programID, name);
+        uniforms.push_back(uniform);
+    }
+}
+
+
+/*
+ * findUniform() - find an active uniform by name
+ */
+const ShaderUniform* Shader::findUniform(const char *name) const {
+    for(size_t i = 0; i < uniforms.size(); i++) {
+        if(uniforms[i].name == name)
+            return &uniforms[i];
     }
+    return NULL;
+}
 
-    // Create a program object and attach the two compiled shaders.
-    programObject = glCreateProgram();
-    glAttachShader(programObject, vertexShader);
-    glAttachShader(programObject, fragmentShader);
 
-    // Link the program object and print out the info log.
-    glLinkProgram(programObject);
-    glGetProgramiv(programObject, GL_LINK_STATUS, &shadersLinked);
+/*
+ * typedLocation() - the location of a uniform, or -1 if it is not active.
+ * A uniform with another type is an error in the program, so it is
+ * reported instead of being set with the wrong glUniform*() function.
+ */
+GLint Shader::typedLocation(const char *name, const GLenum *types, int ntypes) const {
+    const ShaderUniform *uniform = findUniform(name);
+    if(!uniform)
+        return -1;
+    for(int i = 0; i < ntypes; i++) {
+        if(uniform->type == types[i])
+            return uniform->location;
+    }
+    printError("Uniform has another type", name);
+    return -1;
+}
 
-    if(shadersLinked == GL_FALSE)
-	{
-		glGetProgramInfoLog( programObject, sizeof(str), NULL, str );
-		printError("Program object linking error", str);
-	}
-	glDeleteShader(vertexShader);   // After successful linking,
-	glDeleteShader(fragmentShader); // these are no longer needed
 
-	programID = programObject; // Save this value in the class variable
+UniformFloat Shader::floatUniform(const char *name) const {
+    const GLenum types[] = { GL_FLOAT };
+    UniformFloat handle = { typedLocation(name, types, 1) };
+    return handle;
+}
+
+
+UniformInt Shader::intUniform(const char *name) const {
+    // Samplers are set with glUniform1i() too
+    const GLenum types[] = { GL_INT, GL_BOOL, GL_SAMPLER_2D, GL_SAMPLER_3D, GL_SAMPLER_CUBE, GL_SAMPLER_BUFFER };
+    UniformInt handle = { typedLocation(name, types, 6) };
+    return handle;
+}
+
+
+UniformMat4 Shader::mat4Uniform(const char *name) const {
+    const GLenum types[] = { GL_FLOAT_MAT4 };
+    UniformMat4 handle = { typedLocation(name, types, 1) };
+    return handle;
+}
+
+
+/*
+ * bindUniformBlock() - connect a uniform block to a binding point
+ */
+bool Shader::bindUniformBlock(const char *name, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(programID, name);
+    if(index == GL_INVALID_INDEX)
+        return false;
+    glUniformBlockBinding(programID, index, binding);
+    return true;
 }
 
 
@@ -117,7 +444,7 @@ void Shader::createShader(const char *vertexshaderfile, const char *fragmentshad
  * printError() - Signal an error.
  * Simple printf() to console for portability.
  */
-void Shader::printError(const char *errtype, const char *errmsg) {
+void Shader::printError(const char *errtype, const char *errmsg) const {
   fprintf(stderr, "%s: %s\n", errtype, errmsg);
 }
 
@@ -2,7 +2,15 @@
 /* A class to load and compile GLSL shaders from files. */
 /* Usage: call createShader() to load and compile a program object,
  * or use the constructor with two file name arguments.
- * Call glUseProgram() with the public member programID as argument. */
+ * Call glUseProgram() with the public member programID as argument.
+ * The active uniforms are listed once after linking. Get a typed handle
+ * to one with floatUniform(), intUniform() or mat4Uniform() before the
+ * render loop, and set it through the handle while the program is in use.
+ * Uniform blocks are connected to a binding point with bindUniformBlock().
+ * Linked programs are saved with glGetProgramBinary() in a .b3dprog file
+ * next to the vertex shader, and loaded from it the next time if the
+ * sources and the driver are the same. To compile several programs at
+ * once, call beginShader() for all of them, then finishShader(). */
 /* Stefan Gustavson (stefan.gustavson@liu.se) 2014-03-27 */
 
 #ifndef SHADER_HPP // Avoid including this header twice
@@ -15,12 +23,53 @@
 #include <GLFW/glfw3.h>
 #include "Utilities.hpp" // For OpenGL extensions
 #include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// From KHR_parallel_shader_compile, which headers may not have
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifdef _WIN32
+typedef void (__stdcall *MaxShaderCompilerThreadsProc)(GLuint count);
+#else
+typedef void (*MaxShaderCompilerThreadsProc)(GLuint count);
+#endif
+
+/* An active uniform variable of a program */
+struct ShaderUniform {
+    std::string name;   // Name, without the "[0]" of arrays
+    GLenum type;        // Type, such as GL_FLOAT or GL_FLOAT_MAT4
+    GLint size;         // Number of elements of an array, 1 otherwise
+    GLint location;     // Location, -1 for members of uniform blocks
+};
+
+/* Typed handles to uniform variables. set() changes the value in the
+ * program in use. The handle of a uniform that is not active has
+ * location -1, and set() then does nothing. */
+struct UniformFloat {
+    GLint location;
+    void set(GLfloat value) const { glUniform1f(location, value); }
+};
+
+struct UniformInt {
+    GLint location;
+    void set(GLint value) const { glUniform1i(location, value); }
+};
+
+struct UniformMat4 {
+    GLint location;
+    void set(const GLfloat *value) const { glUniformMatrix4fv(location, 1, GL_FALSE, value); }
+};
 
 class Shader {
 
 public:
 
 GLuint programID;
+std::vector<ShaderUniform> uniforms; // The active uniforms, listed after linking
+bool cached; // True if the program was loaded from the program binary cache
 
 /* Argument-less constructor. Creates an invalid shader program. */
 Shader();
@@ -36,8 +85,61 @@ Shader(const char *vertexshaderfile, const char *fragmentshaderfile);
  */
 void createShader(const char *vertexshaderfile, const char *fragmentshaderfile);
 
+/*
+ * beginShader() - start loading a program, from the cache or by compiling
+ * and linking the sources in the background if the driver can.
+ */
+void beginShader(const char *vertexshaderfile, const char *fragmentshaderfile);
+
+/*
+ * isReady() - true if finishShader() would not have to wait.
+ */
+bool isReady();
+
+/*
+ * finishShader() - wait for the program, report errors and save it in
+ * the cache. The program can be used after this.
+ */
+void finishShader();
+
+/* Find an active uniform by name. Returns NULL if there is none. */
+const ShaderUniform* findUniform(const char *name) const;
+
+/* Typed handles to uniforms. An error is printed if the uniform has
+ * another type. */
+UniformFloat floatUniform(const char *name) const;
+UniformInt intUniform(const char *name) const;
+UniformMat4 mat4Uniform(const char *name) const;
+
+/* Connect the uniform block with the given name to a binding point,
+ * where a UniformBuffer provides its data. Returns false if the program
+ * has no such block. */
+bool bindUniformBlock(const char *name, GLuint binding);
+
 private:
 
+/*
+ * reflectUniforms() - list the active uniforms after linking
+ */
+void reflectUniforms();
+
+/*
+ * typedLocation() - the location of a uniform if it has one of the types
+ */
+GLint typedLocation(const char *name, const GLenum *types, int ntypes) const;
+
+GLuint vertexShader;       // Shaders being compiled between beginShader() and finishShader(), or 0
+GLuint fragmentShader;
+uint64_t cacheKey;         // Hash of the sources and the driver
+std::string cacheFilename; // Name of the cache file of the program
+bool parallelCompile;      // True if the driver compiles in the background
+
+void enableParallelCompile();
+static bool programBinarySupported();
+static std::string programCacheFilename(const char *vertexshaderfile, const char *fragmentshaderfile);
+bool loadProgramBinary();
+void saveProgramBinary();
+
 /*
  * Override the Win32 filelength() function with
  * a version that takes a Unix-style file handle as
@@ -51,7 +153,7 @@ long filelength(FILE *file);
  */
 unsigned char* readShaderFile(const char *filename);
 
-void printError(const char *errtype, const char *errmsg);
+void printError(const char *errtype, const char *errmsg) const;
 
 };
 
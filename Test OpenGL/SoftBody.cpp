@@ -0,0 +1,211 @@
+//  SoftBody.cpp
+// Class for a soft body: the masses of the body and the network of springs and dampers connecting them.
+
+#include "SoftBody.hpp"
+#include "Profiler.hpp"
+
+#include <cstring>
+
+//Constructor
+template<class Precision>
+BasicSoftBody<Precision>::BasicSoftBody(){
+    colliders = NULL;
+    threadPool = NULL;
+    method = SYMPLECTIC_EULER;
+}
+
+//Function to create the 8 masses of a box
+template<class Precision>
+void BasicSoftBody<Precision>::createBox(float xsize, float ysize, float zsize, float xtrans, float ytrans, float ztrans, float weight){
+    particles.create(8, weight);
+    for(int i = 0; i < 8; i++) {
+        particles[i]->setStartPos((i & 1 ? xsize : -xsize) + xtrans,
+                                  (i & 2 ? ysize : -ysize) + ytrans,
+                                  (i & 4 ? zsize : -zsize) + ztrans);
+    }
+}
+
+//Function to create a lattice of masses and the springs connecting them
+template<class Precision>
+void BasicSoftBody<Precision>::createLattice(int nx, int ny, int nz, float spacing, float weight, float springConstant, float damperConstant){
+    particles.create(nx*ny*nz, weight);
+    for(int k = 0; k < nz; k++) {
+        for(int j = 0; j < ny; j++) {
+            for(int i = 0; i < nx; i++) {
+                particles[i + nx*(j + ny*k)]->setStartPos((i - 0.5f*(nx-1)) * spacing,
+                                                          (j - 0.5f*(ny-1)) * spacing,
+                                                          (k - 0.5f*(nz-1)) * spacing);
+            }
+        }
+    }
+    springs.createLattice(nx, ny, nz, spacing, springConstant, damperConstant, springConstant, damperConstant);
+}
+
+//Function to give every vertex the index of its mass. Vertices with bit-identical positions get the same mass,
+//found with a hash table with open addressing. Returns the number of masses
+static int weldVertices(const float* vertices, int nVertices, std::vector<int>& vertexMass, std::vector<int>& massVertex){
+    size_t tableSize = 16;
+    while(tableSize < 2 * (size_t)nVertices) {
+        tableSize *= 2;
+    }
+    size_t mask = tableSize - 1;
+    std::vector<int> table(tableSize, -1);
+    vertexMass.resize(nVertices);
+    massVertex.clear();
+    for(int i = 0; i < nVertices; i++) {
+        const float* position = &vertices[8*i];
+        unsigned bits[3];
+        memcpy(bits, position, sizeof(bits));
+        unsigned h = bits[0] * 0x9E3779B1u;
+        h = (h ^ bits[1]) * 0x85EBCA77u;
+        h = (h ^ bits[2]) * 0xC2B2AE3Du;
+        size_t slot = (h ^ h >> 16) & mask;
+        while(table[slot] >= 0 && memcmp(&vertices[8*massVertex[table[slot]]], position, sizeof(bits)) != 0) {
+            slot = (slot + 1) & mask;
+        }
+        if(table[slot] < 0) {
+            table[slot] = (int)massVertex.size();
+            massVertex.push_back(i);
+        }
+        vertexMass[i] = table[slot];
+    }
+    return (int)massVertex.size();
+}
+
+//Function to create the masses of a mesh, one per welded vertex
+template<class Precision>
+static void createMeshMasses(BasicParticleSystem<Precision>& particles, const float* vertices, int nVertices, float weight, std::vector<int>& vertexMass){
+    std::vector<int> massVertex;
+    int nMasses = weldVertices(vertices, nVertices, vertexMass, massVertex);
+    particles.create(nMasses, weight);
+    for(int i = 0; i < nMasses; i++) {
+        const float* position = &vertices[8*massVertex[i]];
+        particles[i]->setStartPos(position[0], position[1], position[2]);
+    }
+}
+
+//Function to create the masses and springs of a triangle mesh
+template<class Precision>
+void BasicSoftBody<Precision>::createFromMesh(const float* vertices, int nVertices, const unsigned* indices, int nTriangles,
+                                              float weight, const MeshSpringOptions& options){
+    createMeshMasses(particles, vertices, nVertices, weight, vertexMass);
+    std::vector<int> triangles(3 * (size_t)nTriangles);
+    for(size_t i = 0; i < triangles.size(); i++) {
+        triangles[i] = vertexMass[indices[i]];
+    }
+    springs.createFromMesh(particles, triangles.data(), nTriangles, options);
+}
+
+//Function to create the masses and springs of a mesh loaded through its cache
+template<class Precision>
+void BasicSoftBody<Precision>::createFromMesh(MeshCache& mesh, float weight, const MeshSpringOptions& options){
+    uint64_t springHash = MeshCache::hash((const char*)&options, sizeof(options));
+    createMeshMasses(particles, mesh.vertices, mesh.nVertices, weight, vertexMass);
+    if(mesh.nMasses == particles.nParticles && mesh.loadSprings(springs, NULL, springHash)) {
+        return;
+    }
+    createFromMesh(mesh.vertices, mesh.nVertices, mesh.indices, mesh.nTriangles, weight, options);
+    mesh.saveSprings(springs, vertexMass.data(), particles.nParticles, springHash);
+}
+
+//Function to scale and move the body so that it is centered at the origin and its largest side is size long
+template<class Precision>
+void BasicSoftBody<Precision>::fit(float size){
+    int n = particles.nParticles;
+    if(n == 0) {
+        return;
+    }
+    Scalar low[3] = { particles.x[0], particles.y[0], particles.z[0] };
+    Scalar high[3] = { low[0], low[1], low[2] };
+    for(int i = 1; i < n; i++) {
+        Scalar position[3] = { particles.x[i], particles.y[i], particles.z[i] };
+        for(int j = 0; j < 3; j++) {
+            low[j] = position[j] < low[j] ? position[j] : low[j];
+            high[j] = position[j] > high[j] ? position[j] : high[j];
+        }
+    }
+    Scalar largest = high[0] - low[0];
+    largest = high[1] - low[1] > largest ? high[1] - low[1] : largest;
+    largest = high[2] - low[2] > largest ? high[2] - low[2] : largest;
+    Scalar scale = largest > 0 ? size / largest : 1;
+    for(int i = 0; i < n; i++) {
+        particles.x[i] = (particles.x[i] - 0.5f * (low[0] + high[0])) * scale;
+        particles.y[i] = (particles.y[i] - 0.5f * (low[1] + high[1])) * scale;
+        particles.z[i] = (particles.z[i] - 0.5f * (low[2] + high[2])) * scale;
+    }
+    for(int i = 0; i < springs.nSprings; i++) {
+        springs.springLength[i] *= (float)scale;
+        springs.springMax[i] *= (float)scale;
+        springs.springMin[i] *= (float)scale;
+    }
+    integratorScratch.accelerationsValid = false;
+}
+
+//Function to move all masses of the body
+template<class Precision>
+void BasicSoftBody<Precision>::translate(float xtrans, float ytrans, float ztrans){
+    for(int i = 0; i < particles.nParticles; i++) {
+        particles.x[i] += xtrans;
+        particles.y[i] += ytrans;
+        particles.z[i] += ztrans;
+    }
+    integratorScratch.accelerationsValid = false;
+}
+
+//Function to simulate the body one step using the integration method of the body
+template<class Precision>
+void BasicSoftBody<Precision>::step(Accumulator dt){
+    switch(method) {
+        case VELOCITY_VERLET:
+            stepWith<VelocityVerlet>(dt);
+            break;
+        case RUNGE_KUTTA_4:
+            stepWith<RungeKutta4>(dt);
+            break;
+        case IMPLICIT_EULER:
+            implicitEuler.step(particles, springs, dt, threadPool);
+            integratorScratch.accelerationsValid = false;
+            collide();
+            break;
+        case XPBD:
+            xpbd.step(particles, springs, dt, threadPool);
+            integratorScratch.accelerationsValid = false;
+            collide();
+            break;
+        default:
+            stepWith<SymplecticEuler>(dt);
+            break;
+    }
+}
+
+//Function to return the name of an integration method
+template<class Precision>
+const char* BasicSoftBody<Precision>::methodName(IntegrationMethod method){
+    switch(method) {
+        case VELOCITY_VERLET:
+            return VelocityVerlet::name();
+        case RUNGE_KUTTA_4:
+            return RungeKutta4::name();
+        case IMPLICIT_EULER:
+            return "implicit Euler";
+        case XPBD:
+            return "XPBD";
+        default:
+            return SymplecticEuler::name();
+    }
+}
+
+//Function to push the masses out of the static colliders and bounce them
+template<class Precision>
+void BasicSoftBody<Precision>::collide(){
+    PROFILE_SCOPE("colliders");
+    //The masses that were pushed out and bounced no longer have the accelerations kept by velocity Verlet
+    if(colliders && colliders->collide(particles) > 0) {
+        integratorScratch.accelerationsValid = false;
+    }
+}
+
+//The precisions the class is compiled for
+template class BasicSoftBody<FloatPrecision>;
+template class BasicSoftBody<DoublePrecision>;
+template class BasicSoftBody<MixedPrecision>;
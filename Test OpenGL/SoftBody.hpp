@@ -0,0 +1,95 @@
+//  SoftBody.hpp
+// Class for a soft body: the masses of the body and the network of springs and dampers connecting them.
+// The class contains a function used to simulate the body one step, including the collisions with the static
+// colliders of the scene, such as the floor.
+// Each body is simulated with its own integration method: one of the explicit methods in Integrators.hpp, or the
+// implicit Euler method or XPBD for stiff bodies that should be simulated with large timesteps.
+// It does not depend on OpenGL, so it can be used both by the viewer and by the headless simulator.
+// The class is a template on the precision of its particle system, see Precision.hpp. SoftBody is the body of floats.
+
+#ifndef SoftBody_hpp
+#define SoftBody_hpp
+
+#include "ParticleSystem.hpp"
+#include "SpringNetwork.hpp"
+#include "ImplicitEuler.hpp"
+#include "Integrators.hpp"
+#include "XPBDSolver.hpp"
+#include "MeshCache.hpp"
+#include "ColliderSet.hpp"
+
+//Integration methods a body can be simulated with
+enum IntegrationMethod {
+    SYMPLECTIC_EULER,
+    VELOCITY_VERLET,
+    RUNGE_KUTTA_4,
+    IMPLICIT_EULER,
+    XPBD
+};
+
+template<class Precision>
+class BasicSoftBody {
+public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    BasicParticleSystem<Precision> particles;   // The masses of the body
+    SpringNetwork springs;      // The springs and dampers connecting the masses
+    const ColliderSet* colliders; // The static colliders the body collides with, or NULL
+    ThreadPool* threadPool;     // Threads used to evaluate the springs, or NULL to use only the calling thread
+    IntegrationMethod method;   // The integration method used by step()
+    BasicImplicitEuler<Precision> implicitEuler;    // The solver used by the implicit Euler method
+    BasicIntegratorScratch<Precision> integratorScratch; // Memory used by the explicit integration methods
+    BasicXPBDSolver<Precision> xpbd;    // The solver used by XPBD
+    std::vector<int> vertexMass;// The mass of every vertex of the mesh the body was created from
+
+    //Constructor
+    BasicSoftBody();
+
+    //Function to create the 8 masses of a box, in the same vertex order as TriangleSoup::createBox.
+    //The springs are created separately with springs.createBox()
+    void createBox(float xsize, float ysize, float zsize, float xtrans, float ytrans, float ztrans, float weight);
+
+    //Function to create a lattice of nx*ny*nz masses placed spacing apart, centered at the origin, and
+    //the springs connecting them
+    void createLattice(int nx, int ny, int nz, float spacing, float weight, float springConstant, float damperConstant);
+
+    //Function to create the masses and springs of a triangle mesh, given as vertices of 8 floats (position first)
+    //and 3 vertex indices per triangle. Vertices at the same position are welded into one mass, and vertexMass
+    //tells which mass each vertex belongs to
+    void createFromMesh(const float* vertices, int nVertices, const unsigned* indices, int nTriangles, float weight,
+                        const MeshSpringOptions& options);
+
+    //Function to create the masses and springs of a mesh loaded through its cache. The springs are taken from the
+    //cache if they were generated with the same options, otherwise they are generated and saved in the cache
+    void createFromMesh(MeshCache& mesh, float weight, const MeshSpringOptions& options);
+
+    //Function to scale and move the body so that it is centered at the origin and its largest side is size long.
+    //The rest lengths and limits of the springs are scaled with the body
+    void fit(float size);
+
+    //Function to move all masses of the body
+    void translate(float xtrans, float ytrans, float ztrans);
+
+    //Function to simulate the body one step using the integration method of the body
+    void step(Accumulator dt);
+
+    //Function to simulate the body one step with the integration method given as a template argument,
+    //e.g. stepWith<VelocityVerlet>(dt)
+    template<class Integrator>
+    void stepWith(Accumulator dt){
+        Integrator::step(particles, springs, dt, threadPool, integratorScratch);
+        collide();
+    }
+
+    //Function to return the name of an integration method
+    static const char* methodName(IntegrationMethod method);
+
+    //Function to push the masses out of the static colliders and bounce them
+    void collide();
+
+};
+
+typedef BasicSoftBody<FloatPrecision> SoftBody;
+
+#endif /* SoftBody_hpp */
@@ -0,0 +1,98 @@
+//  SpatialHash.cpp
+// Class for a uniform grid stored as a spatial hash, used as the broad phase of the collisions between masses.
+
+#include "SpatialHash.hpp"
+
+#include <cmath>
+
+//Constructor
+SpatialHash::SpatialHash(){
+    cellSize = 1.0f;
+    mask = 0;
+}
+
+//Function to pack the coordinates of a cell into one number. Cells more than 2^20 cells from the origin wrap around,
+//which only puts far apart masses in the same cell
+uint64_t SpatialHash::key(int x, int y, int z){
+    const uint64_t mask21 = (1u << 21) - 1;
+    return ((uint64_t)x & mask21) | ((uint64_t)y & mask21) << 21 | ((uint64_t)z & mask21) << 42;
+}
+
+//Function to return the bucket of a cell
+unsigned SpatialHash::bucket(uint64_t key) const {
+    key *= 0x9E3779B97F4A7C15ull;
+    return (unsigned)(key >> 32 ^ key >> 17) & mask;
+}
+
+//Function to put the masses in the grid: count the masses of every bucket, turn the counts into start indices
+//and place every mass at the next free index of its bucket. Masses keep their relative order within a bucket
+template<class T>
+void SpatialHash::build(const T* x, const T* y, const T* z, int n, float cellSize){
+    this->cellSize = cellSize;
+    unsigned nBuckets = 1;
+    while(nBuckets < (unsigned)n) {
+        nBuckets *= 2;
+    }
+    mask = nBuckets - 1;
+
+    float inverseSize = 1.0f / cellSize;
+    cell.resize(3 * n);
+    keys.resize(n);
+    bucketStart.assign(nBuckets + 1, 0);
+    for(int i = 0; i < n; i++) {
+        cell[3*i] = (int)floor(x[i] * inverseSize);
+        cell[3*i + 1] = (int)floor(y[i] * inverseSize);
+        cell[3*i + 2] = (int)floor(z[i] * inverseSize);
+        keys[i] = key(cell[3*i], cell[3*i + 1], cell[3*i + 2]);
+        bucketStart[bucket(keys[i]) + 1]++;
+    }
+    for(unsigned b = 0; b < nBuckets; b++) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    sorted.resize(n);
+    sortedKey.resize(n);
+    fill.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for(int i = 0; i < n; i++) {
+        int k = fill[bucket(keys[i])]++;
+        sorted[k] = i;
+        sortedKey[k] = keys[i];
+    }
+}
+
+//Function to find the candidate pairs. Every mass looks in its own cell for masses with a higher index, and in
+//13 of the 26 neighbouring cells, the ones that come after its cell in the order z, y, x, for all masses. Every
+//pair of neighbouring cells is then searched from one side only, so no pair is found twice. A bucket can hold
+//masses of other cells too, so only the masses really in the cell are taken. The cells of the masses of a bucket
+//are stored next to each other in sortedKey, so scanning a bucket reads memory in order
+void SpatialHash::findPairs(std::vector<int>& first, std::vector<int>& second, const int* group) const {
+    static const int neighbours[14][3] = {
+        { 0, 0, 0 },
+        { 1, 0, 0 },
+        { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+        { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+        { -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+        { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 }
+    };
+    int n = (int)sorted.size();
+    for(int i = 0; i < n; i++) {
+        int g = group ? group[i] : -1;
+        for(int m = 0; m < 14; m++) {
+            uint64_t k = key(cell[3*i] + neighbours[m][0], cell[3*i + 1] + neighbours[m][1], cell[3*i + 2] + neighbours[m][2]);
+            unsigned b = bucket(k);
+            for(int s = bucketStart[b]; s < bucketStart[b + 1]; s++) {
+                if(sortedKey[s] != k) {
+                    continue;
+                }
+                int j = sorted[s];
+                if((m > 0 || j > i) && (group == NULL || group[j] != g)) {
+                    first.push_back(i);
+                    second.push_back(j);
+                }
+            }
+        }
+    }
+}
+
+//The position types the grid is compiled for
+template void SpatialHash::build(const float*, const float*, const float*, int, float);
+template void SpatialHash::build(const double*, const double*, const double*, int, float);
@@ -0,0 +1,48 @@
+//  SpatialHash.hpp
+// Class for a uniform grid stored as a spatial hash, used as the broad phase of the collisions between masses.
+// Every mass is put in the cell of the grid it lies in, and the cells are hashed into a table with about one
+// bucket per mass. The table is rebuilt every step with a counting sort of the masses by bucket, so building it
+// and finding the pairs of nearby masses both take time linear in the number of masses.
+
+#ifndef SpatialHash_hpp
+#define SpatialHash_hpp
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+class SpatialHash {
+public:
+
+    float cellSize;                 // Side of a cell of the grid
+    std::vector<int> cell;          // The cell of every mass, 3 ints per mass
+    std::vector<int> bucketStart;   // Index in sorted of the first mass of every bucket, and the number of masses last
+    std::vector<int> sorted;        // The masses sorted by bucket
+    std::vector<uint64_t> sortedKey;// The cell of every mass in sorted, packed into one number by key()
+
+    //Constructor
+    SpatialHash();
+
+    //Function to put n masses in the grid. The cell size should be at least the distance at which masses interact.
+    //The positions are floats or doubles
+    template<class T>
+    void build(const T* x, const T* y, const T* z, int n, float cellSize);
+
+    //Function to find all pairs of masses in the same or neighbouring cells, the candidates for being closer than
+    //the cell size. The pairs are appended to first and second. If group is given, masses of the same group are
+    //not paired
+    void findPairs(std::vector<int>& first, std::vector<int>& second, const int* group = NULL) const;
+
+private:
+    unsigned mask;                  // The number of buckets minus one
+    std::vector<uint64_t> keys;     // The cell of every mass, packed
+    std::vector<int> fill;          // Next free index of every bucket while sorting
+
+    //Function to pack the coordinates of a cell into one number, 21 bits per coordinate
+    static uint64_t key(int x, int y, int z);
+
+    //Function to return the bucket of a cell
+    unsigned bucket(uint64_t key) const;
+};
+
+#endif /* SpatialHash_hpp */
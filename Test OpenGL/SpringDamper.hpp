@@ -1,36 +1,44 @@
 //  Spring.hpp
 // Class used to add the spring force and damper force of the two masses connected by the spring and
 // damper. The class contains a function used to simulate the system.
+// Like BasicMass, the class is a template on the precision, and SpringDamper connects two masses of floats. The
+// force is computed in the Accumulator type of the precision.
 
 
 #ifndef Spring_hpp
 #define Spring_hpp
 
 #include "Mass.hpp"
-#include "TriangleSoup.hpp"
 
-class SpringDamper {
+template<class Precision>
+class BasicSpringDamper {
 public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
     
-    Mass* mass1;            //One mass connected to the spring and damper
-    Mass* mass2;            //Another mass connected to the spring and damper.
-    Vector force;           //Vector to store the resulting force from the spring and damper acting on the masses
-    float springConstant;   //The spring constant
-    float springLength;     //The rest length of the spring
-    float springMax;        //The maximum length of the spring
-    float springMin;        //The minimum length of the spring
-    float damperConstant;   //The damper constant
-    float distance;         //The distance between two masses
+    BasicMass<Precision>* mass1;    //One mass connected to the spring and damper
+    BasicMass<Precision>* mass2;    //Another mass connected to the spring and damper.
+    BasicVector<Accumulator> force; //Vector to store the resulting force from the spring and damper acting on the masses
+    Scalar springConstant;          //The spring constant
+    Scalar springLength;            //The rest length of the spring
+    Scalar springMax;               //The maximum length of the spring
+    Scalar springMin;               //The minimum length of the spring
+    Scalar damperConstant;          //The damper constant
+    Accumulator distance;           //The distance between two masses
     
     //Constructor
-    SpringDamper(Mass* mass1, Mass* mass2, float springConstant, float springMax, float springMin, float springLength, float damperConstant);
+    BasicSpringDamper(BasicMass<Precision>* mass1, BasicMass<Precision>* mass2, Scalar springConstant, Scalar springMax,
+                      Scalar springMin, Scalar springLength, Scalar damperConstant);
     
     //Function to add the spring force and damper force to the Vector force
     void addSDForce();
 
     //Function to simulate the cubes position and velocity using the Euler method
-    void simulateEuler(float dt);
+    void simulateEuler(Scalar dt);
     
 };
 
+//The spring and damper between two masses of floats
+typedef BasicSpringDamper<FloatPrecision> SpringDamper;
+
 #endif /* Spring_hpp */
@@ -0,0 +1,530 @@
+//  SpringNetwork.cpp
+// Class that stores all springs and dampers of a body. The topology (which masses each spring connects) and
+// the parameters of every spring are kept in contiguous arrays.
+
+#include "SpringNetwork.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+//Constructor
+MeshSpringOptions::MeshSpringOptions(){
+    structuralConstant = 20.0f;
+    structuralDamper = 2.0f;
+    bendingConstant = 20.0f;
+    bendingDamper = 2.0f;
+    shearConstant = 20.0f;
+    shearDamper = 2.0f;
+    shearRadius = 0.0f;
+    maxFactor = 2.0f;
+    minFactor = 0.1f;
+}
+
+//A map from unordered pairs of masses to an int, stored as 64-bit keys in a hash table with open addressing.
+//Used to find the springs already created between two masses in constant time
+class MassPairMap {
+public:
+
+    //Constructor, makes room for the expected number of pairs
+    explicit MassPairMap(size_t expected){
+        size_t size = 16;
+        while(size < 2 * expected) {
+            size *= 2;
+        }
+        keys.assign(size, EMPTY);
+        values.resize(size);
+        count = 0;
+    }
+
+    //Function to return the value of a pair, or -1 if the pair is not in the map
+    int find(int a, int b) const {
+        uint64_t k = key(a, b);
+        size_t mask = keys.size() - 1;
+        for(size_t i = hash(k) & mask; keys[i] != EMPTY; i = (i + 1) & mask) {
+            if(keys[i] == k) {
+                return values[i];
+            }
+        }
+        return -1;
+    }
+
+    //Function to add a pair if it is not in the map. Returns the value of the pair in the map
+    int insert(int a, int b, int value){
+        uint64_t k = key(a, b);
+        size_t mask = keys.size() - 1;
+        size_t i = hash(k) & mask;
+        for(; keys[i] != EMPTY; i = (i + 1) & mask) {
+            if(keys[i] == k) {
+                return values[i];
+            }
+        }
+        keys[i] = k;
+        values[i] = value;
+        if(2 * ++count > keys.size()) {
+            grow();
+        }
+        return value;
+    }
+
+private:
+    static const uint64_t EMPTY = ~(uint64_t)0;
+    std::vector<uint64_t> keys;
+    std::vector<int> values;
+    size_t count;
+
+    //The smaller mass index goes in the high half, so (a, b) and (b, a) give the same key
+    static uint64_t key(int a, int b){
+        return a < b ? (uint64_t)a << 32 | (uint32_t)b : (uint64_t)b << 32 | (uint32_t)a;
+    }
+
+    static size_t hash(uint64_t k){
+        k *= 0x9E3779B97F4A7C15ULL;
+        return (size_t)(k ^ k >> 32);
+    }
+
+    //Function to double the size of the table
+    void grow(){
+        std::vector<uint64_t> oldKeys(2 * keys.size(), EMPTY);
+        std::vector<int> oldValues(2 * keys.size());
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        size_t mask = keys.size() - 1;
+        for(size_t j = 0; j < oldKeys.size(); j++) {
+            if(oldKeys[j] != EMPTY) {
+                size_t i = hash(oldKeys[j]) & mask;
+                while(keys[i] != EMPTY) {
+                    i = (i + 1) & mask;
+                }
+                keys[i] = oldKeys[j];
+                values[i] = oldValues[j];
+            }
+        }
+    }
+};
+
+const uint64_t MassPairMap::EMPTY;
+
+//Constructor
+SpringNetwork::SpringNetwork(){
+    nSprings = 0;
+    nColours = 0;
+    minParallelSprings = 4096;
+}
+
+//Function to remove all springs from the network
+void SpringNetwork::clean(){
+    mass1.clear();
+    mass2.clear();
+    springConstant.clear();
+    springLength.clear();
+    springMax.clear();
+    springMin.clear();
+    damperConstant.clear();
+    colourStart.clear();
+    nSprings = 0;
+    nColours = 0;
+}
+
+//Function to reserve memory for a number of springs
+void SpringNetwork::reserve(int capacity){
+    mass1.reserve(capacity);
+    mass2.reserve(capacity);
+    springConstant.reserve(capacity);
+    springLength.reserve(capacity);
+    springMax.reserve(capacity);
+    springMin.reserve(capacity);
+    damperConstant.reserve(capacity);
+}
+
+//Function to add a spring and damper between two masses
+int SpringNetwork::addSpring(int mass1, int mass2, float springConstant, float springMax, float springMin, float springLength, float damperConstant){
+    this->mass1.push_back(mass1);
+    this->mass2.push_back(mass2);
+    this->springConstant.push_back(springConstant);
+    this->springLength.push_back(springLength);
+    this->springMax.push_back(springMax);
+    this->springMin.push_back(springMin);
+    this->damperConstant.push_back(damperConstant);
+    nColours = 0;
+    return nSprings++;
+}
+
+//Function to create the springs of a box
+void SpringNetwork::createBox(float springConstant, float damperConstant, float springLength, float springMax, float springMin,
+                              float springConstDiag, float damperConstDiag){
+
+    //Index pairs of the masses connected by the springs
+    const int edges[12][2] = {
+        {0,1}, {2,3}, {4,5}, {6,7},     //x-direction
+        {0,2}, {1,3}, {4,6}, {5,7},     //y-direction
+        {0,4}, {1,5}, {2,6}, {3,7}      //z-direction
+    };
+    const int diagonals[12][2] = {
+        {0,3}, {1,2}, {4,7}, {5,6},     //Diagonals xy-plane
+        {0,5}, {1,4}, {2,7}, {3,6},     //Diagonals xz-plane
+        {0,6}, {2,4}, {1,7}, {3,5}      //Diagonals yz-plane
+    };
+
+    float springLengthDiag = sqrt(springLength*springLength*2);
+    float springMaxDiag = sqrt(springMax*springMax*2);
+    float springMinDiag = sqrt(springMin*springMin*2);
+
+    clean();
+    reserve(24);
+    for(int i = 0; i < 12; i++) {
+        addSpring(edges[i][0], edges[i][1], springConstant, springMax, springMin, springLength, damperConstant);
+    }
+    for(int i = 0; i < 12; i++) {
+        addSpring(diagonals[i][0], diagonals[i][1], springConstDiag, springMaxDiag, springMinDiag, springLengthDiag, damperConstDiag);
+    }
+    colourSprings();
+}
+
+//Function to create the springs of a lattice
+void SpringNetwork::createLattice(int nx, int ny, int nz, float spacing, float springConstant, float damperConstant,
+                                  float springConstDiag, float damperConstDiag){
+
+    float springLength = spacing;
+    float springLengthDiag = sqrt(spacing*spacing*2);
+
+    clean();
+    reserve(3*nx*ny*nz + 6*nx*ny*nz);
+    for(int k = 0; k < nz; k++) {
+        for(int j = 0; j < ny; j++) {
+            for(int i = 0; i < nx; i++) {
+                int m = i + nx*(j + ny*k);
+                int dx = 1, dy = nx, dz = nx*ny;
+                //Edges along the x-, y- and z-direction
+                if(i+1 < nx) addSpring(m, m+dx, springConstant, 2*springLength, 0.1f*springLength, springLength, damperConstant);
+                if(j+1 < ny) addSpring(m, m+dy, springConstant, 2*springLength, 0.1f*springLength, springLength, damperConstant);
+                if(k+1 < nz) addSpring(m, m+dz, springConstant, 2*springLength, 0.1f*springLength, springLength, damperConstant);
+                //Diagonals xy-plane
+                if(i+1 < nx && j+1 < ny) {
+                    addSpring(m, m+dx+dy, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                    addSpring(m+dx, m+dy, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                }
+                //Diagonals xz-plane
+                if(i+1 < nx && k+1 < nz) {
+                    addSpring(m, m+dx+dz, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                    addSpring(m+dx, m+dz, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                }
+                //Diagonals yz-plane
+                if(j+1 < ny && k+1 < nz) {
+                    addSpring(m, m+dy+dz, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                    addSpring(m+dy, m+dz, springConstDiag, 2*springLengthDiag, 0.1f*springLengthDiag, springLengthDiag, damperConstDiag);
+                }
+            }
+        }
+    }
+    colourSprings();
+}
+
+//Function to return the hash of a cell of the grid used to find the shear springs
+static inline unsigned hashCell(int x, int y, int z){
+    return (unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u;
+}
+
+//Function to create the springs of a triangle mesh. Every edge is looked up in a hash map of mass pairs, so the
+//time is linear in the number of triangles. The map also remembers the two triangles on each side of an edge,
+//whose opposite corners are connected by the bending spring. Shear springs are found with a uniform grid with
+//cells as large as the radius, stored in a hash table sorted by cell with a counting sort
+template<class Precision>
+void SpringNetwork::createFromMesh(const BasicParticleSystem<Precision>& particles, const int* triangles, int nTriangles,
+                                   const MeshSpringOptions& options){
+    typedef typename Precision::Scalar Scalar;
+    clean();
+    //A closed mesh has 3/2 edges per triangle, and as many bending springs as edges
+    MassPairMap pairs(3 * (size_t)nTriangles);
+
+    //The unique edges in the order they first appear, and the opposite corner of the first two triangles
+    //on each edge (-1 if there is none)
+    std::vector<int> edges;
+    std::vector<int> opposite;
+    for(int t = 0; t < nTriangles; t++) {
+        for(int e = 0; e < 3; e++) {
+            int a = triangles[3*t + e];
+            int b = triangles[3*t + (e + 1) % 3];
+            int c = triangles[3*t + (e + 2) % 3];
+            if(a == b) {
+                continue;
+            }
+            int nEdges = (int)edges.size() / 2;
+            int edge = pairs.insert(a, b, nEdges);
+            if(edge == nEdges) {
+                edges.push_back(a);
+                edges.push_back(b);
+                opposite.push_back(c);
+                opposite.push_back(-1);
+            }
+            else if(opposite[2*edge + 1] < 0 && c != opposite[2*edge]) {
+                opposite[2*edge + 1] = c;
+            }
+        }
+    }
+
+    const Scalar *x = particles.x, *y = particles.y, *z = particles.z;
+    int nEdges = (int)edges.size() / 2;
+    reserve(2 * nEdges);
+
+    //Structural springs along the edges. The spring index equals the edge index
+    for(int i = 0; i < nEdges; i++) {
+        int a = edges[2*i], b = edges[2*i + 1];
+        float length = (float)BasicVector<Scalar>(x[a] - x[b], y[a] - y[b], z[a] - z[b]).length();
+        addSpring(a, b, options.structuralConstant, options.maxFactor * length, options.minFactor * length,
+                  length, options.structuralDamper);
+    }
+
+    //Bending springs across the edges shared by two triangles
+    if(options.bendingConstant > 0.0f) {
+        for(int i = 0; i < nEdges; i++) {
+            int c = opposite[2*i], d = opposite[2*i + 1];
+            if(d < 0 || c == d || c == edges[2*i] || c == edges[2*i + 1] || d == edges[2*i] || d == edges[2*i + 1]) {
+                continue;
+            }
+            if(pairs.insert(c, d, nSprings) != nSprings) {
+                continue;
+            }
+            float length = (float)BasicVector<Scalar>(x[c] - x[d], y[c] - y[d], z[c] - z[d]).length();
+            addSpring(c, d, options.bendingConstant, options.maxFactor * length, options.minFactor * length,
+                      length, options.bendingDamper);
+        }
+    }
+
+    //Shear springs between all masses closer than the radius
+    int n = particles.nParticles;
+    if(options.shearRadius > 0.0f && options.shearConstant > 0.0f && n > 0) {
+        float radius = options.shearRadius;
+        float inverseRadius = 1.0f / radius;
+        size_t tableSize = 1;
+        while(tableSize < (size_t)n) {
+            tableSize *= 2;
+        }
+        unsigned mask = (unsigned)tableSize - 1;
+
+        //Sort the masses by the hash of their cell
+        std::vector<int> cell(3 * n);
+        std::vector<int> bucketStart(tableSize + 1, 0);
+        for(int i = 0; i < n; i++) {
+            cell[3*i] = (int)floor(x[i] * inverseRadius);
+            cell[3*i + 1] = (int)floor(y[i] * inverseRadius);
+            cell[3*i + 2] = (int)floor(z[i] * inverseRadius);
+            bucketStart[(hashCell(cell[3*i], cell[3*i + 1], cell[3*i + 2]) & mask) + 1]++;
+        }
+        for(size_t b = 0; b < tableSize; b++) {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+        std::vector<int> sorted(n);
+        for(int i = 0; i < n; i++) {
+            sorted[fill[hashCell(cell[3*i], cell[3*i + 1], cell[3*i + 2]) & mask]++] = i;
+        }
+
+        //Look for neighbours in the 27 cells around every mass. Different cells can share a bucket, so the
+        //distance decides, and the pair map removes duplicates
+        for(int i = 0; i < n; i++) {
+            for(int dz = -1; dz <= 1; dz++) {
+                for(int dy = -1; dy <= 1; dy++) {
+                    for(int dx = -1; dx <= 1; dx++) {
+                        unsigned b = hashCell(cell[3*i] + dx, cell[3*i + 1] + dy, cell[3*i + 2] + dz) & mask;
+                        for(int k = bucketStart[b]; k < bucketStart[b + 1]; k++) {
+                            int j = sorted[k];
+                            if(j <= i) {
+                                continue;
+                            }
+                            float length = (float)BasicVector<Scalar>(x[i] - x[j], y[i] - y[j], z[i] - z[j]).length();
+                            if(length > radius || length == 0.0f || pairs.insert(i, j, nSprings) != nSprings) {
+                                continue;
+                            }
+                            addSpring(i, j, options.shearConstant, options.maxFactor * length, options.minFactor * length,
+                                      length, options.shearDamper);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    colourSprings();
+}
+
+//Function to partition the springs into colours. Each spring gets the lowest colour not already used by a
+//spring sharing one of its masses. The number of colours is at most twice the largest number of springs
+//connected to one mass
+void SpringNetwork::colourSprings(){
+    int nMasses = 0;
+    for(int i = 0; i < nSprings; i++) {
+        nMasses = max(nMasses, max(mass1[i], mass2[i]) + 1);
+    }
+
+    //The springs connected to each mass, in compressed rows
+    vector<int> massStart(nMasses + 1, 0);
+    for(int i = 0; i < nSprings; i++) {
+        massStart[mass1[i] + 1]++;
+        massStart[mass2[i] + 1]++;
+    }
+    for(int m = 0; m < nMasses; m++) {
+        massStart[m + 1] += massStart[m];
+    }
+    vector<int> massSprings(massStart[nMasses]);
+    vector<int> fill(massStart.begin(), massStart.end() - 1);
+    for(int i = 0; i < nSprings; i++) {
+        massSprings[fill[mass1[i]]++] = i;
+        massSprings[fill[mass2[i]]++] = i;
+    }
+
+    //Greedy colouring. used[c] == i marks colour c as taken by a neighbour of spring i
+    vector<int> colour(nSprings, -1);
+    vector<int> used;
+    nColours = 0;
+    for(int i = 0; i < nSprings; i++) {
+        int ends[2] = { mass1[i], mass2[i] };
+        for(int e = 0; e < 2; e++) {
+            for(int j = massStart[ends[e]]; j < massStart[ends[e] + 1]; j++) {
+                int c = colour[massSprings[j]];
+                if(c >= 0) {
+                    used[c] = i;
+                }
+            }
+        }
+        int c = 0;
+        while(c < nColours && used[c] == i) {
+            c++;
+        }
+        if(c == nColours) {
+            nColours++;
+            used.push_back(-1);
+        }
+        colour[i] = c;
+    }
+
+    //Sort the springs by colour, keeping their relative order within each colour
+    colourStart.assign(nColours + 1, 0);
+    for(int i = 0; i < nSprings; i++) {
+        colourStart[colour[i] + 1]++;
+    }
+    for(int c = 0; c < nColours; c++) {
+        colourStart[c + 1] += colourStart[c];
+    }
+    vector<int> order(nSprings);
+    fill.assign(colourStart.begin(), colourStart.end() - 1);
+    for(int i = 0; i < nSprings; i++) {
+        order[fill[colour[i]]++] = i;
+    }
+    vector<int> newMass1(nSprings), newMass2(nSprings);
+    vector<float> newConstant(nSprings), newLength(nSprings), newMax(nSprings), newMin(nSprings), newDamper(nSprings);
+    for(int i = 0; i < nSprings; i++) {
+        newMass1[i] = mass1[order[i]];
+        newMass2[i] = mass2[order[i]];
+        newConstant[i] = springConstant[order[i]];
+        newLength[i] = springLength[order[i]];
+        newMax[i] = springMax[order[i]];
+        newMin[i] = springMin[order[i]];
+        newDamper[i] = damperConstant[order[i]];
+    }
+    mass1.swap(newMass1);
+    mass2.swap(newMass2);
+    springConstant.swap(newConstant);
+    springLength.swap(newLength);
+    springMax.swap(newMax);
+    springMin.swap(newMin);
+    damperConstant.swap(newDamper);
+}
+
+//Data passed to the threads evaluating the springs
+template<class Precision>
+struct AddForcesData {
+    SpringNetwork* network;
+    BasicParticleSystem<Precision>* particles;
+    ThreadPool* pool;
+};
+
+//Function to add the spring and damper force of every spring to the force of the two masses it connects
+template<class Precision>
+void SpringNetwork::addForces(BasicParticleSystem<Precision>& particles, ThreadPool* pool){
+    PROFILE_SCOPE("springs");
+    if(nColours == 0 && nSprings > 0) {
+        colourSprings();
+    }
+    if(pool == NULL || pool->size() == 1 || nSprings < minParallelSprings) {
+        addForces(particles, 0, nSprings);
+        return;
+    }
+    AddForcesData<Precision> data = { this, &particles, pool };
+    pool->run(addForcesTask<Precision>, &data);
+}
+
+//Task run on every thread: each thread evaluates its part of every colour. The barrier makes sure that no
+//thread starts on the next colour, which may write to the same masses, before all threads are done
+template<class Precision>
+void SpringNetwork::addForcesTask(void* data, int thread, int nThreads){
+    PROFILE_SCOPE("spring colours");
+    AddForcesData<Precision>* d = (AddForcesData<Precision>*)data;
+    SpringNetwork* network = d->network;
+    for(int c = 0; c < network->nColours; c++) {
+        int begin, end;
+        ThreadPool::partition(network->colourStart[c], network->colourStart[c + 1], thread, nThreads, begin, end);
+        network->addForces(*d->particles, begin, end);
+        d->pool->barrier();
+    }
+}
+
+//The function adds the spring and damper force of the springs in [begin, end) to the accumulated force of their
+//two masses. The force acts on the first mass and the opposite force on the second mass. The differences are
+//taken in the Accumulator, so a mixed precision system computes the whole force in double
+template<class Precision>
+void SpringNetwork::addForces(BasicParticleSystem<Precision>& particles, int begin, int end){
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+    Scalar *x = particles.x, *y = particles.y, *z = particles.z;
+    Scalar *vx = particles.vx, *vy = particles.vy, *vz = particles.vz;
+    Accumulator *fx = particles.fx, *fy = particles.fy, *fz = particles.fz;
+
+    for(int i = begin; i < end; i++) {
+        int m1 = mass1[i];
+        int m2 = mass2[i];
+
+        // Vector between the two masses
+        BasicVector<Accumulator> springVector((Accumulator)x[m1] - x[m2], (Accumulator)y[m1] - y[m2], (Accumulator)z[m1] - z[m2]);
+        BasicVector<Accumulator> velocityDifference((Accumulator)vx[m1] - vx[m2], (Accumulator)vy[m1] - vy[m2],
+                                                    (Accumulator)vz[m1] - vz[m2]);
+
+        //The spring force -k * (distance - length) / distance * springVector, with the division by the distance
+        //folded into one reciprocal square root. Masses at the same position give the spring no direction
+        Accumulator distanceSquared = springVector.lengthSquared();
+        Accumulator stretch = 0;
+        if(distanceSquared > (Accumulator)VEC3_MIN_LENGTH * (Accumulator)VEC3_MIN_LENGTH) {
+            stretch = springConstant[i] * (1 - springLength[i] * rsqrt(distanceSquared));
+        }
+
+        //The spring and damping force
+        BasicVector<Accumulator> force = -(stretch * springVector + damperConstant[i] * velocityDifference);
+
+        fx[m1] += force.x;
+        fy[m1] += force.y;
+        fz[m1] += force.z;
+        fx[m2] -= force.x;
+        fy[m2] -= force.y;
+        fz[m2] -= force.z;
+    }
+}
+
+//The function simulates the masses one step in two passes: first the forces of all springs are accumulated,
+//then each mass is simulated once. The result therefore does not depend on the order of the springs
+template<class Precision>
+void SpringNetwork::simulateEuler(BasicParticleSystem<Precision>& particles, typename Precision::Accumulator dt, ThreadPool* pool){
+    particles.clearForces();
+    addForces(particles, pool);
+    particles.simulateEuler(dt);
+}
+
+//The precisions the functions are compiled for
+template void SpringNetwork::createFromMesh(const BasicParticleSystem<FloatPrecision>&, const int*, int, const MeshSpringOptions&);
+template void SpringNetwork::createFromMesh(const BasicParticleSystem<DoublePrecision>&, const int*, int, const MeshSpringOptions&);
+template void SpringNetwork::createFromMesh(const BasicParticleSystem<MixedPrecision>&, const int*, int, const MeshSpringOptions&);
+template void SpringNetwork::addForces(BasicParticleSystem<FloatPrecision>&, ThreadPool*);
+template void SpringNetwork::addForces(BasicParticleSystem<DoublePrecision>&, ThreadPool*);
+template void SpringNetwork::addForces(BasicParticleSystem<MixedPrecision>&, ThreadPool*);
+template void SpringNetwork::simulateEuler(BasicParticleSystem<FloatPrecision>&, float, ThreadPool*);
+template void SpringNetwork::simulateEuler(BasicParticleSystem<DoublePrecision>&, double, ThreadPool*);
+template void SpringNetwork::simulateEuler(BasicParticleSystem<MixedPrecision>&, double, ThreadPool*);
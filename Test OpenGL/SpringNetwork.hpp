@@ -0,0 +1,108 @@
+//  SpringNetwork.hpp
+// Class that stores all springs and dampers of a body. The topology (which masses each spring connects) and
+// the parameters of every spring are kept in contiguous arrays. The network is built once and then reused
+// for every simulation step, so stepping the system does not allocate any memory.
+// The springs are partitioned into colours, classes of springs that share no mass. The springs of one colour
+// can be evaluated in parallel without write conflicts, and the springs are stored sorted by colour so that the
+// parallel and the single-threaded evaluation add the forces in the same order and give identical results.
+// The parameters are floats for every precision. The functions that work on the masses are templates on the
+// precision of the particle system and compute the forces in its Accumulator.
+
+#ifndef SpringNetwork_hpp
+#define SpringNetwork_hpp
+
+#include <vector>
+
+#include "ParticleSystem.hpp"
+#include "ThreadPool.hpp"
+
+//Parameters of the springs created from a triangle mesh by SpringNetwork::createFromMesh
+struct MeshSpringOptions {
+    float structuralConstant;   // Spring constant of the springs along the edges of the triangles
+    float structuralDamper;     // Damper constant of the springs along the edges
+    float bendingConstant;      // Spring constant of the springs across pairs of adjacent triangles, 0 for none
+    float bendingDamper;        // Damper constant of the bending springs
+    float shearConstant;        // Spring constant of the springs between masses closer than shearRadius
+    float shearDamper;          // Damper constant of the shear springs
+    float shearRadius;          // Largest length of a shear spring, 0 for no shear springs
+    float maxFactor;            // springMax of every spring relative to its rest length
+    float minFactor;            // springMin of every spring relative to its rest length
+
+    //Constructor, sets the same constants as the box in the viewer and no shear springs
+    MeshSpringOptions();
+};
+
+class SpringNetwork {
+public:
+
+    int nSprings;                       //Number of springs in the network
+    std::vector<int> mass1;             //Index of the first mass connected to each spring
+    std::vector<int> mass2;             //Index of the second mass connected to each spring
+    std::vector<float> springConstant;  //The spring constant of each spring
+    std::vector<float> springLength;    //The rest length of each spring
+    std::vector<float> springMax;       //The maximum length of each spring
+    std::vector<float> springMin;       //The minimum length of each spring
+    std::vector<float> damperConstant;  //The damper constant of each spring
+
+    int nColours;                       //Number of colours. Zero until the springs have been coloured
+    std::vector<int> colourStart;       //Index of the first spring of each colour, followed by nSprings
+    int minParallelSprings;             //Smallest number of springs evaluated on more than one thread
+
+    //Constructor, creates an empty network
+    SpringNetwork();
+
+    //Function to remove all springs from the network
+    void clean();
+
+    //Function to reserve memory for a number of springs, to avoid reallocations while building the network
+    void reserve(int capacity);
+
+    //Function to add a spring and damper between two masses. Returns the index of the new spring, which is
+    //valid until the springs are coloured
+    int addSpring(int mass1, int mass2, float springConstant, float springMax, float springMin, float springLength, float damperConstant);
+
+    //Function to create the 24 springs of a box: 12 edges and 12 face diagonals.
+    //The masses are expected in the vertex order used by TriangleSoup::createBox
+    void createBox(float springConstant, float damperConstant, float springLength, float springMax, float springMin,
+                   float springConstDiag, float damperConstDiag);
+
+    //Function to create the springs of a lattice of nx*ny*nz masses placed spacing apart. Neighbouring masses are
+    //connected along the axes and across the diagonals of every face, the same pattern as in createBox.
+    //Mass (i, j, k) is expected at index i + nx*(j + ny*k)
+    void createLattice(int nx, int ny, int nz, float spacing, float springConstant, float damperConstant,
+                       float springConstDiag, float damperConstDiag);
+
+    //Function to create the springs of a triangle mesh: a structural spring along every edge, a bending spring
+    //between the opposite corners of every pair of triangles sharing an edge, and optionally shear springs
+    //between all masses closer than a radius. No two springs connect the same masses. The triangles are given
+    //as 3 mass indices each, and the rest lengths are the distances between the masses
+    template<class Precision>
+    void createFromMesh(const BasicParticleSystem<Precision>& particles, const int* triangles, int nTriangles,
+                        const MeshSpringOptions& options);
+
+    //Function to partition the springs into colours with a greedy graph colouring and sort them by colour.
+    //This changes the order of the springs. It is done by the create functions, and otherwise the
+    //first time the forces are evaluated after springs have been added
+    void colourSprings();
+
+    //Function to add the spring and damper force of every spring to the force of the two masses it connects.
+    //If a thread pool is given, the springs of each colour are split between its threads
+    template<class Precision>
+    void addForces(BasicParticleSystem<Precision>& particles, ThreadPool* pool = NULL);
+
+    //Function to simulate the masses one step. All spring forces are accumulated first, then every mass is
+    //simulated exactly once using the Euler method
+    template<class Precision>
+    void simulateEuler(BasicParticleSystem<Precision>& particles, typename Precision::Accumulator dt, ThreadPool* pool = NULL);
+
+private:
+    //Function to add the forces of the springs in [begin, end)
+    template<class Precision>
+    void addForces(BasicParticleSystem<Precision>& particles, int begin, int end);
+    //Task run on every thread of the pool by addForces
+    template<class Precision>
+    static void addForcesTask(void* data, int thread, int nThreads);
+
+};
+
+#endif /* SpringNetwork_hpp */
@@ -0,0 +1,92 @@
+//  StreamBuffer.cpp
+// Class for data that is sent to OpenGL every frame, through a ring of buffers guarded by fences.
+
+#include "StreamBuffer.hpp"
+
+//Constructor
+StreamBuffer::StreamBuffer(){
+    for(int i = 0; i < RING_SIZE; i++) {
+        buffers[i] = 0;
+        fences[i] = 0;
+    }
+    current = 0;
+    size = 0;
+    target = GL_ARRAY_BUFFER;
+}
+
+//Destructor
+StreamBuffer::~StreamBuffer(){
+    clean();
+}
+
+//Function to create the buffers
+void StreamBuffer::create(GLenum target, GLsizeiptr size){
+    clean();
+    this->target = target;
+    this->size = size;
+    glGenBuffers(RING_SIZE, buffers);
+    for(int i = 0; i < RING_SIZE; i++) {
+        glBindBuffer(target, buffers[i]);
+        glBufferData(target, size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target, 0);
+    current = RING_SIZE - 1;
+}
+
+//Function to free the buffers and fences
+void StreamBuffer::clean(){
+    if(buffers[0] == 0) {
+        return;
+    }
+    for(int i = 0; i < RING_SIZE; i++) {
+        if(fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    glDeleteBuffers(RING_SIZE, buffers);
+    for(int i = 0; i < RING_SIZE; i++) {
+        buffers[i] = 0;
+    }
+    size = 0;
+}
+
+//Function to map the next buffer of the ring for writing. The wait flushes the commands the first time, so the
+//fence is sure to be reached
+void* StreamBuffer::map(){
+    if(size == 0) {
+        return NULL;
+    }
+    current = (current + 1) % RING_SIZE;
+    if(fences[current]) {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while(glClientWaitSync(fences[current], flags, 1000000000) == GL_TIMEOUT_EXPIRED) {
+            flags = 0;
+        }
+        glDeleteSync(fences[current]);
+        fences[current] = 0;
+    }
+    glBindBuffer(target, buffers[current]);
+    return glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+//Function to unmap the buffer after map()
+void StreamBuffer::unmap(){
+    glUnmapBuffer(target);
+}
+
+//Function to return the buffer written last
+GLuint StreamBuffer::buffer() const {
+    return buffers[current];
+}
+
+//Function to place a fence after the commands that read the buffer written last
+void StreamBuffer::fence(){
+    if(size == 0) {
+        return;
+    }
+    if(fences[current]) {
+        glDeleteSync(fences[current]);
+    }
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,62 @@
+//  StreamBuffer.hpp
+// Class for data that is sent to OpenGL every frame, such as the deformed positions of a mesh.
+// The data is written to a ring of buffer objects, one after the other. Every draw that reads a buffer is followed
+// by a fence, and a buffer is only written again when the fence has passed, so writing never waits for a draw of an
+// earlier frame that is still running and never changes data such a draw reads. The buffers are mapped with
+// GL_MAP_UNSYNCHRONIZED_BIT, since the fences already do the synchronization. OpenGL 3.3 has no persistent
+// mapping, so each buffer is mapped and unmapped once per write.
+
+#ifndef StreamBuffer_hpp
+#define StreamBuffer_hpp
+
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "Utilities.hpp"
+
+class StreamBuffer {
+public:
+
+    static const int RING_SIZE = 3;     // Number of buffers, the number of frames that can be in flight
+
+    GLuint buffers[RING_SIZE];          // The buffer objects
+    int current;                        // The buffer written last
+    GLsizeiptr size;                    // Size of each buffer in bytes
+
+    //Constructor
+    StreamBuffer();
+    //Destructor
+    ~StreamBuffer();
+
+    //Function to create the buffers, each of the given size in bytes
+    void create(GLenum target, GLsizeiptr size);
+
+    //Function to free the buffers and fences
+    void clean();
+
+    //Function to move to the next buffer of the ring, wait until OpenGL has finished reading it and map it for
+    //writing. Returns NULL if it could not be mapped
+    void* map();
+
+    //Function to unmap the buffer after map() returned a pointer. The buffer stays bound to the target
+    void unmap();
+
+    //Function to return the buffer written last
+    GLuint buffer() const;
+
+    //Function to place a fence after the commands that read the buffer written last. Called after the draw
+    void fence();
+
+private:
+    GLenum target;                      // The target the buffers are bound to while they are written
+    GLsync fences[RING_SIZE];           // Fence after the last draw reading each buffer, or 0
+
+    //Copying would share the buffers, so it is not allowed
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+};
+
+#endif /* StreamBuffer_hpp */
@@ -0,0 +1,116 @@
+//  ThreadPool.cpp
+// A small pool of worker threads that run the same task on all threads at once.
+
+#include "ThreadPool.hpp"
+
+// Number of times a waiting thread checks for new work before it goes to sleep
+static const int SPIN_COUNT = 20000;
+
+//Constructor
+ThreadPool::ThreadPool(int nThreads){
+    if(nThreads <= 0) {
+        nThreads = (int)std::thread::hardware_concurrency();
+    }
+    this->nThreads = nThreads > 0 ? nThreads : 1;
+    stopping = false;
+    task = NULL;
+    data = NULL;
+    generation = 0;
+    running = 0;
+    barrierCount = 0;
+    barrierGeneration = 0;
+    for(int i = 1; i < this->nThreads; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+//Destructor
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+//Function to return the number of threads
+int ThreadPool::size() const {
+    return nThreads;
+}
+
+//Function to run a task on all threads and wait until it has finished everywhere
+void ThreadPool::run(Task task, void* data){
+    if(nThreads == 1) {
+        task(data, 0, 1);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = task;
+        this->data = data;
+        running = nThreads - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    task(data, 0, nThreads);
+
+    while(running.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+//Function to wait until all threads running the current task have called barrier()
+void ThreadPool::barrier(){
+    if(nThreads == 1) {
+        return;
+    }
+    unsigned current = barrierGeneration.load();
+    if(barrierCount.fetch_add(1) == nThreads - 1) {
+        //The last thread to arrive releases the others
+        barrierCount = 0;
+        barrierGeneration++;
+    }
+    else {
+        while(barrierGeneration.load() == current) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+//Function to split the range [begin, end) evenly between the threads
+void ThreadPool::partition(int begin, int end, int thread, int nThreads, int& partBegin, int& partEnd){
+    long long n = end - begin;
+    partBegin = begin + (int)(n * thread / nThreads);
+    partEnd = begin + (int)(n * (thread + 1) / nThreads);
+}
+
+//The loop run by each worker thread: wait for a new task, run it and report that it is done
+void ThreadPool::workerLoop(int thread){
+    unsigned seen = 0;
+    while(true) {
+        //Spin for a while, new work usually arrives in the next simulation step
+        for(int i = 0; i < SPIN_COUNT && generation.load() == seen; i++) {
+            std::this_thread::yield();
+        }
+        Task currentTask;
+        void* currentData;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(generation.load() == seen && !stopping) {
+                wake.wait(lock);
+            }
+            if(stopping) {
+                return;
+            }
+            seen = generation.load();
+            currentTask = task;
+            currentData = data;
+        }
+        currentTask(currentData, thread, nThreads);
+        running--;
+    }
+}
@@ -0,0 +1,61 @@
+//  ThreadPool.hpp
+// A small pool of worker threads. run() executes a task on all threads at once, the calling thread included,
+// and returns when every thread has finished. Inside a task, barrier() waits until all threads have reached it,
+// which lets one task run several dependent phases without waking the workers up again.
+// Waiting threads spin for a short while before they sleep, since the simulation calls run() every step.
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class ThreadPool {
+public:
+
+    //A task is called once on every thread with the index of the thread (0 is the calling thread)
+    typedef void (*Task)(void* data, int thread, int nThreads);
+
+    //Constructor, starts nThreads-1 worker threads. With nThreads = 0 one thread per core is used
+    explicit ThreadPool(int nThreads);
+    //Destructor, stops the worker threads
+    ~ThreadPool();
+
+    //Function to return the number of threads, including the calling thread
+    int size() const;
+
+    //Function to run a task on all threads and wait until it has finished everywhere
+    void run(Task task, void* data);
+
+    //Function to wait until all threads running the current task have called barrier()
+    void barrier();
+
+    //Function to split the range [begin, end) evenly between the threads and return the part of one thread
+    static void partition(int begin, int end, int thread, int nThreads, int& partBegin, int& partEnd);
+
+private:
+    int nThreads;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    Task task;                              // The task being run
+    void* data;                             // The data passed to the task
+    std::atomic<unsigned> generation;       // Incremented every time a new task is started
+    std::atomic<int> running;               // Number of workers still running the task
+
+    std::atomic<int> barrierCount;          // Number of threads waiting at the barrier
+    std::atomic<unsigned> barrierGeneration;// Incremented every time all threads have reached the barrier
+
+    void workerLoop(int thread);
+
+    //Copying a pool of threads is not allowed
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+
+#endif /* ThreadPool_hpp */
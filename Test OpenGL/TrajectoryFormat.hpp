@@ -0,0 +1,103 @@
+//  TrajectoryFormat.hpp
+// Layout of the .b3dtraj trajectory files written by TrajectoryWriter and read by TrajectoryReader. A trajectory
+// holds the positions of all masses of a scene, one frame every few steps of the simulation.
+// The frames are stored in chunks. The first frame of a chunk is a key frame, stored as floats, and the others are
+// stored as the difference from the frame before, rounded to a multiple of the quantum and written as zig-zag
+// varints: a mass that moved less than 64 quanta since the last frame takes one byte per component. The
+// differences are taken from the decoded positions of the frame before, not the exact ones, so the rounding
+// errors do not add up: every decoded position is within half a quantum of the recorded one, give or take the
+// rounding of a float. A frame whose differences are too large, or not finite, is stored as a key frame instead.
+// A chunk can be decoded without the chunks before it, which makes seeking cheap: the index at the end of the
+// file gives the offset of every chunk, and at most one chunk is decoded to reach any frame. A file without an
+// index, from a recording that was not closed, is read by following the chunk headers.
+//
+// Layout, all numbers in the byte order of the machine that wrote the file:
+//   header         TrajectoryHeader
+//   chunks         TrajectoryChunkHeader followed by its frames, size bytes in all
+//   index          one TrajectoryIndexEntry per chunk
+//   footer         TrajectoryFooter
+// Every frame starts with one byte, TRAJECTORY_KEY_FRAME or TRAJECTORY_DELTA_FRAME. A key frame is followed by the
+// x of all masses, then the y and then the z as floats. A delta frame is followed by the varints of the x of all
+// masses, then the y and then the z.
+
+#ifndef TrajectoryFormat_hpp
+#define TrajectoryFormat_hpp
+
+#include <stdint.h>
+#include <vector>
+
+static const char TRAJECTORY_MAGIC[8] = { 'B', '3', 'D', 'T', 'R', 'A', 'J', 0 };
+static const char TRAJECTORY_INDEX_MAGIC[8] = { 'B', '3', 'D', 'T', 'I', 'D', 'X', 0 };
+static const uint32_t TRAJECTORY_VERSION = 1;
+static const uint32_t TRAJECTORY_BYTE_ORDER_MARK = 0x01020304;
+static const uint32_t TRAJECTORY_CHUNK_MARK = 0x4B4E4843;      // "CHNK" in the file on little-endian machines
+static const uint8_t TRAJECTORY_KEY_FRAME = 0;
+static const uint8_t TRAJECTORY_DELTA_FRAME = 1;
+static const int64_t TRAJECTORY_MAX_DELTA = (int64_t)1 << 40;   // Largest difference in quanta of a delta frame
+
+//The header at the start of a trajectory file
+struct TrajectoryHeader {
+    char magic[8];              // "B3DTRAJ" followed by a zero
+    uint32_t version;           // TRAJECTORY_VERSION
+    uint32_t byteOrder;         // TRAJECTORY_BYTE_ORDER_MARK
+    uint32_t nMasses;           // Number of masses of every frame
+    uint32_t framesPerChunk;    // Largest number of frames of a chunk
+    float frameTime;            // Simulated time between two frames, in seconds
+    float quantum;              // The differences of the delta frames are multiples of this
+};
+
+//The header of a chunk
+struct TrajectoryChunkHeader {
+    uint32_t mark;              // TRAJECTORY_CHUNK_MARK
+    uint32_t firstFrame;        // Number of the first frame of the chunk
+    uint32_t nFrames;           // Number of frames of the chunk
+    uint32_t size;              // Size of the frames in bytes, without this header
+};
+
+//The entry of a chunk in the index
+struct TrajectoryIndexEntry {
+    uint64_t offset;            // Offset of the chunk header from the start of the file
+    uint32_t firstFrame;        // Number of the first frame of the chunk
+    uint32_t nFrames;           // Number of frames of the chunk
+};
+
+//The footer at the end of a file with an index
+struct TrajectoryFooter {
+    uint64_t indexOffset;       // Offset of the index from the start of the file
+    uint32_t nChunks;           // Number of entries of the index
+    uint32_t nFrames;           // Number of frames of the file
+    char magic[8];              // "B3DTIDX" followed by a zero
+};
+
+//Function to return the decoded value of a component from its value in the frame before and its difference
+//in quanta. The writer and the reader both use this, so they agree on the decoded value to the last bit
+inline float trajectoryDecode(float previous, int64_t delta, float quantum){
+    return previous + (float)((double)delta * quantum);
+}
+
+//Function to append a signed number as a zig-zag varint: 7 bits per byte, the lowest first, with the high bit set
+//on every byte but the last. Zig-zag coding maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+inline void trajectoryPutVarint(std::vector<uint8_t>& out, int64_t value){
+    uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    while(zigzag >= 0x80) {
+        out.push_back((uint8_t)(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    out.push_back((uint8_t)zigzag);
+}
+
+//Function to read a zig-zag varint. Returns the position after it, or NULL if it does not end before end
+inline const uint8_t* trajectoryGetVarint(const uint8_t* p, const uint8_t* end, int64_t& value){
+    uint64_t zigzag = 0;
+    for(int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        zigzag |= (uint64_t)(byte & 0x7F) << shift;
+        if(byte < 0x80) {
+            value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+#endif /* TrajectoryFormat_hpp */
@@ -0,0 +1,224 @@
+//  TrajectoryReader.cpp
+// Class that reads the frames of a trajectory file, decoding at most one chunk to reach any frame.
+
+#include "TrajectoryReader.hpp"
+
+#include <cstring>
+
+//Constructor
+TrajectoryReader::TrajectoryReader(){
+    nMasses = 0;
+    nFrames = 0;
+    frameTime = 0.0f;
+    quantum = 0.0f;
+    indexed = false;
+    decodedChunk = -1;
+    decodedFrame = -1;
+    next = NULL;
+    chunkEnd = NULL;
+}
+
+//Function to open a file and find its chunks, from the index if there is one
+bool TrajectoryReader::open(const char* filename){
+    close();
+    //The frames are read in order while the replay plays, but in any order when it is scrubbed or seeks
+    if(!file.open(filename, false, ACCESS_NORMAL)) {
+        error = "could not open the file";
+        return false;
+    }
+    TrajectoryHeader header;
+    if(file.size < sizeof(header)) {
+        error = "not a trajectory file";
+        close();
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if(memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0) {
+        error = "not a trajectory file";
+        close();
+        return false;
+    }
+    if(header.version != TRAJECTORY_VERSION || header.byteOrder != TRAJECTORY_BYTE_ORDER_MARK || header.nMasses == 0) {
+        error = "the file was written with another version or byte order";
+        close();
+        return false;
+    }
+    nMasses = header.nMasses;
+    frameTime = header.frameTime;
+    quantum = header.quantum;
+    positions.resize(3 * (size_t)nMasses);
+
+    indexed = readIndex();
+    if(!indexed && !scanChunks()) {
+        close();
+        return false;
+    }
+    nFrames = chunks.empty() ? 0 : (int)(chunks.back().firstFrame + chunks.back().nFrames);
+    return true;
+}
+
+//Function to close the file
+void TrajectoryReader::close(){
+    file.close();
+    chunks.clear();
+    nMasses = 0;
+    nFrames = 0;
+    indexed = false;
+    decodedChunk = -1;
+    decodedFrame = -1;
+    next = NULL;
+    chunkEnd = NULL;
+}
+
+//Function to read the index at the end of the file. Returns false if there is none, or it does not fit the file
+bool TrajectoryReader::readIndex(){
+    TrajectoryFooter footer;
+    if(file.size < sizeof(TrajectoryHeader) + sizeof(footer)) {
+        return false;
+    }
+    memcpy(&footer, file.data + file.size - sizeof(footer), sizeof(footer));
+    if(memcmp(footer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(TRAJECTORY_INDEX_MAGIC)) != 0
+       || footer.indexOffset + (uint64_t)footer.nChunks * sizeof(TrajectoryIndexEntry) + sizeof(footer) != file.size) {
+        return false;
+    }
+    chunks.resize(footer.nChunks);
+    if(footer.nChunks > 0) {
+        memcpy(&chunks[0], file.data + footer.indexOffset, footer.nChunks * sizeof(TrajectoryIndexEntry));
+    }
+    uint32_t frame = 0;
+    for(size_t c = 0; c < chunks.size(); c++) {
+        TrajectoryChunkHeader header;
+        if(chunks[c].firstFrame != frame || chunks[c].nFrames == 0 || chunks[c].offset + sizeof(header) > footer.indexOffset) {
+            chunks.clear();
+            return false;
+        }
+        memcpy(&header, file.data + chunks[c].offset, sizeof(header));
+        if(header.mark != TRAJECTORY_CHUNK_MARK || chunks[c].offset + sizeof(header) + header.size > footer.indexOffset) {
+            chunks.clear();
+            return false;
+        }
+        frame += chunks[c].nFrames;
+    }
+    return frame == footer.nFrames;
+}
+
+//Function to find the chunks by following their headers from the start of the file. A chunk that was cut off
+//ends the file
+bool TrajectoryReader::scanChunks(){
+    chunks.clear();
+    uint64_t offset = sizeof(TrajectoryHeader);
+    uint32_t frame = 0;
+    TrajectoryChunkHeader header;
+    while(offset + sizeof(header) <= file.size) {
+        memcpy(&header, file.data + offset, sizeof(header));
+        if(header.mark != TRAJECTORY_CHUNK_MARK || header.firstFrame != frame || header.nFrames == 0
+           || offset + sizeof(header) + header.size > file.size) {
+            break;
+        }
+        TrajectoryIndexEntry entry = { offset, header.firstFrame, header.nFrames };
+        chunks.push_back(entry);
+        frame += header.nFrames;
+        offset += sizeof(header) + header.size;
+    }
+    return true;
+}
+
+//Function to return the chunk holding a frame
+int TrajectoryReader::findChunk(int frame) const {
+    int low = 0, high = (int)chunks.size() - 1;
+    while(low < high) {
+        int middle = (low + high + 1) / 2;
+        if((int)chunks[middle].firstFrame <= frame) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+//Function to decode the frame after the last one decoded, from the same chunk
+bool TrajectoryReader::decodeNext(){
+    size_t n = positions.size();
+    if(next >= chunkEnd) {
+        error = "the file is damaged";
+        return false;
+    }
+    uint8_t type = *next++;
+    if(type == TRAJECTORY_KEY_FRAME) {
+        if((size_t)(chunkEnd - next) < n * sizeof(float)) {
+            error = "the file is damaged";
+            return false;
+        }
+        memcpy(&positions[0], next, n * sizeof(float));
+        next += n * sizeof(float);
+    }
+    else if(type == TRAJECTORY_DELTA_FRAME) {
+        for(size_t i = 0; i < n; i++) {
+            int64_t delta;
+            next = trajectoryGetVarint(next, chunkEnd, delta);
+            if(next == NULL) {
+                error = "the file is damaged";
+                return false;
+            }
+            positions[i] = trajectoryDecode(positions[i], delta, quantum);
+        }
+    }
+    else {
+        error = "the file is damaged";
+        return false;
+    }
+    decodedFrame++;
+    return true;
+}
+
+//Function to decode a frame into positions. The frames of its chunk are decoded from the key frame at its start, or
+//from the frame read last if it is earlier in the same chunk
+bool TrajectoryReader::decodeFrame(int frame){
+    if(frame < 0 || frame >= nFrames) {
+        error = "no such frame";
+        return false;
+    }
+    int chunk = findChunk(frame);
+    if(chunk != decodedChunk || frame < decodedFrame) {
+        const TrajectoryIndexEntry& entry = chunks[chunk];
+        TrajectoryChunkHeader header;
+        memcpy(&header, file.data + entry.offset, sizeof(header));
+        next = (const uint8_t*)file.data + entry.offset + sizeof(header);
+        chunkEnd = next + header.size;
+        decodedChunk = chunk;
+        decodedFrame = (int)entry.firstFrame - 1;
+    }
+    while(decodedFrame < frame) {
+        if(!decodeNext()) {
+            decodedChunk = -1;
+            return false;
+        }
+    }
+    return true;
+}
+
+//Function to read a frame
+bool TrajectoryReader::readFrame(int frame, float* x, float* y, float* z){
+    if(!decodeFrame(frame)) {
+        return false;
+    }
+    memcpy(x, &positions[0], nMasses * sizeof(float));
+    memcpy(y, &positions[nMasses], nMasses * sizeof(float));
+    memcpy(z, &positions[2 * (size_t)nMasses], nMasses * sizeof(float));
+    return true;
+}
+
+//Function to read a frame into arrays of doubles
+bool TrajectoryReader::readFrame(int frame, double* x, double* y, double* z){
+    if(!decodeFrame(frame)) {
+        return false;
+    }
+    for(int i = 0; i < nMasses; i++) {
+        x[i] = positions[i];
+        y[i] = positions[nMasses + i];
+        z[i] = positions[2 * (size_t)nMasses + i];
+    }
+    return true;
+}
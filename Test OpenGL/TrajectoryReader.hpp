@@ -0,0 +1,64 @@
+//  TrajectoryReader.hpp
+// Class that reads the frames of a .b3dtraj file written by TrajectoryWriter, see TrajectoryFormat.hpp. The file
+// is memory-mapped, and any frame can be read: the chunk holding it is found in the index, and its frames are
+// decoded from the key frame at its start. Frames read in order continue from the frame read last, so playing
+// a recording decodes every frame only once.
+
+#ifndef TrajectoryReader_hpp
+#define TrajectoryReader_hpp
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "TrajectoryFormat.hpp"
+
+class TrajectoryReader {
+public:
+
+    int nMasses;                        // Number of masses of every frame
+    int nFrames;                        // Number of frames
+    float frameTime;                    // Simulated time between two frames, in seconds
+    float quantum;                      // The positions are stored to within half of this
+    bool indexed;                       // Whether the file has an index. Without one the chunks were followed
+    std::string error;                  // Description of the error if open() or readFrame() failed
+
+    //Constructor
+    TrajectoryReader();
+
+    //Function to open a trajectory file. Returns false if it can not be opened, is not a trajectory, or was
+    //written with another version or byte order
+    bool open(const char* filename);
+
+    //Function to close the file
+    void close();
+
+    //Function to copy the positions of the masses in a frame to x, y and z, nMasses floats each. Returns false if
+    //the frame does not exist or the file is damaged
+    bool readFrame(int frame, float* x, float* y, float* z);
+    //Function to copy the positions of the masses in a frame to arrays of doubles
+    bool readFrame(int frame, double* x, double* y, double* z);
+
+private:
+    MappedFile file;
+    std::vector<TrajectoryIndexEntry> chunks;
+
+    //State of the decoder: the positions of the last frame decoded, and where the next frame of its chunk starts
+    std::vector<float> positions;
+    int decodedChunk;                   // Chunk of the last frame decoded, or -1
+    int decodedFrame;                   // The last frame decoded
+    const uint8_t* next;                // Start of the frame after it
+    const uint8_t* chunkEnd;            // End of its chunk
+
+    bool readIndex();
+    bool scanChunks();
+    int findChunk(int frame) const;
+    bool decodeNext();
+    bool decodeFrame(int frame);
+
+    //Copying a reader is not allowed
+    TrajectoryReader(const TrajectoryReader&);
+    TrajectoryReader& operator=(const TrajectoryReader&);
+};
+
+#endif /* TrajectoryReader_hpp */
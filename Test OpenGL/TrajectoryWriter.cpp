@@ -0,0 +1,266 @@
+//  TrajectoryWriter.cpp
+// Class that records the positions of the masses of a simulation, encoded and written on a background thread.
+
+#include "TrajectoryWriter.hpp"
+
+#include <cmath>
+#include <cstring>
+
+//Constructor
+TrajectoryWriter::TrajectoryWriter(){
+    nMasses = 0;
+    nFrames = 0;
+    bytesWritten = 0;
+    file = NULL;
+    quantum = 1e-5f;
+    framesPerChunk = DEFAULT_FRAMES_PER_CHUNK;
+    current = NULL;
+    closing = false;
+    failed = false;
+    position = 0;
+}
+
+//Destructor
+TrajectoryWriter::~TrajectoryWriter(){
+    close();
+}
+
+//Function to create the file, write its header and start the writer thread
+bool TrajectoryWriter::open(const char* filename, int nMasses, float frameTime, float quantum, int framesPerChunk){
+    close();
+    error.clear();
+    if(nMasses <= 0 || !(quantum > 0.0f) || framesPerChunk <= 0) {
+        error = "invalid trajectory parameters";
+        return false;
+    }
+    file = fopen(filename, "wb");
+    if(file == NULL) {
+        error = "could not create the file";
+        return false;
+    }
+
+    TrajectoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+    header.version = TRAJECTORY_VERSION;
+    header.byteOrder = TRAJECTORY_BYTE_ORDER_MARK;
+    header.nMasses = nMasses;
+    header.framesPerChunk = framesPerChunk;
+    header.frameTime = frameTime;
+    header.quantum = quantum;
+    if(fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        file = NULL;
+        error = "could not write the header";
+        return false;
+    }
+
+    this->filename = filename;
+    this->nMasses = nMasses;
+    this->quantum = quantum;
+    this->framesPerChunk = framesPerChunk;
+    nFrames = 0;
+    bytesWritten = 0;
+    position = sizeof(header);
+    index.clear();
+    previous.assign(3 * (size_t)nMasses, 0.0f);
+    deltas.resize(3 * (size_t)nMasses);
+    closing = false;
+    failed = false;
+
+    current = new Chunk();
+    current->positions.assign(3 * (size_t)nMasses * framesPerChunk, 0.0f);
+    current->firstFrame = 0;
+    current->nFrames = 0;
+    thread = std::thread(&TrajectoryWriter::writerLoop, this);
+    return true;
+}
+
+//Function to set the positions of some masses in the frame being recorded
+void TrajectoryWriter::setPositions(int offset, const float* x, const float* y, const float* z, int n){
+    if(current == NULL || offset < 0 || offset + n > nMasses) {
+        return;
+    }
+    float* frame = &current->positions[3 * (size_t)nMasses * current->nFrames];
+    memcpy(frame + offset, x, n * sizeof(float));
+    memcpy(frame + nMasses + offset, y, n * sizeof(float));
+    memcpy(frame + 2 * nMasses + offset, z, n * sizeof(float));
+}
+
+//Function to set the positions of some masses simulated in double precision in the frame being recorded
+void TrajectoryWriter::setPositions(int offset, const double* x, const double* y, const double* z, int n){
+    if(current == NULL || offset < 0 || offset + n > nMasses) {
+        return;
+    }
+    float* frame = &current->positions[3 * (size_t)nMasses * current->nFrames];
+    for(int i = 0; i < n; i++) {
+        frame[offset + i] = (float)x[i];
+        frame[nMasses + offset + i] = (float)y[i];
+        frame[2 * nMasses + offset + i] = (float)z[i];
+    }
+}
+
+//Function to end the frame being recorded. A full chunk is handed to the writer thread, and the frame is copied to
+//the start of the next one
+void TrajectoryWriter::endFrame(){
+    if(current == NULL) {
+        return;
+    }
+    size_t frameSize = 3 * (size_t)nMasses;
+    const float* frame = &current->positions[frameSize * current->nFrames];
+    current->nFrames++;
+    nFrames++;
+    if(current->nFrames < framesPerChunk) {
+        memcpy(&current->positions[frameSize * current->nFrames], frame, frameSize * sizeof(float));
+        return;
+    }
+
+    Chunk* full = current;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while((int)queue.size() >= MAX_QUEUED_CHUNKS && !failed) {
+            changed.wait(lock);
+        }
+        if(!freeChunks.empty()) {
+            current = freeChunks.back();
+            freeChunks.pop_back();
+        }
+        else {
+            current = new Chunk();
+            current->positions.resize(frameSize * framesPerChunk);
+        }
+    }
+    memcpy(&current->positions[0], frame, frameSize * sizeof(float));
+    current->firstFrame = (int)nFrames;
+    current->nFrames = 0;
+    submit(full);
+}
+
+//Function to hand a chunk to the writer thread
+void TrajectoryWriter::submit(Chunk* chunk){
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(chunk);
+    changed.notify_all();
+}
+
+//Function run by the writer thread: encodes and writes the chunks in the order they were filled, until the
+//file is closed and every chunk is written
+void TrajectoryWriter::writerLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        while(queue.empty() && !closing) {
+            changed.wait(lock);
+        }
+        if(queue.empty()) {
+            return;
+        }
+        Chunk* chunk = queue.front();
+        queue.erase(queue.begin());
+        lock.unlock();
+        bool ok = !failed && writeChunk(*chunk);
+        lock.lock();
+        if(!ok) {
+            failed = true;
+        }
+        freeChunks.push_back(chunk);
+        changed.notify_all();
+    }
+}
+
+//Function to add a frame to the encoded chunk, as a delta frame unless key is set or a difference is too large
+//to be stored. previous is updated to the decoded positions
+void TrajectoryWriter::encodeFrame(const float* positions, bool key){
+    size_t n = previous.size();
+    for(size_t i = 0; i < n && !key; i++) {
+        double difference = ((double)positions[i] - (double)previous[i]) / quantum;
+        if(!(fabs(difference) <= (double)TRAJECTORY_MAX_DELTA)) {
+            key = true;
+        }
+        else {
+            deltas[i] = (int64_t)floor(difference + 0.5);
+        }
+    }
+    if(key) {
+        encoded.push_back(TRAJECTORY_KEY_FRAME);
+        const uint8_t* bytes = (const uint8_t*)positions;
+        encoded.insert(encoded.end(), bytes, bytes + n * sizeof(float));
+        memcpy(&previous[0], positions, n * sizeof(float));
+        return;
+    }
+    encoded.push_back(TRAJECTORY_DELTA_FRAME);
+    for(size_t i = 0; i < n; i++) {
+        trajectoryPutVarint(encoded, deltas[i]);
+        previous[i] = trajectoryDecode(previous[i], deltas[i], quantum);
+    }
+}
+
+//Function to encode a chunk and write it at the end of the file
+bool TrajectoryWriter::writeChunk(const Chunk& chunk){
+    size_t frameSize = previous.size();
+    encoded.clear();
+    for(int f = 0; f < chunk.nFrames; f++) {
+        encodeFrame(&chunk.positions[frameSize * f], f == 0);
+    }
+
+    TrajectoryChunkHeader header;
+    header.mark = TRAJECTORY_CHUNK_MARK;
+    header.firstFrame = chunk.firstFrame;
+    header.nFrames = chunk.nFrames;
+    header.size = (uint32_t)encoded.size();
+    if(fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(&encoded[0], 1, encoded.size(), file) != encoded.size()) {
+        return false;
+    }
+    TrajectoryIndexEntry entry = { position, (uint32_t)chunk.firstFrame, (uint32_t)chunk.nFrames };
+    index.push_back(entry);
+    position += sizeof(header) + encoded.size();
+    return true;
+}
+
+//Function to write the last chunk and the index, stop the writer thread and close the file
+bool TrajectoryWriter::close(){
+    if(file == NULL) {
+        return true;
+    }
+    if(current->nFrames > 0) {
+        submit(current);
+    }
+    else {
+        delete current;
+    }
+    current = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+        changed.notify_all();
+    }
+    thread.join();
+
+    bool ok = !failed;
+    if(ok) {
+        TrajectoryFooter footer;
+        memset(&footer, 0, sizeof(footer));
+        footer.indexOffset = position;
+        footer.nChunks = (uint32_t)index.size();
+        footer.nFrames = (uint32_t)nFrames;
+        memcpy(footer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(TRAJECTORY_INDEX_MAGIC));
+        ok = (index.empty() || fwrite(&index[0], sizeof(TrajectoryIndexEntry), index.size(), file) == index.size())
+          && fwrite(&footer, sizeof(footer), 1, file) == 1;
+        bytesWritten = position + index.size() * sizeof(TrajectoryIndexEntry) + sizeof(footer);
+    }
+    ok = fclose(file) == 0 && ok;
+    file = NULL;
+    if(!ok) {
+        error = "could not write " + filename;
+    }
+
+    for(size_t i = 0; i < freeChunks.size(); i++) {
+        delete freeChunks[i];
+    }
+    freeChunks.clear();
+    return ok;
+}
+
+//Function to return whether a file is open
+bool TrajectoryWriter::isOpen() const {
+    return file != NULL;
+}
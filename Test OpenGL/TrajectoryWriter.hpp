@@ -0,0 +1,96 @@
+//  TrajectoryWriter.hpp
+// Class that records the positions of the masses of a simulation to a .b3dtraj file, see TrajectoryFormat.hpp.
+// The simulation thread only copies the positions of every frame into the chunk being filled. Full chunks are
+// handed to a thread of the writer, which encodes and writes them in the background. If the writer falls more
+// than a few chunks behind, endFrame() waits for it, so the memory used stays bounded.
+// The chunks are written as they are filled, so a recording that is never closed can still be read up to the
+// last chunk written. close() writes the index that makes seeking fast.
+
+#ifndef TrajectoryWriter_hpp
+#define TrajectoryWriter_hpp
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TrajectoryFormat.hpp"
+
+class TrajectoryWriter {
+public:
+
+    static const int DEFAULT_FRAMES_PER_CHUNK = 64;
+    static const int MAX_QUEUED_CHUNKS = 4;     // Full chunks that may wait for the writer thread
+
+    int nMasses;                        // Number of masses of every frame
+    long nFrames;                       // Number of frames recorded
+    uint64_t bytesWritten;              // Size of the file, known after close()
+    std::string error;                  // Description of the error if open() or close() failed
+
+    //Constructor
+    TrajectoryWriter();
+    //Destructor, closes the file
+    ~TrajectoryWriter();
+
+    //Function to create a file for frames of nMasses masses, frameTime seconds apart. The positions are stored
+    //to about half a quantum. Returns false if the file could not be created
+    bool open(const char* filename, int nMasses, float frameTime, float quantum = 1e-5f,
+              int framesPerChunk = DEFAULT_FRAMES_PER_CHUNK);
+
+    //Function to set the positions of the masses [offset, offset + n) in the frame being recorded
+    void setPositions(int offset, const float* x, const float* y, const float* z, int n);
+    //Function to set the positions of masses simulated in double precision. The file stores them rounded to floats
+    void setPositions(int offset, const double* x, const double* y, const double* z, int n);
+
+    //Function to end the frame being recorded. The positions of the next frame start as a copy of it
+    void endFrame();
+
+    //Function to write the last chunk and the index and close the file. Returns false if anything could not be
+    //written
+    bool close();
+
+    //Function to return whether a file is open
+    bool isOpen() const;
+
+private:
+    //Frames waiting to be encoded, stored as floats: the x of all masses, then the y and the z, per frame
+    struct Chunk {
+        std::vector<float> positions;
+        int firstFrame;
+        int nFrames;
+    };
+
+    FILE* file;
+    std::string filename;
+    float quantum;
+    int framesPerChunk;
+    Chunk* current;                             // The chunk being filled by the simulation thread
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Chunk*> queue;                  // Full chunks, oldest first
+    std::vector<Chunk*> freeChunks;             // Chunks that have been written and can be filled again
+    bool closing;
+    bool failed;
+
+    //Only used by the writer thread
+    uint64_t position;                          // Offset of the end of the file
+    std::vector<TrajectoryIndexEntry> index;
+    std::vector<float> previous;                // Decoded positions of the last frame encoded
+    std::vector<int64_t> deltas;
+    std::vector<uint8_t> encoded;
+
+    void writerLoop();
+    bool writeChunk(const Chunk& chunk);
+    void encodeFrame(const float* positions, bool key);
+    void submit(Chunk* chunk);
+
+    //Copying a writer is not allowed
+    TrajectoryWriter(const TrajectoryWriter&);
+    TrajectoryWriter& operator=(const TrajectoryWriter&);
+};
+
+#endif /* TrajectoryWriter_hpp */
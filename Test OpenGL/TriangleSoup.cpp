@@ -1,4 +1,5 @@
 #include "TriangleSoup.hpp"
+#include "VertexNormals.hpp"
 #include <iostream>
 
 /* Constructor: initialize a TriangleSoup object to all zeros */
@@ -8,6 +9,7 @@ TriangleSoup::TriangleSoup() {
 	indexbuffer = 0;
 	vertexarray = NULL;
 	indexarray = NULL;
+	meshcache = NULL;
 	nverts = 0;
 	ntris = 0;
 }
@@ -36,6 +38,15 @@ void TriangleSoup::clean() {
 	}
 	indexbuffer = 0;
 
+	positionstream.clean();
+
+	if(meshcache) {
+		// The arrays point into the mapped cache file
+		delete meshcache;
+		meshcache = NULL;
+		vertexarray = NULL;
+		indexarray = NULL;
+	}
 	if(vertexarray) {
 		delete[] vertexarray;
 		vertexarray = NULL;
@@ -95,6 +106,30 @@ void TriangleSoup::createBox(float xsize, float ysize, float zsize, float xtrans
     for(int i=0; i<3*ntris; i++) {
         indexarray[i]=index_array_data[i];
     }
+    //The corners are shared by three sides, so they get the area-weighted average of their normals
+    VertexNormals normals;
+    normals.create(indexarray, ntris, nverts);
+    normals.compute(vertexarray, 8, vertexarray+3, 8);
+}
+
+/* Load geometry from an OBJ file through its .b3dmesh cache (see
+ * MeshCache::load). The arrays point directly into the mapped cache,
+ * which is kept in meshcache until the object is cleaned. */
+void TriangleSoup::loadOBJ(const char *filename, ThreadPool *pool) {
+
+	clean();
+	MeshCache *cache = new MeshCache();
+	if(!cache->load(filename, pool)) {
+		printError(filename, cache->error.c_str());
+		delete cache;
+		return;
+	}
+
+	meshcache = cache;
+	vertexarray = cache->vertices;
+	indexarray = cache->indices;
+	nverts = cache->nVertices;
+	ntris = cache->nTriangles;
 }
 
 //Updates the positions of the vertices
@@ -104,8 +139,13 @@ void TriangleSoup::updateVertexArray(int index, float x, float y, float z){
         vertexarray[index+2]=z;
 }
 
-//Function to activate and bind buffers
+//Function to create the VAO and upload the arrays, once
 void TriangleSoup::generateVAO(){
+	// The arrays are already in OpenGL
+	if(vao != 0) {
+		return;
+	}
+
 	// Generate one vertex array object (VAO) and bind it
 	glGenVertexArrays(1, &(vao));
 	glBindVertexArray(vao);
@@ -152,6 +192,31 @@ void TriangleSoup::generateVAO(){
     
 };
 
+/* Stream the positions and normals to OpenGL: copy them to the next buffer
+ * of the ring and point the position and normal attributes of the VAO at it.
+ * The texture coordinates stay in the static vertex buffer. */
+void TriangleSoup::updatePositions() {
+	generateVAO();
+	if(positionstream.size == 0) {
+		positionstream.create(GL_ARRAY_BUFFER, 6*nverts*sizeof(GLfloat));
+	}
+	GLfloat *positions = (GLfloat*)positionstream.map();
+	if(positions) {
+		for(int i=0; i<nverts; i++) {
+			for(int d=0; d<6; d++) {
+				positions[6*i+d] = vertexarray[8*i+d];
+			}
+		}
+		positionstream.unmap();
+	}
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, positionstream.buffer());
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), (void*)0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(GLfloat), (void*)(3*sizeof(GLfloat)));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 /* Print data from a TriangleSoup object, for debugging purposes */
 void TriangleSoup::print() {
      int i;
@@ -176,6 +241,8 @@ void TriangleSoup::render() {
 	glDrawElements(GL_TRIANGLES, 3 * ntris, GL_UNSIGNED_INT, (void*)0);
 	// (mode, vertex count, type, element array buffer offset)
 	glBindVertexArray(0);
+	// The stream buffer just drawn is not written again until the draw is done
+	positionstream.fence();
 
 };
 
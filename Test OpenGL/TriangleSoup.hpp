@@ -6,8 +6,11 @@
  * arrays or procedural descriptions.
  * The method loadOBJ() loads geometry from an OBJ file.
  * Only the mesh is loaded. Material information is ignored.
- * Only triangles are supported. OBJ files with quads are rejected.
- * Call render() to draw the mesh in OpenGL. */
+ * Faces with more than three corners are split into triangle fans.
+ * Call generateVAO() once to send the mesh to OpenGL, and render() to draw it.
+ * If the positions change, call updatePositions() before render() to stream
+ * them and the normals to OpenGL. The rest of the mesh is never sent again.
+ * The normals can be recomputed from the positions with VertexNormals. */
 /* Author: Stefan Gustavson 2013-2014 (stefan.gustavson@liu.se)
  * This code is in the public domain.
  *
@@ -34,6 +37,9 @@
 #endif // M_PI
 
 #include "Utilities.hpp"  // To be able to use OpenGL extensions
+#include "ThreadPool.hpp" // To parse large OBJ files on several threads
+#include "MeshCache.hpp"  // For the binary cache of OBJ files
+#include "StreamBuffer.hpp" // For positions that change every frame
 
 /* A struct to hold geometry data and send it off for rendering */
 class TriangleSoup {
@@ -46,6 +52,8 @@ public:
     GLuint indexbuffer;     // Buffer ID to bind to GL_ELEMENT_ARRAY_BUFFER
     GLfloat *vertexarray;   // Vertex array on interleaved format: x y z nx ny nz s t
     GLuint *indexarray;     // Element index array
+    MeshCache *meshcache;   // Cache file the arrays point into, NULL if the arrays are allocated with new[]
+    StreamBuffer positionstream; // Ring of buffers the positions are streamed through, unused for static meshes
     
     int nverts;             // Number of vertices in the vertex array
     int ntris;              // Number of triangles in the index array (may be zero)
@@ -59,15 +67,27 @@ TriangleSoup();
 /* Clean up allocated data in a triangleSoup object */
 void clean();
 
-/* Create a box geometry */
+/* Create a box geometry, with the normals of its 8 corners averaged from the sides */
 void createBox(float xsize, float ysize, float zsize, float xtrans, float ytrans, float ztrans);
 
-/* Activates and binds buffers */
+/* Load geometry from an OBJ file, optionally parsing it on the threads of a pool.
+ * Faces with more than three corners are split into triangles.
+ * The parsed mesh is saved in a .b3dmesh cache next to the OBJ file,
+ * which is memory-mapped instead of parsing the OBJ file the next time.
+ * On failure an error is printed and the object is left empty. */
+void loadOBJ(const char *filename, ThreadPool *pool = NULL);
+
+/* Create the vertex array object and upload the vertex and index arrays.
+ * Only the first call does anything, later changes are sent with updatePositions(). */
 void generateVAO();
     
 /* Updates the positions of the vertices */
 void updateVertexArray(int index, float x, float y, float z);
 
+/* Stream the positions and normals of the vertex array to OpenGL. The first
+ * call switches them in the VAO to the ring of stream buffers. */
+void updatePositions();
+
 /* Print data from a triangleSoup object, for debugging purposes */
 void print();
 
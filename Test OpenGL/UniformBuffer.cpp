@@ -0,0 +1,48 @@
+//  UniformBuffer.cpp
+// Class for a uniform buffer object shared by all programs with the same uniform block.
+
+#include "UniformBuffer.hpp"
+
+//Constructor
+UniformBuffer::UniformBuffer(){
+    buffer = 0;
+    binding = 0;
+    size = 0;
+}
+
+//Destructor
+UniformBuffer::~UniformBuffer(){
+    clean();
+}
+
+//Function to create the buffer and attach it to a binding point, where it stays
+void UniformBuffer::create(GLsizeiptr size, GLuint binding){
+    clean();
+    this->size = size;
+    this->binding = binding;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+//Function to free the buffer
+void UniformBuffer::clean(){
+    if(buffer != 0) {
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    size = 0;
+}
+
+//Function to replace the contents of the buffer. The whole buffer is written, so the driver can give it new
+//storage instead of waiting for draws that still read the old data
+void UniformBuffer::update(const void* data){
+    if(buffer == 0) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
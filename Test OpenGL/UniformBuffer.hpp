@@ -0,0 +1,58 @@
+//  UniformBuffer.hpp
+// Class for a uniform buffer object, which holds the data of a uniform block for all programs that use the block.
+// The buffer is attached to a binding point once, every program connects its block to the same binding point with
+// Shader::bindUniformBlock(), and the data is then changed with one buffer write for all programs and draws.
+// The layout of the C++ struct written to it must follow the std140 rules of the block in GLSL.
+
+#ifndef UniformBuffer_hpp
+#define UniformBuffer_hpp
+
+#ifdef __APPLE__
+#define GLFW_INCLUDE_GLCOREARB
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "Utilities.hpp"
+#include "Mat4.hpp"
+
+//The matrices of the camera and the model, the uniform block Matrices of the shaders:
+//    layout(std140) uniform Matrices { mat4 MV; mat4 P; mat4 M2; };
+//A mat4 is 4 columns of 16 bytes in std140, the same as a Mat4
+struct MatrixBlock {
+    Mat4 MV;                        // Modelview matrix of the camera
+    Mat4 P;                         // Projection matrix
+    Mat4 M2;                        // Rotation of the model
+};
+
+//The binding point of the uniform block Matrices
+static const GLuint MATRIX_BLOCK_BINDING = 0;
+
+class UniformBuffer {
+public:
+
+    GLuint buffer;                  // The buffer object
+    GLuint binding;                 // The binding point it is attached to
+    GLsizeiptr size;                // Size of the buffer in bytes
+
+    //Constructor
+    UniformBuffer();
+    //Destructor
+    ~UniformBuffer();
+
+    //Function to create a buffer of the given size in bytes and attach it to a binding point
+    void create(GLsizeiptr size, GLuint binding);
+
+    //Function to free the buffer
+    void clean();
+
+    //Function to replace the whole contents of the buffer, size bytes from data
+    void update(const void* data);
+
+private:
+    //Copying would share the buffer, so it is not allowed
+    UniformBuffer(const UniformBuffer&);
+    UniformBuffer& operator=(const UniformBuffer&);
+};
+
+#endif /* UniformBuffer_hpp */
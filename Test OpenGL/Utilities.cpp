@@ -50,6 +50,28 @@ PFNGLENABLEVERTEXATTRIBARRAYPROC  glEnableVertexAttribArray  = NULL;
 PFNGLVERTEXATTRIBPOINTERPROC      glVertexAttribPointer      = NULL;
 PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray = NULL;
 PFNGLGENERATEMIPMAPPROC           glGenerateMipmap           = NULL;
+PFNGLBUFFERSUBDATAPROC            glBufferSubData            = NULL;
+PFNGLACTIVETEXTUREPROC            glActiveTexture            = NULL;
+PFNGLTEXBUFFERPROC                glTexBuffer                = NULL;
+PFNGLDRAWELEMENTSINSTANCEDPROC    glDrawElementsInstanced    = NULL;
+PFNGLMAPBUFFERRANGEPROC           glMapBufferRange           = NULL;
+PFNGLUNMAPBUFFERPROC              glUnmapBuffer              = NULL;
+PFNGLFENCESYNCPROC                glFenceSync                = NULL;
+PFNGLCLIENTWAITSYNCPROC           glClientWaitSync           = NULL;
+PFNGLDELETESYNCPROC               glDeleteSync               = NULL;
+PFNGLGETACTIVEUNIFORMPROC         glGetActiveUniform         = NULL;
+PFNGLGETUNIFORMBLOCKINDEXPROC     glGetUniformBlockIndex     = NULL;
+PFNGLUNIFORMBLOCKBINDINGPROC      glUniformBlockBinding      = NULL;
+PFNGLBINDBUFFERBASEPROC           glBindBufferBase           = NULL;
+PFNGLGENQUERIESPROC               glGenQueries               = NULL;
+PFNGLDELETEQUERIESPROC            glDeleteQueries            = NULL;
+PFNGLBEGINQUERYPROC               glBeginQuery               = NULL;
+PFNGLENDQUERYPROC                 glEndQuery                 = NULL;
+PFNGLGETQUERYOBJECTIVPROC         glGetQueryObjectiv         = NULL;
+PFNGLGETQUERYOBJECTUI64VPROC      glGetQueryObjectui64v      = NULL;
+PFNGLGETPROGRAMBINARYPROC         glGetProgramBinary         = NULL;
+PFNGLPROGRAMBINARYPROC            glProgramBinary            = NULL;
+PFNGLPROGRAMPARAMETERIPROC        glProgramParameteri        = NULL;
 #endif
 
 
@@ -128,6 +150,54 @@ void Utilities::loadExtensions() {
 	   		printError("GL init error", "The required OpenGL function glGenerateMipmap() was not found");
             return;
         }
+
+	glBufferSubData         = (PFNGLBUFFERSUBDATAPROC)glfwGetProcAddress("glBufferSubData");
+	glActiveTexture         = (PFNGLACTIVETEXTUREPROC)glfwGetProcAddress("glActiveTexture");
+	glTexBuffer             = (PFNGLTEXBUFFERPROC)glfwGetProcAddress("glTexBuffer");
+	glDrawElementsInstanced = (PFNGLDRAWELEMENTSINSTANCEDPROC)glfwGetProcAddress("glDrawElementsInstanced");
+	if( !glBufferSubData || !glActiveTexture || !glTexBuffer || !glDrawElementsInstanced )
+    	{
+	   		printError("GL init error", "One or more required OpenGL instanced rendering functions were not found");
+            return;
+        }
+
+	glMapBufferRange        = (PFNGLMAPBUFFERRANGEPROC)glfwGetProcAddress("glMapBufferRange");
+	glUnmapBuffer           = (PFNGLUNMAPBUFFERPROC)glfwGetProcAddress("glUnmapBuffer");
+	glFenceSync             = (PFNGLFENCESYNCPROC)glfwGetProcAddress("glFenceSync");
+	glClientWaitSync        = (PFNGLCLIENTWAITSYNCPROC)glfwGetProcAddress("glClientWaitSync");
+	glDeleteSync            = (PFNGLDELETESYNCPROC)glfwGetProcAddress("glDeleteSync");
+	if( !glMapBufferRange || !glUnmapBuffer || !glFenceSync || !glClientWaitSync || !glDeleteSync )
+    	{
+	   		printError("GL init error", "One or more required OpenGL buffer streaming functions were not found");
+            return;
+        }
+
+	glGetActiveUniform      = (PFNGLGETACTIVEUNIFORMPROC)glfwGetProcAddress("glGetActiveUniform");
+	glGetUniformBlockIndex  = (PFNGLGETUNIFORMBLOCKINDEXPROC)glfwGetProcAddress("glGetUniformBlockIndex");
+	glUniformBlockBinding   = (PFNGLUNIFORMBLOCKBINDINGPROC)glfwGetProcAddress("glUniformBlockBinding");
+	glBindBufferBase        = (PFNGLBINDBUFFERBASEPROC)glfwGetProcAddress("glBindBufferBase");
+	if( !glGetActiveUniform || !glGetUniformBlockIndex || !glUniformBlockBinding || !glBindBufferBase )
+    	{
+	   		printError("GL init error", "One or more required OpenGL uniform block functions were not found");
+            return;
+        }
+
+	glGenQueries            = (PFNGLGENQUERIESPROC)glfwGetProcAddress("glGenQueries");
+	glDeleteQueries         = (PFNGLDELETEQUERIESPROC)glfwGetProcAddress("glDeleteQueries");
+	glBeginQuery            = (PFNGLBEGINQUERYPROC)glfwGetProcAddress("glBeginQuery");
+	glEndQuery              = (PFNGLENDQUERYPROC)glfwGetProcAddress("glEndQuery");
+	glGetQueryObjectiv      = (PFNGLGETQUERYOBJECTIVPROC)glfwGetProcAddress("glGetQueryObjectiv");
+	glGetQueryObjectui64v   = (PFNGLGETQUERYOBJECTUI64VPROC)glfwGetProcAddress("glGetQueryObjectui64v");
+	if( !glGenQueries || !glDeleteQueries || !glBeginQuery || !glEndQuery || !glGetQueryObjectiv || !glGetQueryObjectui64v )
+    	{
+	   		printError("GL init error", "One or more required OpenGL query functions were not found");
+            return;
+        }
+
+	// Optional: without them, shader programs are compiled on every start
+	glGetProgramBinary      = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+	glProgramBinary         = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+	glProgramParameteri     = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
 #endif
 }
 
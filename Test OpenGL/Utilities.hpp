@@ -58,6 +58,29 @@ extern PFNGLENABLEVERTEXATTRIBARRAYPROC  glEnableVertexAttribArray;
 extern PFNGLVERTEXATTRIBPOINTERPROC      glVertexAttribPointer;
 extern PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray;
 extern PFNGLGENERATEMIPMAPPROC           glGenerateMipmap;
+extern PFNGLBUFFERSUBDATAPROC            glBufferSubData;
+extern PFNGLACTIVETEXTUREPROC            glActiveTexture;
+extern PFNGLTEXBUFFERPROC                glTexBuffer;
+extern PFNGLDRAWELEMENTSINSTANCEDPROC    glDrawElementsInstanced;
+extern PFNGLMAPBUFFERRANGEPROC           glMapBufferRange;
+extern PFNGLUNMAPBUFFERPROC              glUnmapBuffer;
+extern PFNGLFENCESYNCPROC                glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC           glClientWaitSync;
+extern PFNGLDELETESYNCPROC               glDeleteSync;
+extern PFNGLGETACTIVEUNIFORMPROC         glGetActiveUniform;
+extern PFNGLGETUNIFORMBLOCKINDEXPROC     glGetUniformBlockIndex;
+extern PFNGLUNIFORMBLOCKBINDINGPROC      glUniformBlockBinding;
+extern PFNGLBINDBUFFERBASEPROC           glBindBufferBase;
+extern PFNGLGENQUERIESPROC               glGenQueries;
+extern PFNGLDELETEQUERIESPROC            glDeleteQueries;
+extern PFNGLBEGINQUERYPROC               glBeginQuery;
+extern PFNGLENDQUERYPROC                 glEndQuery;
+extern PFNGLGETQUERYOBJECTIVPROC         glGetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64VPROC      glGetQueryObjectui64v;
+// Optional, NULL if the driver can not save programs, see Shader
+extern PFNGLGETPROGRAMBINARYPROC         glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC            glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC        glProgramParameteri;
 
 #endif
 
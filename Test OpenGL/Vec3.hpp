@@ -0,0 +1,249 @@
+//  Vec3.hpp
+// Header-only class for 3D vectors of positions, velocities and forces, with the usual arithmetic operators.
+// BasicVec3<T> stores its components as T, and Vec3 is the vector of floats used by the simulation. Expressions
+// mixing vectors of float and of double are computed in double, as the same expressions on numbers would be.
+// The operators do not compute anything themselves: a + b, a - b, s * a and a / s return small expression objects
+// that only remember their operands, and the components are computed when the whole expression is assigned to a
+// Vec3. An expression such as
+//     force -= k * (p1 - p2) + c * (v1 - v2);
+// is therefore evaluated one component at a time, directly from the operands, without any intermediate vectors,
+// and compiles to the same code as the expression written out for x, y and z.
+// dot() and length() evaluate an expression to a number. cross() and normalize() need every component of their
+// operands more than once, so they evaluate the operands first and return a Vec3.
+
+#ifndef Vec3_hpp
+#define Vec3_hpp
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+//Base class of all vector expressions. E is the expression itself, which has a function get(i) that computes
+//component i (0, 1 or 2) of the result
+template<class E>
+struct Vec3Expr {
+    //Function to return the expression itself
+    const E& self() const {
+        return static_cast<const E&>(*this);
+    }
+};
+
+//The type of the components computed by an expression
+template<class E>
+struct Vec3Scalar {
+    typedef typename std::decay<decltype(std::declval<const E&>().get(0))>::type type;
+};
+
+template<class T>
+class BasicVec3 : public Vec3Expr<BasicVec3<T> > {
+public:
+    T x; // the x value of the Vector
+    T y; // the y value of the Vector
+    T z; // the z value of the Vector
+
+    //Constructors
+    BasicVec3() : x(0), y(0), z(0) {}
+    BasicVec3(T x, T y, T z) : x(x), y(y), z(z) {}
+
+    //Constructor that evaluates an expression, converting its components to T
+    template<class E>
+    BasicVec3(const Vec3Expr<E>& e) : x((T)e.self().get(0)), y((T)e.self().get(1)), z((T)e.self().get(2)) {}
+
+    //Function to assign the value of an expression. The expression may contain the vector itself
+    template<class E>
+    BasicVec3& operator=(const Vec3Expr<E>& e) {
+        T ex = (T)e.self().get(0), ey = (T)e.self().get(1), ez = (T)e.self().get(2);
+        x = ex;
+        y = ey;
+        z = ez;
+        return *this;
+    }
+
+    //Functions to add, subtract, scale and divide in place
+    template<class E>
+    BasicVec3& operator+=(const Vec3Expr<E>& e) {
+        T ex = (T)e.self().get(0), ey = (T)e.self().get(1), ez = (T)e.self().get(2);
+        x += ex;
+        y += ey;
+        z += ez;
+        return *this;
+    }
+    template<class E>
+    BasicVec3& operator-=(const Vec3Expr<E>& e) {
+        T ex = (T)e.self().get(0), ey = (T)e.self().get(1), ez = (T)e.self().get(2);
+        x -= ex;
+        y -= ey;
+        z -= ez;
+        return *this;
+    }
+    BasicVec3& operator*=(T s) {
+        x *= s;
+        y *= s;
+        z *= s;
+        return *this;
+    }
+    BasicVec3& operator/=(T s) {
+        x /= s;
+        y /= s;
+        z /= s;
+        return *this;
+    }
+
+    //Function to return component i. i is a constant wherever this is called, so the choice disappears
+    T get(int i) const {
+        return i == 0 ? x : (i == 1 ? y : z);
+    }
+
+    //Function to return the squared length of the vector
+    T lengthSquared() const {
+        return x * x + y * y + z * z;
+    }
+    //Function to return the length of the vector
+    T length() const {
+        return std::sqrt(lengthSquared());
+    }
+};
+
+//The vector of the simulation
+typedef BasicVec3<float> Vec3;
+
+//Operands are kept by reference if they are vectors and by value if they are expressions. The expressions are
+//temporaries that only live until the end of the statement, and they are only a few references and numbers
+template<class E>
+struct Vec3Operand {
+    typedef const E type;
+};
+template<class T>
+struct Vec3Operand<BasicVec3<T> > {
+    typedef const BasicVec3<T>& type;
+};
+
+//Expression a + b
+template<class A, class B>
+struct Vec3Sum : public Vec3Expr<Vec3Sum<A, B> > {
+    typename Vec3Operand<A>::type a;
+    typename Vec3Operand<B>::type b;
+    Vec3Sum(const A& a, const B& b) : a(a), b(b) {}
+    auto get(int i) const -> decltype(a.get(i) + b.get(i)) {
+        return a.get(i) + b.get(i);
+    }
+};
+
+//Expression a - b
+template<class A, class B>
+struct Vec3Difference : public Vec3Expr<Vec3Difference<A, B> > {
+    typename Vec3Operand<A>::type a;
+    typename Vec3Operand<B>::type b;
+    Vec3Difference(const A& a, const B& b) : a(a), b(b) {}
+    auto get(int i) const -> decltype(a.get(i) - b.get(i)) {
+        return a.get(i) - b.get(i);
+    }
+};
+
+//Expression -a
+template<class A>
+struct Vec3Negation : public Vec3Expr<Vec3Negation<A> > {
+    typename Vec3Operand<A>::type a;
+    explicit Vec3Negation(const A& a) : a(a) {}
+    typename Vec3Scalar<A>::type get(int i) const {
+        return -a.get(i);
+    }
+};
+
+//Expression s * a. The number is converted to the type of the components of a, so 0.5 * a is computed in float
+//for a vector of floats
+template<class A>
+struct Vec3Scaled : public Vec3Expr<Vec3Scaled<A> > {
+    typedef typename Vec3Scalar<A>::type Scalar;
+    Scalar s;
+    typename Vec3Operand<A>::type a;
+    Vec3Scaled(Scalar s, const A& a) : s(s), a(a) {}
+    Scalar get(int i) const {
+        return s * a.get(i);
+    }
+};
+
+//Expression a / s. Every component is divided, as when it is written out, instead of multiplied by 1/s
+template<class A>
+struct Vec3Quotient : public Vec3Expr<Vec3Quotient<A> > {
+    typedef typename Vec3Scalar<A>::type Scalar;
+    typename Vec3Operand<A>::type a;
+    Scalar s;
+    Vec3Quotient(const A& a, Scalar s) : a(a), s(s) {}
+    Scalar get(int i) const {
+        return a.get(i) / s;
+    }
+};
+
+//Operators that build the expressions
+template<class A, class B>
+inline Vec3Sum<A, B> operator+(const Vec3Expr<A>& a, const Vec3Expr<B>& b) {
+    return Vec3Sum<A, B>(a.self(), b.self());
+}
+template<class A, class B>
+inline Vec3Difference<A, B> operator-(const Vec3Expr<A>& a, const Vec3Expr<B>& b) {
+    return Vec3Difference<A, B>(a.self(), b.self());
+}
+template<class A>
+inline Vec3Negation<A> operator-(const Vec3Expr<A>& a) {
+    return Vec3Negation<A>(a.self());
+}
+template<class A>
+inline Vec3Scaled<A> operator*(typename Vec3Scalar<A>::type s, const Vec3Expr<A>& a) {
+    return Vec3Scaled<A>(s, a.self());
+}
+template<class A>
+inline Vec3Scaled<A> operator*(const Vec3Expr<A>& a, typename Vec3Scalar<A>::type s) {
+    return Vec3Scaled<A>(s, a.self());
+}
+template<class A>
+inline Vec3Quotient<A> operator/(const Vec3Expr<A>& a, typename Vec3Scalar<A>::type s) {
+    return Vec3Quotient<A>(a.self(), s);
+}
+
+//Function to return the dot product of two expressions
+template<class A, class B>
+inline auto dot(const Vec3Expr<A>& a, const Vec3Expr<B>& b) -> decltype(a.self().get(0) * b.self().get(0)) {
+    return a.self().get(0) * b.self().get(0) + a.self().get(1) * b.self().get(1) + a.self().get(2) * b.self().get(2);
+}
+
+//Function to return the length of an expression
+template<class A>
+inline typename Vec3Scalar<A>::type length(const Vec3Expr<A>& a) {
+    return std::sqrt(dot(a, a));
+}
+
+//Function to return the cross product of two expressions
+template<class A, class B>
+inline auto cross(const Vec3Expr<A>& a, const Vec3Expr<B>& b) -> BasicVec3<decltype(a.self().get(0) * b.self().get(0))> {
+    typedef decltype(a.self().get(0) * b.self().get(0)) T;
+    BasicVec3<T> u(a), v(b);
+    return BasicVec3<T>(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+}
+
+//Function to return 1 / sqrt(x). The estimate instruction of the processor (rsqrtss) is not used: its result
+//depends on the processor model, and the simulation must give the same result on every machine
+inline float rsqrt(float x) {
+    return 1.0f / sqrtf(x);
+}
+inline double rsqrt(double x) {
+    return 1.0 / sqrt(x);
+}
+
+//Shortest vector that can be normalized. Shorter vectors have no usable direction
+const float VEC3_MIN_LENGTH = 1e-9f;
+
+//Function to return the vector scaled to length 1, with one square root and no division per component.
+//A vector shorter than VEC3_MIN_LENGTH has no direction, and the zero vector is returned
+template<class A>
+inline BasicVec3<typename Vec3Scalar<A>::type> normalize(const Vec3Expr<A>& a) {
+    typedef typename Vec3Scalar<A>::type T;
+    BasicVec3<T> v(a);
+    T lengthSquared = v.lengthSquared();
+    if(!(lengthSquared > (T)VEC3_MIN_LENGTH * (T)VEC3_MIN_LENGTH)) {
+        return BasicVec3<T>();
+    }
+    return rsqrt(lengthSquared) * v;
+}
+
+#endif /* Vec3_hpp */
@@ -1,5 +1,7 @@
 //  Vector.hpp
-// This class is used to create vectors to store coordinates in. The class is used to define coordinates and velocities.
+// Vectors to store coordinates in. The vectors are used to define coordinates, velocities and forces.
+// Vector is the Vec3 class of Vec3.hpp, which has the arithmetic operators. BasicVector<T> is the vector with
+// components of another type, such as BasicVector<double>.
 
 #ifndef Vector_hpp
 #define Vector_hpp
@@ -8,20 +10,13 @@
 #include <iostream>
 #include <cmath>
 
+#include "Vec3.hpp"
+
 using namespace std;
 
-class Vector {
-public:
-    float x; // the x value of the Vector
-    float y; // the y value of the Vector
-    float z; // the z value of the Vector
-    
-    //Constructors
-    Vector();
-    Vector(float x, float y, float z);
-    //Function to return the length of the vector
-    float length();
-
-};
+typedef Vec3 Vector;
+
+template<class T>
+using BasicVector = BasicVec3<T>;
 
 #endif /* Vector_hpp */
@@ -1,7 +1,9 @@
 #version 330 core
-uniform mat4 MV;
-uniform mat4 P;
-uniform mat4 M2;
+layout(std140) uniform Matrices { // Shared by all programs, see MatrixBlock in UniformBuffer.hpp
+    mat4 MV;
+    mat4 P;
+    mat4 M2;
+};
 out vec2 st;
 out vec3 interpolatedNormal;
 layout(location=0)in vec3 Position;
@@ -0,0 +1,180 @@
+//  VertexNormals.cpp
+// Class for recomputing the area-weighted vertex normals of a deforming triangle mesh.
+
+#include "VertexNormals.hpp"
+#include "ParticleSystem.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VERTEXNORMALS_X86
+#include <immintrin.h>
+#endif
+
+//Constructor
+VertexNormals::VertexNormals(){
+    nverts = 0;
+    ntris = 0;
+    nComputed = 0;
+    nSkipped = 0;
+}
+
+//Function to find the triangles around every vertex, with a counting sort of the corners of all triangles by vertex
+void VertexNormals::create(const unsigned int* indices, int ntris, int nverts, int ncopies){
+    this->nverts = nverts;
+    this->ntris = ntris;
+
+    triangleStart.assign(nverts + 1, 0);
+    for(int i = 0; i < 3 * ntris; i++) {
+        if(indices[i] < (unsigned int)nverts) {
+            triangleStart[indices[i] + 1]++;
+        }
+    }
+    for(int v = 0; v < nverts; v++) {
+        triangleStart[v + 1] += triangleStart[v];
+    }
+    vertexTriangles.resize(triangleStart[nverts]);
+    std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+    for(int i = 0; i < 3 * ntris; i++) {
+        if(indices[i] < (unsigned int)nverts) {
+            vertexTriangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    //Triangles with a vertex out of range use vertex 0 for all corners, which gives a zero cross product
+    corners.assign(3 * ntris, 0);
+    for(int t = 0; t < ntris; t++) {
+        const unsigned int* c = indices + 3 * t;
+        if(c[0] < (unsigned int)nverts && c[1] < (unsigned int)nverts && c[2] < (unsigned int)nverts) {
+            corners[3*t] = c[0];
+            corners[3*t+1] = c[1];
+            corners[3*t+2] = c[2];
+        }
+    }
+    faceNormals.assign(4 * ntris, 0.0f);
+    packedPositions.assign(4 * nverts, 0.0f);
+
+    lastPositions.assign((size_t)3 * nverts * ncopies, 0.0f);
+    valid.assign(ncopies, 0);
+}
+
+//Function to set the normal of a vertex to the normalized sum of the cross products of its triangles
+static inline void normalize(float nx, float ny, float nz, float* n){
+    float length = sqrtf(nx*nx + ny*ny + nz*nz);
+    if(length > 0.0f) {
+        n[0] = nx / length;
+        n[1] = ny / length;
+        n[2] = nz / length;
+    }
+    else {
+        n[0] = 0.0f;
+        n[1] = 0.0f;
+        n[2] = 1.0f;
+    }
+}
+
+//Function to compute the normals one triangle and one vertex at a time
+void VertexNormals::computeScalar(const float* p, int stride, float* normals, int normalStride){
+    float* f = &faceNormals[0];
+    for(int t = 0; t < ntris; t++) {
+        const float* a = p + (size_t)stride * corners[3*t];
+        const float* b = p + (size_t)stride * corners[3*t+1];
+        const float* c = p + (size_t)stride * corners[3*t+2];
+        float e1x = b[0] - a[0], e1y = b[1] - a[1], e1z = b[2] - a[2];
+        float e2x = c[0] - a[0], e2y = c[1] - a[1], e2z = c[2] - a[2];
+        f[4*t] = e1y * e2z - e1z * e2y;
+        f[4*t+1] = e1z * e2x - e1x * e2z;
+        f[4*t+2] = e1x * e2y - e1y * e2x;
+    }
+    for(int v = 0; v < nverts; v++) {
+        float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+        for(int k = triangleStart[v]; k < triangleStart[v + 1]; k++) {
+            const float* face = f + 4 * vertexTriangles[k];
+            nx += face[0];
+            ny += face[1];
+            nz += face[2];
+        }
+        normalize(nx, ny, nz, normals + (size_t)normalStride * v);
+    }
+}
+
+#ifdef VERTEXNORMALS_X86
+
+//Function to compute the normals with SSE: the positions are first copied to 4 floats per vertex, so every corner
+//of a triangle is one aligned load, and the cross product of a triangle and the sum of the cross products of a
+//vertex are computed with all three coordinates in one register. The operations on every coordinate are the same
+//as in the scalar version, so the results are the same
+void VertexNormals::computeSSE(const float* p, int stride, float* normals, int normalStride){
+    float* packed = &packedPositions[0];
+    for(int v = 0; v < nverts; v++) {
+        const float* q = p + (size_t)stride * v;
+        packed[4*v] = q[0];
+        packed[4*v+1] = q[1];
+        packed[4*v+2] = q[2];
+    }
+    float* f = &faceNormals[0];
+    for(int t = 0; t < ntris; t++) {
+        __m128 a = _mm_loadu_ps(packed + 4 * corners[3*t]);
+        __m128 e1 = _mm_sub_ps(_mm_loadu_ps(packed + 4 * corners[3*t+1]), a);
+        __m128 e2 = _mm_sub_ps(_mm_loadu_ps(packed + 4 * corners[3*t+2]), a);
+        //(y, z, x) and (z, x, y) of the edges
+        __m128 e1yzx = _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 e1zxy = _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 e2yzx = _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 e2zxy = _mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 1, 0, 2));
+        _mm_storeu_ps(f + 4 * t, _mm_sub_ps(_mm_mul_ps(e1yzx, e2zxy), _mm_mul_ps(e1zxy, e2yzx)));
+    }
+    for(int v = 0; v < nverts; v++) {
+        __m128 sum = _mm_setzero_ps();
+        for(int k = triangleStart[v]; k < triangleStart[v + 1]; k++) {
+            sum = _mm_add_ps(sum, _mm_loadu_ps(f + 4 * vertexTriangles[k]));
+        }
+        float n[4];
+        _mm_storeu_ps(n, sum);
+        normalize(n[0], n[1], n[2], normals + (size_t)normalStride * v);
+    }
+}
+
+#endif
+
+//Function to compute the normals of all vertices: the cross products of all triangles, then for every vertex the
+//sum over the triangles around it. A vertex without triangles, or only degenerate ones, gets the normal (0,0,1)
+void VertexNormals::compute(const float* positions, int positionStride, float* normals, int normalStride){
+    if(nverts == 0) {
+        return;
+    }
+#ifdef VERTEXNORMALS_X86
+    if(ParticleSystem::getSimdLevel() >= SIMD_SSE) {
+        computeSSE(positions, positionStride, normals, normalStride);
+        return;
+    }
+#endif
+    computeScalar(positions, positionStride, normals, normalStride);
+}
+
+//Function to compute the normals of one copy if its positions changed. The positions are compared with the last
+//ones while they are copied, which costs much less than the normals
+bool VertexNormals::update(int copy, const float* positions, int positionStride, float* normals, int normalStride){
+    if(nverts == 0) {
+        return false;
+    }
+    float* last = &lastPositions[(size_t)3 * nverts * copy];
+    bool changed = !valid[copy];
+    for(int v = 0; v < nverts; v++) {
+        const float* p = positions + (size_t)positionStride * v;
+        if(last[3*v] != p[0] || last[3*v+1] != p[1] || last[3*v+2] != p[2]) {
+            last[3*v] = p[0];
+            last[3*v+1] = p[1];
+            last[3*v+2] = p[2];
+            changed = true;
+        }
+    }
+    if(!changed) {
+        nSkipped++;
+        return false;
+    }
+    compute(positions, positionStride, normals, normalStride);
+    valid[copy] = 1;
+    nComputed++;
+    return true;
+}
@@ -0,0 +1,52 @@
+//  VertexNormals.hpp
+// Class for recomputing the vertex normals of a deforming triangle mesh from its positions.
+// The normal of a vertex is the sum of the cross products of the edges of the triangles around it, normalized. The
+// length of a cross product is twice the area of its triangle, so large triangles weigh more than small ones. The
+// triangles around every vertex are found once, in create(), and stored in compressed sparse row (CSR) form, so a
+// recomputation is one pass over the triangles for their cross products and one pass over the vertices gathering
+// them, both with SSE when the processor has it. Copies of the mesh whose positions did not change since their
+// normals were last computed are skipped.
+
+#ifndef VertexNormals_hpp
+#define VertexNormals_hpp
+
+#include <vector>
+
+class VertexNormals {
+public:
+
+    int nverts;                         // Number of vertices of the mesh
+    int ntris;                          // Number of triangles of the mesh
+    std::vector<int> triangleStart;     // Index in vertexTriangles of the first triangle of every vertex, and its size last
+    std::vector<int> vertexTriangles;   // The triangles around every vertex, the triangles of vertex 0 first
+    int nComputed;                      // Number of calls to update() that computed the normals, until reset to 0
+    int nSkipped;                       // Number of calls to update() skipped since the positions had not changed
+
+    //Constructor
+    VertexNormals();
+
+    //Function to find the triangles around every vertex of a mesh with 3 vertex indices per triangle, and make room
+    //for the last positions of n copies of it
+    void create(const unsigned int* indices, int ntris, int nverts, int ncopies = 1);
+
+    //Function to compute the normals of all vertices. The positions and normals are 3 floats at the given stride,
+    //in floats, so they can be part of an interleaved vertex array
+    void compute(const float* positions, int positionStride, float* normals, int normalStride);
+
+    //Function to compute the normals of one copy of the mesh, unless its positions are the same as the last time.
+    //Returns true if the normals were computed
+    bool update(int copy, const float* positions, int positionStride, float* normals, int normalStride);
+
+private:
+    std::vector<unsigned int> corners;  // The vertices of every triangle
+    std::vector<float> faceNormals;     // The cross product of every triangle, 4 floats per triangle
+    std::vector<float> packedPositions; // The positions copied to 4 floats per vertex for the SSE version
+    std::vector<float> lastPositions;   // The positions every copy last had its normals computed from
+    std::vector<char> valid;            // Whether the normals of every copy were computed yet
+
+    //Functions to compute the normals without and with SSE, with the same results
+    void computeScalar(const float* positions, int positionStride, float* normals, int normalStride);
+    void computeSSE(const float* positions, int positionStride, float* normals, int normalStride);
+};
+
+#endif /* VertexNormals_hpp */
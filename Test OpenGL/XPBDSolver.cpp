@@ -0,0 +1,160 @@
+//  XPBDSolver.cpp
+// Class used to simulate a body one step with extended position-based dynamics (XPBD).
+
+#include "XPBDSolver.hpp"
+#include "Profiler.hpp"
+
+//Constructor
+template<class Precision>
+BasicXPBDSolver<Precision>::BasicXPBDSolver(){
+    iterations = 10;
+}
+
+//Data passed to the threads projecting the constraints
+template<class Precision>
+struct ProjectData {
+    BasicXPBDSolver<Precision>* solver;
+    BasicParticleSystem<Precision>* particles;
+    const SpringNetwork* springs;
+    ThreadPool* pool;
+    typename Precision::Accumulator dt;
+    int iterations;
+};
+
+//Function to simulate the masses connected by the springs one step. The positions are first predicted from the
+//velocities and gravity, then moved to satisfy the constraints. The new velocities follow from the positions
+template<class Precision>
+void BasicXPBDSolver<Precision>::step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt,
+                                      ThreadPool* pool){
+    PROFILE_SCOPE("xpbd");
+    int n = particles.capacity;
+    if(springs.nColours == 0 && springs.nSprings > 0) {
+        springs.colourSprings();
+    }
+
+    x0.assign(particles.x, particles.x + n);
+    y0.assign(particles.y, particles.y + n);
+    z0.assign(particles.z, particles.z + n);
+    lambda.assign(springs.nSprings, 0);
+
+    //Predict the positions. Fixed masses keep their velocity
+    for(int i = 0; i < n; i++) {
+        if(particles.invMass[i] > 0) {
+            particles.vy[i] = (Scalar)(particles.vy[i] - particles.gravity * dt);
+        }
+        particles.x[i] = (Scalar)(particles.x[i] + particles.vx[i] * dt);
+        particles.y[i] = (Scalar)(particles.y[i] + particles.vy[i] * dt);
+        particles.z[i] = (Scalar)(particles.z[i] + particles.vz[i] * dt);
+    }
+
+    if(pool == NULL || pool->size() == 1 || springs.nSprings < springs.minParallelSprings) {
+        for(int k = 0; k < iterations; k++) {
+            project(particles, springs, 0, springs.nSprings, dt);
+        }
+    }
+    else {
+        ProjectData<Precision> data = { this, &particles, &springs, pool, dt, iterations };
+        pool->run(projectTask, &data);
+    }
+
+    //The velocities that move the masses from the start of the step to the projected positions
+    Accumulator invDt = 1 / dt;
+    for(int i = 0; i < n; i++) {
+        particles.vx[i] = (Scalar)((particles.x[i] - x0[i]) * invDt);
+        particles.vy[i] = (Scalar)((particles.y[i] - y0[i]) * invDt);
+        particles.vz[i] = (Scalar)((particles.z[i] - z0[i]) * invDt);
+    }
+}
+
+//Task run on every thread: each thread projects its part of every colour. The barrier makes sure that no
+//thread starts on the next colour, which may move the same masses, before all threads are done
+template<class Precision>
+void BasicXPBDSolver<Precision>::projectTask(void* data, int thread, int nThreads){
+    ProjectData<Precision>* d = (ProjectData<Precision>*)data;
+    const SpringNetwork* springs = d->springs;
+    for(int k = 0; k < d->iterations; k++) {
+        for(int c = 0; c < springs->nColours; c++) {
+            int begin, end;
+            ThreadPool::partition(springs->colourStart[c], springs->colourStart[c + 1], thread, nThreads, begin, end);
+            d->solver->project(*d->particles, *springs, begin, end, d->dt);
+            d->pool->barrier();
+        }
+    }
+}
+
+//The function projects the springs in [begin, end). For a spring with stiffness k and damper constant c the
+//compliance is alpha = 1/(k*dt^2) and the damping gamma = alpha*c*dt. The change of the multiplier is
+//    dlambda = (-C - alpha*lambda - gamma*dC/dt*dt) / ((1 + gamma)*(w1 + w2) + alpha)
+//where w1 and w2 are the inverse masses. Afterwards the length is clamped to [springMin, springMax]
+template<class Precision>
+void BasicXPBDSolver<Precision>::project(BasicParticleSystem<Precision>& particles, const SpringNetwork& springs,
+                                         int begin, int end, Accumulator dt){
+    Scalar *x = particles.x, *y = particles.y, *z = particles.z;
+    const Scalar* invMass = particles.invMass;
+    Accumulator dt2 = dt * dt;
+
+    for(int i = begin; i < end; i++) {
+        int m1 = springs.mass1[i];
+        int m2 = springs.mass2[i];
+        Accumulator w1 = invMass[m1];
+        Accumulator w2 = invMass[m2];
+        Accumulator w = w1 + w2;
+        if(w == 0) {
+            continue;
+        }
+
+        Accumulator dx = (Accumulator)x[m1] - x[m2];
+        Accumulator dy = (Accumulator)y[m1] - y[m2];
+        Accumulator dz = (Accumulator)z[m1] - z[m2];
+        Accumulator length = sqrt(dx*dx + dy*dy + dz*dz);
+        if(length < (Accumulator)1e-9f) {
+            continue;
+        }
+        Accumulator nx = dx / length, ny = dy / length, nz = dz / length;
+
+        //The compliant spring constraint
+        Accumulator k = springs.springConstant[i];
+        if(k > 0) {
+            Accumulator alpha = 1 / (k * dt2);
+            Accumulator gamma = alpha * springs.damperConstant[i] * dt;
+            Accumulator C = length - springs.springLength[i];
+            //How fast the spring has been stretched during the step, times dt
+            Accumulator stretch = nx * ((x[m1] - x0[m1]) - (x[m2] - x0[m2]))
+                                + ny * ((y[m1] - y0[m1]) - (y[m2] - y0[m2]))
+                                + nz * ((z[m1] - z0[m1]) - (z[m2] - z0[m2]));
+            Accumulator dlambda = (-C - alpha * lambda[i] - gamma * stretch) / ((1 + gamma) * w + alpha);
+            lambda[i] += dlambda;
+            x[m1] = (Scalar)(x[m1] + w1 * dlambda * nx);
+            y[m1] = (Scalar)(y[m1] + w1 * dlambda * ny);
+            z[m1] = (Scalar)(z[m1] + w1 * dlambda * nz);
+            x[m2] = (Scalar)(x[m2] - w2 * dlambda * nx);
+            y[m2] = (Scalar)(y[m2] - w2 * dlambda * ny);
+            z[m2] = (Scalar)(z[m2] - w2 * dlambda * nz);
+            //The masses were moved along the spring, so the new length is known without another square root
+            length += w * dlambda;
+        }
+
+        //The hard limits of the spring length
+        Accumulator limit = length;
+        if(length > springs.springMax[i]) {
+            limit = springs.springMax[i];
+        }
+        else if(length < springs.springMin[i]) {
+            limit = springs.springMin[i];
+        }
+        if(limit != length) {
+            Accumulator s = (length - limit) / w;
+            x[m1] = (Scalar)(x[m1] - w1 * s * nx);
+            y[m1] = (Scalar)(y[m1] - w1 * s * ny);
+            z[m1] = (Scalar)(z[m1] - w1 * s * nz);
+            x[m2] = (Scalar)(x[m2] + w2 * s * nx);
+            y[m2] = (Scalar)(y[m2] + w2 * s * ny);
+            z[m2] = (Scalar)(z[m2] + w2 * s * nz);
+        }
+    }
+}
+
+//The precisions the class is compiled for
+template class BasicXPBDSolver<FloatPrecision>;
+template class BasicXPBDSolver<DoublePrecision>;
+template class BasicXPBDSolver<MixedPrecision>;
@@ -0,0 +1,44 @@
+//  XPBDSolver.hpp
+// Class used to simulate a body one step with extended position-based dynamics (XPBD). Every spring is a
+// compliant distance constraint C = |x1 - x2| - L with compliance 1/k, so a spring is equally stiff for any
+// timestep and number of iterations. The dampers use the XPBD damping term with the damper constant of the spring.
+// The maximum and minimum spring lengths are enforced as hard constraints after each projection.
+// The constraints are projected Gauss-Seidel style, one colour of the spring network at a time. The springs of one
+// colour share no masses, so they can be projected in parallel and the result does not depend on the threads.
+// The class is a template on the precision of the particle system, and the constraints are projected in its Accumulator.
+
+#ifndef XPBDSolver_hpp
+#define XPBDSolver_hpp
+
+#include <vector>
+
+#include "ParticleSystem.hpp"
+#include "SpringNetwork.hpp"
+
+template<class Precision>
+class BasicXPBDSolver {
+public:
+    typedef typename Precision::Scalar Scalar;
+    typedef typename Precision::Accumulator Accumulator;
+
+    int iterations;         // Number of times every constraint is projected per step
+
+    //Constructor
+    BasicXPBDSolver();
+
+    //Function to simulate the masses connected by the springs one step
+    void step(BasicParticleSystem<Precision>& particles, SpringNetwork& springs, Accumulator dt, ThreadPool* pool);
+
+private:
+    std::vector<Accumulator> lambda;    // The accumulated multiplier of every spring during the step
+    std::vector<Scalar> x0, y0, z0;     // The positions at the start of the step
+
+    //Function to project the constraints of the springs in [begin, end)
+    void project(BasicParticleSystem<Precision>& particles, const SpringNetwork& springs, int begin, int end, Accumulator dt);
+    //Task run on every thread, projecting its part of every colour
+    static void projectTask(void* data, int thread, int nThreads);
+};
+
+typedef BasicXPBDSolver<FloatPrecision> XPBDSolver;
+
+#endif /* XPBDSolver_hpp */
@@ -0,0 +1,500 @@
+/*
+ * box3d_sim - headless simulation of a soft body scene.
+ * Runs a number of steps with a fixed timestep, without opening a window,
+ * and reports the simulation throughput:
+ *   steps per second, nanoseconds per spring evaluation and peak memory use.
+ * The mesh scene also reports the time to recompute the vertex normals of a body,
+ * which the viewer does every frame, next to the time of a step.
+ * With --record the positions of all masses are written to a trajectory file, which
+ * the viewer can replay.
+ * With --precision the scene is simulated in double or mixed precision instead of float.
+ * With --compare-precision a spinning, falling lattice is simulated in float, mixed and
+ * double precision instead, and the time and accuracy of each precision are reported.
+ * Built with the profiler (BOX3D_PROFILE), every step is a frame of the profiler, and
+ * the median and 99th percentile time of the phases of a step are reported.
+ *
+ * Usage: box3d_sim [--scene box|lattice|mesh] [--size n] [--mesh file.obj] [--shear radius] [--bodies n]
+ *                 [--contact distance] [--steps n] [--dt seconds] [--threads n]
+ *                 [--integrator symplectic|verlet|rk4|implicit|xpbd] [--iterations n] [--trace file.json]
+ *                 [--record file.b3dtraj] [--record-every n] [--precision float|double|mixed] [--compare-precision]
+ *   --scene box       the 8-mass box from the viewer (default)
+ *   --scene lattice   a lattice of n*n*n masses
+ *   --scene mesh      a body made from the triangles of an OBJ file, scaled to the size of the box
+ *   --size n          number of masses along each side of the lattice (default 10)
+ *   --mesh file.obj   the OBJ file of the mesh scene (default meshes/teapot.obj)
+ *   --shear radius    add shear springs between masses closer than radius, in the units of the OBJ file
+ *   --bodies n        number of copies of the body, placed in columns above each other (default 1)
+ *   --contact distance  masses of different bodies closer than this collide, 0 turns the collisions off
+ *                     (default the distance between neighbouring masses of the scene)
+ *   --steps n         number of steps to simulate (default 100000)
+ *   --dt seconds      the timestep (default 0.0001)
+ *   --threads n       number of threads evaluating the springs, 0 for one per core (default 1)
+ *   --integrator      symplectic Euler, velocity Verlet, fourth order Runge-Kutta, implicit Euler or XPBD
+ *                     (default symplectic, "explicit" is accepted as another name for it)
+ *   --iterations n    number of constraint iterations per XPBD step (default 10)
+ *   --trace file.json write the phases of the first steps as a Chrome trace, if built with the profiler
+ *   --record file     record the positions of the masses, at the start and every n steps
+ *   --record-every n  number of steps between two recorded frames (default 1, every step)
+ *   --precision       the precision of Precision.hpp the scene is simulated in (default float). Only float uses
+ *                     the SIMD kernels. Trajectories are recorded as floats in every precision
+ *   --compare-precision  compare the precisions of Precision.hpp on a lattice of --size masses along each side,
+ *                     for --steps steps of --dt
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "Scene.hpp"
+#include "VertexNormals.hpp"
+#include "Profiler.hpp"
+
+using namespace std;
+
+//Function to return the peak resident memory of the process in kilobytes, or -1 if it is not available
+static long peakMemoryKB(){
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // Reported in bytes on MacOS
+#else
+    return usage.ru_maxrss;        // Reported in kilobytes on Linux
+#endif
+#endif
+}
+
+static void printUsage(){
+    fprintf(stderr, "Usage: box3d_sim [--scene box|lattice|mesh] [--size n] [--mesh file.obj] [--shear radius] [--bodies n]\n"
+                    "                 [--contact distance] [--steps n] [--dt seconds] [--threads n]\n"
+                    "                 [--integrator symplectic|verlet|rk4|implicit|xpbd] [--iterations n] [--trace file.json]\n"
+                    "                 [--record file.b3dtraj] [--record-every n] [--precision float|double|mixed]\n"
+                    "                 [--compare-precision]\n");
+}
+
+//Function to return the memory used per mass by the arrays of a particle system of a precision
+template<class Precision>
+static size_t bytesPerMass(){
+    //Positions, velocities, previous positions and inverse weights are stored as Scalar, the forces as Accumulator
+    return 10 * sizeof(typename Precision::Scalar) + 3 * sizeof(typename Precision::Accumulator);
+}
+
+//Function to simulate a copy of a body in one precision, with the symplectic Euler method and without colliders.
+//Returns the time taken in seconds, and the final positions of the masses in x, y and z
+template<class Precision>
+static double simulatePrecision(const SoftBody& body, long steps, float dt, vector<double>& x, vector<double>& y, vector<double>& z){
+    const ParticleSystem& particles = body.particles;
+    int n = particles.nParticles;
+    BasicSoftBody<Precision> copy;
+    copy.particles.create(n, 0.0f);
+    for(int i = 0; i < n; i++) {
+        copy.particles.invMass[i] = particles.invMass[i];
+        copy.particles[i]->setStartPos(particles.x[i], particles.y[i], particles.z[i]);
+        copy.particles[i]->setVelocity(particles.vx[i], particles.vy[i], particles.vz[i]);
+    }
+    copy.springs = body.springs;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(long step = 0; step < steps; step++) {
+        copy.step(dt);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    for(int i = 0; i < n; i++) {
+        x[i] = copy.particles.x[i];
+        y[i] = copy.particles.y[i];
+        z[i] = copy.particles.z[i];
+    }
+    return seconds;
+}
+
+//Function to compare the precisions on a lattice of size*size*size masses that spins and falls freely. The springs
+//only exert forces between the masses, so the centre of mass falls exactly as a single mass would, and its error
+//after the last step is the error of the precision alone. The positions are also compared with the double run
+static void comparePrecisions(int size, long steps, float dt){
+    SoftBody body;
+    body.createLattice(size, size, size, 0.3f, 2.0f, 20.0f, 2.0f);
+    //Spinning around the y-axis stretches the springs. The lattice is centred at the origin, so its centre of mass
+    //starts at rest
+    const float spin = 2.0f;
+    for(int i = 0; i < body.particles.nParticles; i++) {
+        body.particles.vx[i] = -spin * body.particles.z[i];
+        body.particles.vz[i] = spin * body.particles.x[i];
+    }
+    int n = body.particles.nParticles;
+
+    //The exact centre of mass after the last step of the symplectic Euler method: v(k+1) = v(k) - g*dt and
+    //x(k+1) = x(k) + v(k+1)*dt
+    long double cx = 0.0L, cy = 0.0L, cz = 0.0L, cvx = 0.0L, cvy = 0.0L, cvz = 0.0L;
+    for(int i = 0; i < n; i++) {
+        cx += body.particles.x[i];
+        cy += body.particles.y[i];
+        cz += body.particles.z[i];
+        cvx += body.particles.vx[i];
+        cvy += body.particles.vy[i];
+        cvz += body.particles.vz[i];
+    }
+    long double t = (long double)steps * dt;
+    long double g = GRAVITY;
+    cx = cx / n + cvx / n * t;
+    cy = cy / n + cvy / n * t - g * dt * dt * ((long double)steps * (steps + 1) / 2);
+    cz = cz / n + cvz / n * t;
+
+    printf("Precision comparison: %d masses, %d springs, %ld steps (dt = %g s, %g s simulated)\n",
+           n, body.springs.nSprings, steps, dt, (double)t);
+    printf("  Precision  Time (s)  ns/spring  Bytes/mass  Centre of mass error  Largest distance from double\n");
+    vector<double> x[3], y[3], z[3];
+    double seconds[3];
+    const char* names[3] = { DoublePrecision::name(), MixedPrecision::name(), FloatPrecision::name() };
+    size_t bytes[3] = { bytesPerMass<DoublePrecision>(), bytesPerMass<MixedPrecision>(), bytesPerMass<FloatPrecision>() };
+    seconds[0] = simulatePrecision<DoublePrecision>(body, steps, dt, x[0], y[0], z[0]);
+    seconds[1] = simulatePrecision<MixedPrecision>(body, steps, dt, x[1], y[1], z[1]);
+    seconds[2] = simulatePrecision<FloatPrecision>(body, steps, dt, x[2], y[2], z[2]);
+    for(int p = 2; p >= 0; p--) {
+        long double mx = 0.0L, my = 0.0L, mz = 0.0L;
+        double largest = 0.0;
+        for(int i = 0; i < n; i++) {
+            mx += x[p][i];
+            my += y[p][i];
+            mz += z[p][i];
+            double dx = x[p][i] - x[0][i], dy = y[p][i] - y[0][i], dz = z[p][i] - z[0][i];
+            double distance = sqrt(dx * dx + dy * dy + dz * dz);
+            largest = distance > largest ? distance : largest;
+        }
+        long double ex = mx / n - cx, ey = my / n - cy, ez = mz / n - cz;
+        double comError = (double)sqrtl(ex * ex + ey * ey + ez * ez);
+        double springEvaluations = (double)steps * body.springs.nSprings;
+        printf("  %-9s  %8.3f  %9.2f  %10d  %20.3e  %28.3e\n", names[p], seconds[p],
+               springEvaluations > 0 ? 1e9 * seconds[p] / springEvaluations : 0.0, (int)bytes[p], comError, largest);
+    }
+}
+
+//Options of a simulation run, read from the command line
+struct SimOptions {
+    const char* scene;          // The scene: box, lattice or mesh
+    int size;                   // Number of masses along each side of the lattice
+    const char* meshFile;       // The OBJ file of the mesh scene
+    float shearRadius;          // Largest length of the shear springs of the mesh, 0 for none
+    int nBodies;                // Number of copies of the body
+    float contactDistance;      // Distance at which masses of different bodies collide, negative for the default
+    long steps;                 // Number of steps to simulate
+    float dt;                   // The timestep
+    int threads;                // Number of threads evaluating the springs, 0 for one per core
+    int iterations;             // Number of constraint iterations per XPBD step
+    IntegrationMethod method;   // The integration method of the bodies
+    const char* traceFile;      // File to write the Chrome trace to, or NULL
+    const char* recordFile;     // File to record the trajectory to, or NULL
+    long recordEvery;           // Number of steps between two recorded frames
+
+    //Constructor, sets the defaults
+    SimOptions(){
+        scene = "box";
+        size = 10;
+        meshFile = "meshes/teapot.obj";
+        shearRadius = 0.0f;
+        nBodies = 1;
+        contactDistance = -1.0f;
+        steps = 100000;
+        dt = 0.0001f;
+        threads = 1;
+        iterations = 10;
+        method = SYMPLECTIC_EULER;
+        traceFile = NULL;
+        recordFile = NULL;
+        recordEvery = 1;
+    }
+};
+
+//Function to build the scene, simulate it in one precision and report the results. Returns the exit code
+template<class Precision>
+static int runScene(const SimOptions& options){
+    const char* scene = options.scene;
+    int size = options.size;
+    const char* meshFile = options.meshFile;
+    float shearRadius = options.shearRadius;
+    int nBodies = options.nBodies;
+    float contactDistance = options.contactDistance;
+    long steps = options.steps;
+    float dt = options.dt;
+    int threads = options.threads;
+    int iterations = options.iterations;
+    IntegrationMethod method = options.method;
+    const char* traceFile = options.traceFile;
+    const char* recordFile = options.recordFile;
+    long recordEvery = options.recordEvery;
+
+    //Constants, the same as in the viewer
+    float springConstant = 20.0f;
+    float damperConstant = 2.0f;
+    float springLength = 0.3f;
+    float springMax = 0.6f;
+    float springMin = 0.03f;
+    float weight = 2.0f;
+    float floorRestitution = 0.5f;
+    float floorFriction = 0.5f;
+
+    ThreadPool pool(threads);
+    BasicScene<Precision> world;
+    MeshCache mesh;
+    float extent = 2.0f * 0.3f;     // Size of the body, used to place the copies
+    float spacing = 2.0f * 0.3f;    // Distance between neighbouring masses, the default contact distance
+    if(strcmp(scene, "lattice") == 0 && size >= 2) {
+        extent = springLength * (size - 1);
+        spacing = springLength;
+    }
+    else if(strcmp(scene, "mesh") == 0) {
+        if(!mesh.load(meshFile, &pool)) {
+            fprintf(stderr, "%s: %s\n", meshFile, mesh.error.c_str());
+            return 1;
+        }
+        spacing = 0.05f;
+    }
+    else if(strcmp(scene, "box") != 0) {
+        printUsage();
+        return 1;
+    }
+
+    //The copies are created around the origin, then placed in columns
+    for(int b = 0; b < nBodies; b++) {
+        BasicSoftBody<Precision>& body = world.addBody();
+        if(strcmp(scene, "box") == 0) {
+            body.createBox(0.3f, 0.3f, 0.3f, 0.0f, 0.0f, 0.0f, weight);
+            body.springs.createBox(springConstant, damperConstant, springLength, springMax, springMin, springConstant, damperConstant);
+        }
+        else if(strcmp(scene, "lattice") == 0) {
+            body.createLattice(size, size, size, springLength, weight, springConstant, damperConstant);
+            //Place the lattice so it falls onto the floor
+            body.translate(0.0f, 0.5f * springLength * size, 0.0f);
+        }
+        else {
+            //The springs are generated in the units of the OBJ file, then the body is scaled to the size of the box
+            MeshSpringOptions options;
+            options.shearRadius = shearRadius;
+            body.createFromMesh(mesh, weight, options);
+            body.fit(extent);
+        }
+        body.threadPool = &pool;
+        body.method = method;
+        body.xpbd.iterations = iterations;
+    }
+    float halfWidth = world.arrange(1.5f * extent);
+    world.contactDistance = contactDistance >= 0.0f ? contactDistance : spacing;
+    //The floor of the viewer, with its top at -0.9, made wide enough for all columns
+    float floorSize = halfWidth + extent;
+    floorSize = floorSize > 2.0f ? floorSize : 2.0f;
+    world.colliders.addBox(0.0f, -1.0f, 0.0f, floorSize, 0.1f, floorSize, floorRestitution, floorFriction);
+    BasicSoftBody<Precision>& body = *world.bodies[0];
+
+    cout << "Scene:           " << scene << endl;
+    cout << "Bodies:          " << nBodies << endl;
+    cout << "Masses:          " << world.massCount() << endl;
+    cout << "Springs:         " << world.springCount() << " in " << body.springs.nColours << " colours per body" << endl;
+    cout << "Contact:         " << world.contactDistance << endl;
+    cout << "Threads:         " << pool.size() << endl;
+    cout << "Steps:           " << steps << " (dt = " << dt << " s)" << endl;
+    cout << "Integrator:      " << SoftBody::methodName(method) << endl;
+    if(method == XPBD) {
+        cout << "Iterations:      " << iterations << " per step" << endl;
+    }
+    cout << "Precision:       " << Precision::name() << endl;
+    cout << "SIMD kernel:     " << ParticleSystem::simdLevelName(BasicParticleSystem<Precision>::getSimdLevel()) << endl;
+
+    //The recording starts with the positions before the first step
+    TrajectoryWriter recording;
+    if(recordFile != NULL) {
+        if(!recording.open(recordFile, world.massCount(), (float)(recordEvery * dt))) {
+            fprintf(stderr, "%s: %s\n", recordFile, recording.error.c_str());
+            return 1;
+        }
+        world.record(recording);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(long i = 0; i < steps; i++) {
+        world.step(dt);
+        if(recording.isOpen() && (i + 1) % recordEvery == 0) {
+            world.record(recording);
+        }
+        PROFILE_FRAME();
+    }
+    if(recording.isOpen() && !recording.close()) {
+        fprintf(stderr, "%s: %s\n", recordFile, recording.error.c_str());
+        return 1;
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(stop - start).count();
+
+    double springEvaluations = (double)steps * world.springCount();
+    printf("Time:            %.3f s\n", seconds);
+    printf("Steps/sec:       %.1f\n", steps / seconds);
+    printf("ns/spring eval:  %.2f\n", springEvaluations > 0 ? 1e9 * seconds / springEvaluations : 0.0);
+    long peak = peakMemoryKB();
+    if(peak >= 0) {
+        printf("Peak RSS:        %ld KB\n", peak);
+    }
+    else {
+        printf("Peak RSS:        n/a\n");
+    }
+    if(method == IMPLICIT_EULER) {
+        printf("CG iterations:   %d in the last step (residual %.2e)\n", body.implicitEuler.lastIterations, body.implicitEuler.lastResidual);
+    }
+    if(recordFile != NULL) {
+        double rawBytes = 12.0 * recording.nFrames * recording.nMasses;
+        printf("Recorded:        %ld frames, %.1f KB (%.2f bytes per coordinate, %.1f%% of the floats)\n",
+               recording.nFrames, recording.bytesWritten / 1024.0, recording.bytesWritten / (rawBytes / 4.0),
+               100.0 * recording.bytesWritten / rawBytes);
+    }
+    if(nBodies > 1) {
+        printf("Contacts:        %d of %d candidate pairs in the last step\n", world.nContacts, world.nCandidates);
+    }
+    if(strcmp(scene, "mesh") == 0) {
+        //The normals of the first body, from the positions of the masses of its vertices, as in the viewer
+        VertexNormals normals;
+        normals.create(mesh.indices, mesh.nTriangles, mesh.nVertices);
+        vector<float> positions(3 * mesh.nVertices);
+        vector<float> vertexNormals(3 * mesh.nVertices);
+        for(int i = 0; i < mesh.nVertices; i++) {
+            int m = body.vertexMass[i];
+            positions[3*i] = (float)body.particles.x[m];
+            positions[3*i+1] = (float)body.particles.y[m];
+            positions[3*i+2] = (float)body.particles.z[m];
+        }
+        const int repeats = 1000;
+        chrono::steady_clock::time_point normalsStart = chrono::steady_clock::now();
+        for(int r = 0; r < repeats; r++) {
+            normals.compute(&positions[0], 3, &vertexNormals[0], 3);
+        }
+        double normalSeconds = chrono::duration<double>(chrono::steady_clock::now() - normalsStart).count() / repeats;
+        printf("Normals:         %.1f us per body (a step takes %.1f us per body)\n",
+               1e6 * normalSeconds, 1e6 * seconds / steps / nBodies);
+    }
+    printf("Mass 0 position: %.4f %.4f %.4f\n", body.particles.x[0], body.particles.y[0], body.particles.z[0]);
+#ifdef BOX3D_PROFILE
+    Profiler::printReport(cout);
+    if(traceFile != NULL && !Profiler::writeTrace(traceFile)) {
+        fprintf(stderr, "%s: could not write the trace\n", traceFile);
+        return 1;
+    }
+#else
+    if(traceFile != NULL) {
+        fprintf(stderr, "--trace needs the profiler, configure with -DBOX3D_PROFILE=ON\n");
+    }
+#endif
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    SimOptions options;
+    const char* precision = "float";
+    bool comparePrecision = false;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--scene") == 0 && i+1 < argc) {
+            options.scene = argv[++i];
+        }
+        else if(strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+            options.size = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--mesh") == 0 && i+1 < argc) {
+            options.meshFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--shear") == 0 && i+1 < argc) {
+            options.shearRadius = (float)atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--bodies") == 0 && i+1 < argc) {
+            options.nBodies = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--contact") == 0 && i+1 < argc) {
+            options.contactDistance = (float)atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--steps") == 0 && i+1 < argc) {
+            options.steps = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--dt") == 0 && i+1 < argc) {
+            options.dt = (float)atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            options.threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--iterations") == 0 && i+1 < argc) {
+            options.iterations = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            options.traceFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i+1 < argc) {
+            options.recordFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--record-every") == 0 && i+1 < argc) {
+            options.recordEvery = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--precision") == 0 && i+1 < argc) {
+            precision = argv[++i];
+        }
+        else if(strcmp(argv[i], "--compare-precision") == 0) {
+            comparePrecision = true;
+        }
+        else if(strcmp(argv[i], "--integrator") == 0 && i+1 < argc) {
+            const char* name = argv[++i];
+            if(strcmp(name, "symplectic") == 0 || strcmp(name, "explicit") == 0) {
+                options.method = SYMPLECTIC_EULER;
+            }
+            else if(strcmp(name, "verlet") == 0) {
+                options.method = VELOCITY_VERLET;
+            }
+            else if(strcmp(name, "rk4") == 0) {
+                options.method = RUNGE_KUTTA_4;
+            }
+            else if(strcmp(name, "implicit") == 0) {
+                options.method = IMPLICIT_EULER;
+            }
+            else if(strcmp(name, "xpbd") == 0) {
+                options.method = XPBD;
+            }
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(options.nBodies < 1 || options.recordEvery < 1) {
+        printUsage();
+        return 1;
+    }
+    if(comparePrecision) {
+        comparePrecisions(options.size >= 2 ? options.size : 2, options.steps, options.dt);
+        return 0;
+    }
+    if(strcmp(precision, FloatPrecision::name()) == 0) {
+        return runScene<FloatPrecision>(options);
+    }
+    if(strcmp(precision, DoublePrecision::name()) == 0) {
+        return runScene<DoublePrecision>(options);
+    }
+    if(strcmp(precision, MixedPrecision::name()) == 0) {
+        return runScene<MixedPrecision>(options);
+    }
+    printUsage();
+    return 1;
+}
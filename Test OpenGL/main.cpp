@@ -21,6 +21,8 @@
 
 // File and console I/O for logging and error reporting
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 
 // In MacOS X, tell GLFW to include the modern OpenGL headers.
 // Windows does not want this, so we make this Mac-only.
@@ -30,284 +32,66 @@
 
 // GLFW 3.x, to handle the OpenGL window
 #include <GLFW/glfw3.h>
-#include <GLUT/glut.h>
 #include "Utilities.hpp"
 #include "Shader.hpp"
-#include "Vector.hpp"
-#include "Mass.hpp"
-#include "SpringDamper.hpp"
+#include "SoftBody.hpp"
+#include "FixedTimestep.hpp"
 #include "TriangleSoup.hpp"
+#include "InstancedMesh.hpp"
+#include "VertexNormals.hpp"
+#include "Scene.hpp"
+#include "UniformBuffer.hpp"
+#include "Mat4.hpp"
+#include "Profiler.hpp"
+#include "GpuTimer.hpp"
 
 using namespace std;
 
-//Function to check if a mass is colliding with the object placed at -0.9 in the y-direction
-bool checkCollision(Mass* mass) {
-    if (mass->position.y <= -0.9f) {
-        return false;
-    }
-    else {
-        return true;
-    }
-}
-
-// Multiplies two matrices and stores the result in Mout
-void mat4mult(float M1[], float M2[], float Mout[]) {
-    float Mtemp [16];
-    Mtemp [0] = M1[0]*M2[0]+M1[4]*M2[1]+M1[8]*M2[2]+M1[12]*M2[3];
-    Mtemp [1] = M1[1]*M2[0]+M1[5]*M2[1]+M1[9]*M2[2]+M1[13]*M2[3];
-    Mtemp [2] = M1[2]*M2[0]+M1[6]*M2[1]+M1[10]*M2[2]+M1[14]*M2[3];
-    Mtemp [3] = M1[3]*M2[0]+M1[7]*M2[1]+M1[11]*M2[2]+M1[15]*M2[3];
-    
-    Mtemp [4] = M1[0]*M2[4]+M1[4]*M2[5]+M1[8]*M2[6]+M1[12]*M2[7];
-    Mtemp [5] = M1[1]*M2[4]+M1[5]*M2[5]+M1[9]*M2[6]+M1[13]*M2[7];
-    Mtemp [6] = M1[2]*M2[4]+M1[6]*M2[5]+M1[10]*M2[6]+M1[14]*M2[7];
-    Mtemp [7] = M1[3]*M2[4]+M1[7]*M2[5]+M1[11]*M2[6]+M1[15]*M2[7];
-    
-    Mtemp [8] = M1[0]*M2[8]+M1[4]*M2[9]+M1[8]*M2[10]+M1[12]*M2[11];
-    Mtemp [9] = M1[1]*M2[8]+M1[5]*M2[9]+M1[9]*M2[10]+M1[13]*M2[11];
-    Mtemp [10] = M1[2]*M2[8]+M1[6]*M2[9]+M1[10]*M2[10]+M1[14]*M2[11];
-    Mtemp [11] = M1[3]*M2[8]+M1[7]*M2[9]+M1[11]*M2[10]+M1[15]*M2[11];
-    
-    Mtemp [12] = M1[0]*M2[12]+M1[4]*M2[13]+M1[8]*M2[14]+M1[12]*M2[15];
-    Mtemp [13] = M1[1]*M2[12]+M1[5]*M2[13]+M1[9]*M2[14]+M1[13]*M2[15];
-    Mtemp [14] = M1[2]*M2[12]+M1[6]*M2[13]+M1[10]*M2[14]+M1[14]*M2[15];
-    Mtemp [15] = M1[3]*M2[12]+M1[7]*M2[13]+M1[11]*M2[14]+M1[15]*M2[15];
-    
-    for ( int i =0; i <16; i ++) {
-        Mout[i] = Mtemp[i];
-    }
-}
-//Function creates an identity matrix and stores it in M
-void mat4identity(float M[]) {
-    float Mtemp [16];
-    Mtemp [0] = 1.0f;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = 1.0f;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = 1.0f;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = 0.0f;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i ++) {
-        M[i] = Mtemp[i];
-    }
-};
-
-//Function that rotates the matrix around the x-axis and stores the result in M
-void mat4rotx(float M[], float angle){
-    float a = cos(angle);
-    float b = sin(angle);
-    float Mtemp [16];
-    Mtemp [0] = 1.0f;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = a;
-    Mtemp [6] = b;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = -b;
-    Mtemp [10] = a;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = 0.0f;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-    
-};
-
-//Function that rotates the matrix around the y-axis and stores the result in M
-void mat4roty(float M[], float angle){
-    float a = cos(angle);
-    float b = sin(angle);
-    float Mtemp [16];
-    Mtemp [0] = a;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = -b;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = 1.0f;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = b;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = a;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = 0.0f;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-};
-
-//Function that rotates the matrix around the z-axis and stores the result in M
-void mat4rotz(float M[], float angle){
-    float a = cos(angle);
-    float b = sin(angle);
-    float Mtemp [16];
-    Mtemp [0] = a;
-    Mtemp [1] = b;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = -b;
-    Mtemp [5] = a;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = 1.0f;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = 0.0f;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-};
-
-//Function that scales the matrix and stores the result in M
-void mat4scale(float M[], float scale){
-    float Mtemp [16];
-    Mtemp [0] = scale;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = scale;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = scale;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = 0.0f;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-};
-//Function that translates the matrix and stores the result in M
-void mat4translate(float M[], float x, float y, float z){
-    float Mtemp [16];
-    Mtemp [0] = 1.0f;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = 1.0f;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = 1.0f;
-    Mtemp [11] = 0.0f;
-    
-    Mtemp [12] = x;
-    Mtemp [13] = y;
-    Mtemp [14] = z;
-    Mtemp [15] = 1.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-};
-
-// This function creates a perspective matrix.
-// M is the matrix we want to create (an output argument )
-// vfov is the vertical field of view (in the y direction )
-// aspect is the aspect ratio of the viewport ( width / height )
-// znear is the distance to the near clip plane ( znear > 0)
-// zfar is the distance to the far clip plane ( zfar > znear )
-void mat4perspective ( float M [] , float vfov , float aspect , float znear , float zfar ) {
-    
-    float f = cos(vfov/2)/sin(vfov/2);
-    float fa = f/aspect;
-    float A = -(zfar+znear)/(zfar-znear);
-    float B = -(2*zfar*znear)/(zfar-znear);
-    
-    float Mtemp [16];
-    Mtemp [0] = fa;
-    Mtemp [1] = 0.0f;
-    Mtemp [2] = 0.0f;
-    Mtemp [3] = 0.0f;
-    
-    Mtemp [4] = 0.0f;
-    Mtemp [5] = f;
-    Mtemp [6] = 0.0f;
-    Mtemp [7] = 0.0f;
-    
-    Mtemp [8] = 0.0f;
-    Mtemp [9] = 0.0f;
-    Mtemp [10] = A;
-    Mtemp [11] = -1.0f;
-    
-    Mtemp [12] = 0.0f;
-    Mtemp [13] = 0.0f;
-    Mtemp [14] = B;
-    Mtemp [15] = 0.0f;
-    
-    for ( int i =0; i <16; i++) {
-        M[i] = Mtemp[i];
-    }
-}
-
 int main(int argc, char *argv[])
 {
-    //Declaration of the matrices
-    GLfloat M1[16];
-    GLfloat M2[16];
-    GLfloat M3[16];
-    GLfloat M4[16];
-    GLfloat MV[16];
-    GLfloat P[16];
-    
     //Window size
     int width, height;
     
-    //Objects - myBox as the modell and myFloor as a collision object
+    //Command line: [--bodies n] [--record file.b3dtraj] [--record-every n] [--replay file.b3dtraj] [--offline] [file.obj]
+    int nBodies = 1;
+    const char* meshFile = NULL;
+    const char* recordFile = NULL;  //The positions of the masses are recorded to this file
+    long recordEvery = 1;           //Number of steps between two recorded frames
+    const char* replayFile = NULL;  //The recording shown instead of the simulation
+    bool offline = false;           //If every frame of the recording is shown once, as fast as possible
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--bodies") == 0 && i+1 < argc) {
+            nBodies = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i+1 < argc) {
+            recordFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--record-every") == 0 && i+1 < argc) {
+            recordEvery = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+            replayFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--offline") == 0) {
+            offline = true;
+        }
+        else {
+            meshFile = argv[i];
+        }
+    }
+    nBodies = nBodies > 1 ? nBodies : 1;
+    recordEvery = recordEvery > 1 ? recordEvery : 1;
+
+    //Objects - myBox as the modell of all bodies and myFloor, which is drawn where the floor collider is.
+    //The modell is the OBJ file given on the command line, or a box
     TriangleSoup myBox;
-    myBox.createBox(0.3f, 0.3f, 0.3f, 0.0f, 0.0f, 0.0f);
-    TriangleSoup myFloor;
-    myFloor.createBox(2.0f, 0.1f, 2.0f, 0.0f, -1.0f, 0.0f);
+    if(meshFile) {
+        myBox.loadOBJ(meshFile);
+    }
+    bool meshLoaded = myBox.nverts > 0;
+    if(!meshLoaded) {
+        myBox.createBox(0.3f, 0.3f, 0.3f, 0.0f, 0.0f, 0.0f);
+    }
    
     //Constants
     float springConstant = 20.0f;
@@ -316,35 +100,94 @@ int main(int argc, char *argv[])
     float damperConstDiag = 2.0f;
     
     float springLength = 0.3f;
-    float springLengthDiag = sqrt(springLength*springLength*2);
     float springMax = 0.6f;
     float springMin = 0.03f;
-    float springMaxDiag = sqrt(springMax*springMax*2);
-    float springMinDiag = sqrt(springMin*springMin*2);
     
-    int nSprings = 24;
     float weight = 2.0f;
+    float floorRestitution = 0.5f;
+    float floorFriction = 0.5f;
     float dt = 0.0001f;
-    
-    //Array to store the masses of the box
-    Mass** masses;
-    masses = new Mass*[myBox.nverts];
-    //Array to store the springs and dampers
-    SpringDamper** springs_dampers;
-    springs_dampers = new SpringDamper*[nSprings];
-    
-    //Give each mass a weight and set their starting positions to the positions defined for the box
-    for(int i = 0; i < myBox.nverts; i++){
-        masses[i] = new Mass(weight);
-        masses[i]->setStartPos(myBox.vertexarray[8*i],myBox.vertexarray[8*i+1], myBox.vertexarray[8*i+2]);
+    int maxSubsteps = 2000;     //The largest number of steps simulated per frame, 0.2 seconds of simulated time
+    
+    //The simulated bodies, copies of myBox placed in columns. Masses of different bodies closer than the size of
+    //the box collide
+    Scene world;
+    world.contactDistance = 0.6f;
+    for(int b = 0; b < nBodies; b++) {
+        SoftBody& softBox = world.addBody();
+        //The masses of the box, stored as a structure of arrays
+        ParticleSystem& masses = softBox.particles;
+        if(meshLoaded) {
+            //The springs are generated from the triangles of the mesh, and the mesh is scaled to the size of the box
+            softBox.createFromMesh(*myBox.meshcache, weight, MeshSpringOptions());
+            softBox.fit(0.6f);
+        }
+        else {
+            masses.create(myBox.nverts, weight);
+            //The springs and dampers of the box, built once and reused every frame
+            softBox.springs.createBox(springConstant, damperConstant, springLength, springMax, springMin, springConstDiag, damperConstDiag);
+
+            //Set the starting positions of the masses to the positions defined for the box
+            softBox.vertexMass.resize(myBox.nverts);
+            for(int i = 0; i < myBox.nverts; i++){
+                masses[i]->setStartPos(myBox.vertexarray[8*i],myBox.vertexarray[8*i+1], myBox.vertexarray[8*i+2]);
+                softBox.vertexMass[i] = i;
+            }
+        }
+    }
+    float halfWidth = world.arrange(0.9f);
+    for(int b = 0; b < nBodies; b++) {
+        world.bodies[b]->particles.storePreviousPositions();
     }
+
+    //The static colliders: a box with its top at -0.9 in the y-direction, wide enough for all columns of bodies,
+    //and myFloor drawn at the same place
+    float floorSize = halfWidth + 0.6f > 2.0f ? halfWidth + 0.6f : 2.0f;
+    world.colliders.addBox(0.0f, -1.0f, 0.0f, floorSize, 0.1f, floorSize, floorRestitution, floorFriction);
+    TriangleSoup myFloor;
+    myFloor.createBox(floorSize, 0.1f, floorSize, 0.0f, -1.0f, 0.0f);
+    //The camera is moved back for floors larger than the original one
+    float viewScale = 2.0f / floorSize;
+    
+    //Advances the simulation in steps of dt, as many as needed to keep up with the time passed since the last frame
+    FixedTimestep timestep(dt, maxSubsteps);
+    
+    //A recording is shown instead of the simulation by moving the masses to the recorded positions. It must have
+    //been recorded from the same scene: the same mesh and the same number of bodies
+    TrajectoryReader replay;
+    if(replayFile) {
+        if(!replay.open(replayFile)) {
+            cout << replayFile << ": " << replay.error << endl;
+            return -1;
+        }
+        if(replay.nMasses != world.massCount() || replay.nFrames == 0) {
+            cout << replayFile << ": recorded from another scene, with " << replay.nMasses << " masses" << endl;
+            return -1;
+        }
+    }
+    //The recording starts with the positions before the first step
+    TrajectoryWriter recording;
+    if(recordFile && !replayFile) {
+        if(!recording.open(recordFile, world.massCount(), (float)(recordEvery * dt))) {
+            cout << recordFile << ": " << recording.error << endl;
+            return -1;
+        }
+        world.record(recording);
+    }
+    long stepCount = 0;             //Number of steps simulated
+    double replayTime = 0.0;        //Time of the frame shown from the recording, in simulated seconds
+    double lastTime = 0.0;          //Wall-clock time of the last frame
+    int replayFrame = -1;           //The recorded frame the masses were last moved to, -1 before the first
+    long replayedFrames = 0;        //Number of frames shown from the recording
+    bool paused = false;
+    bool spaceDown = false;
     
     const GLFWvidmode *vidmode;  // GLFW struct to hold information about the display
     GLFWwindow *window;    // GLFW struct to hold information about the window
     
-    // Declarations : the C++ variable and the location of its GLSL counterpart
+    // Declarations : the C++ variable and the handle of its GLSL counterpart
     float time = 0.0;
-    GLint location_time;
+    UniformFloat uniform_time;
     Shader myShader;
     
     // Initialise GLFW
@@ -373,40 +216,54 @@ int main(int argc, char *argv[])
     // Load extensions (only needed in Microsoft Windows)
     Utilities::loadExtensions();
     
-    myShader.createShader("vertex.glsl", "fragment.glsl");
+    //Both programs are started before either is waited for, so the driver can compile them at the same time
+    //while the meshes are uploaded. They are loaded from the program binary cache after the first start
+    myShader.beginShader("Vertex.glsl", "Fragment.glsl");
+    //The bodies are drawn as copies of myBox with one draw call, reading their positions from a texture buffer
+    Shader bodyShader;
+    bodyShader.beginShader("InstancedVertex.glsl", "Fragment.glsl");
+    InstancedMesh bodyMesh;
+    bodyMesh.create(myBox, nBodies);
+    //The floor does not move, so its vertices are uploaded once, here, and never again
+    myFloor.generateVAO();
+    myShader.finishShader();
+    bodyShader.finishShader();
+    glUseProgram(bodyShader.programID);
+    bodyShader.intUniform("Positions").set(0);
+    bodyShader.intUniform("VertexCount").set(bodyMesh.nverts);
+    bodyShader.intUniform("InstanceCount").set(bodyMesh.ninstances);
+    //The normals of the bodies follow their deformation, recomputed from the positions of every frame
+    VertexNormals bodyNormals;
+    bodyNormals.create(myBox.indexarray, myBox.ntris, myBox.nverts, bodyMesh.ninstances);
     
     // Show some useful information on the GL context
     cout << "GL vendor:       " << glGetString(GL_VENDOR) << endl;
     cout << "GL renderer:     " << glGetString(GL_RENDERER) << endl;
     cout << "GL version:      " << glGetString(GL_VERSION) << endl;
     cout << "Desktop size:    " << vidmode->width << "x" << vidmode->height << " pixels" << endl;
+    cout << "Shader programs: " << (myShader.cached + bodyShader.cached) << " of 2 from the cache" << endl;
     
     
     glfwSwapInterval(0); // Do not wait for screen refresh between frames
     
     
     //For the shader
-    location_time = glGetUniformLocation(myShader.programID, "time");
-    if(location_time == -1) { // If the variable is not found , -1 is returned
+    uniform_time = myShader.floatUniform("time");
+    if(uniform_time.location == -1) { // If the variable is not found , -1 is returned
         cout << " Unable to locate variable ✬time ✬ in shader !" << endl;
     }
     
-    //To pass variables to the shader
-    GLint location_M1;
-    location_M1 = glGetUniformLocation(myShader.programID,"M1");
-    glUseProgram(myShader.programID); // Activate the shader to set its variables
-    
-    GLint location_M2;
-    location_M2 = glGetUniformLocation(myShader.programID,"M2");
-    glUseProgram(myShader.programID); // Activate the shader to set its variables
+    //The matrices are shared by both programs through one uniform buffer, written once per frame
+    MatrixBlock matrices;
+    const Mat4 projection = Mat4::perspective(3.14f/4, 1.0f, 0.1f, 100.0f);
+    const Mat4 camera = Mat4::translation(0.0f, 0.0f, -3.0f) * Mat4::rotationX(0.6f) * Mat4::translation(0.0f, 0.0f, -0.5f);
+    UniformBuffer matrixBuffer;
+    matrixBuffer.create(sizeof(MatrixBlock), MATRIX_BLOCK_BINDING);
+    myShader.bindUniformBlock("Matrices", MATRIX_BLOCK_BINDING);
+    bodyShader.bindUniformBlock("Matrices", MATRIX_BLOCK_BINDING);
     
-    GLint location_MV;
-    location_MV = glGetUniformLocation(myShader.programID,"MV");
-    glUseProgram(myShader.programID); // Activate the shader to set its variables
-    
-    GLint location_P;
-    location_P = glGetUniformLocation(myShader.programID,"P");
-    glUseProgram(myShader.programID); // Activate the shader to set its variables
+    //Measures the draws on the GPU when the profiler is compiled in
+    GpuTimer gpuTimer;
     
     // ------------------------------------------------- Main loop ----------------------------------------------------------------------- //
     while(!glfwWindowShouldClose(window)) {
@@ -423,115 +280,130 @@ int main(int argc, char *argv[])
         // Set the clear color and depth, and clear the buffers for drawing
         glClearColor(0.3f, 0.3f, 0.3f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        // Activate the vertex array object we want to draw (we may have several)
-        glUseProgram (myShader.programID);
         
         /********************************* SHADER AND CAMERA ******************************/
-        //Initialize identity matrices
-        mat4identity(M1);
-        mat4identity(M2);
-        mat4identity(M3);
-        mat4identity(MV);
-        mat4identity(P);
-        mat4identity(M4);
-        
-        mat4perspective(P, (3.14/4), 1.0f, 0.1f, 100.0f);
-        mat4mult(M4,P,P);
-        
-        mat4roty(M2,time*0.1);
-        mat4mult(M2,MV,MV);
-        
-        mat4translate(M1, 0.0f, 0.0f, -0.5f);
-        mat4mult(M1,MV,MV);
-        
-        mat4rotx(M4, 0.6f);
-        mat4mult(M4,MV,MV);
-        
-        mat4translate(M1, 0.0f, 0.0f, -3.0f);
-        mat4mult(M1,MV,MV);
-        
-        mat4scale(M3, 0.5);
-        mat4mult(M1, M3, M1);
+        //The model turns slowly around the y-axis. The camera looks down at it from above, and the view is
+        //scaled to fit the floor
+        matrices.M2 = Mat4::rotationY(time*0.1f);
+        matrices.MV = camera * matrices.M2 * Mat4::scaling(viewScale);
+        matrices.P = projection;
         
-        //Update the values for the shader
-        location_M1 = glGetUniformLocation(myShader.programID,"M1");
-        glUseProgram(myShader.programID); // Activate the shader to set its variables
-        glUniformMatrix4fv(location_M1, 1, GL_FALSE,M1); // Copy the value
-        
-        location_M2 = glGetUniformLocation(myShader.programID,"M2");
-        glUseProgram(myShader.programID); // Activate the shader to set its variables
-        glUniformMatrix4fv(location_M2, 1, GL_FALSE,M2); // Copy the value
-        
-        location_MV = glGetUniformLocation(myShader.programID,"MV");
-        glUseProgram(myShader.programID); // Activate the shader to set its variables
-        glUniformMatrix4fv(location_MV, 1, GL_FALSE,MV); // Copy the value
-        
-        location_P = glGetUniformLocation(myShader.programID,"P");
-        glUseProgram(myShader.programID); // Activate the shader to set its variables
-        glUniformMatrix4fv(location_P, 1, GL_FALSE,P); // Copy the value
+        //Update the values for the shaders, the same camera for the floor and the bodies, with one buffer write
+        matrixBuffer.update(&matrices);
         
         /********************************* SHADER AND CAMERA ******************************/
         
-        // ----------------------------------------------- Springs and dampers ---------------------------------------------------------- //
-        //x-direction
-        springs_dampers[0] = new SpringDamper(masses[0], masses[1], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[1] = new SpringDamper(masses[2], masses[3], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[2] = new SpringDamper(masses[4], masses[5], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[3] = new SpringDamper(masses[6], masses[7], springConstant, springMax, springMin, springLength, damperConstant);
-        //y-dimension
-        springs_dampers[4] = new SpringDamper(masses[0], masses[2], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[5] = new SpringDamper(masses[1], masses[3], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[6] = new SpringDamper(masses[4], masses[6], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[7] = new SpringDamper(masses[5], masses[7], springConstant, springMax, springMin, springLength, damperConstant);
-        //z-dimension
-        springs_dampers[8] = new SpringDamper(masses[0], masses[4], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[9] = new SpringDamper(masses[1], masses[5], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[10] = new SpringDamper(masses[2], masses[6], springConstant, springMax, springMin, springLength, damperConstant);
-        springs_dampers[11] = new SpringDamper(masses[3], masses[7], springConstant, springMax, springMin, springLength, damperConstant);
-        
-        //Diagonals xy-plane
-        springs_dampers[12] = new SpringDamper(masses[0], masses[3], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[13] = new SpringDamper(masses[1], masses[2], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[14] = new SpringDamper(masses[4], masses[7], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[15] = new SpringDamper(masses[5], masses[6], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        //Diagonals xz-plane
-        springs_dampers[16] = new SpringDamper(masses[0], masses[5], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[17] = new SpringDamper(masses[1], masses[4], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[18] = new SpringDamper(masses[2], masses[7], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[19] = new SpringDamper(masses[3], masses[6], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        //Diagonals yz-plane
-        springs_dampers[20] = new SpringDamper(masses[0], masses[6], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[21] = new SpringDamper(masses[2], masses[4], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[22] = new SpringDamper(masses[1], masses[7], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        springs_dampers[23] = new SpringDamper(masses[3], masses[5], springConstDiag,springMinDiag, springMaxDiag, springLengthDiag, damperConstDiag);
-        
         // ------------ Add forces to masses -------------- //
         // --------- Simulate masses using Euler --------- //
-        for(int i = 0; i<nSprings; i++) {
-            springs_dampers[i]->addSDForce();
-            springs_dampers[i]->simulateEuler(dt);
+        // ------------- Check for collision -------------- //
+        float alpha = 0.0f;
+        if(replayFile) {
+            PROFILE_SCOPE("replay");
+            //Space pauses the replay, and the arrow keys scrub backwards and forwards at five times the speed.
+            //Offline, every recorded frame is shown once, one per rendered frame
+            double now = glfwGetTime();
+            double elapsed = replayedFrames > 0 ? now - lastTime : 0.0;
+            lastTime = now;
+            bool space = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+            if(space && !spaceDown) {
+                paused = !paused;
+            }
+            spaceDown = space;
+            double speed = paused ? 0.0 : 1.0;
+            if(glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
+                speed += 5.0;
+            }
+            if(glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
+                speed -= 5.0;
+            }
+            double lastFrame = replay.nFrames - 1;
+            double position = offline ? (double)replayedFrames : (replayTime + speed * elapsed) / replay.frameTime;
+            position = position < 0.0 ? 0.0 : (position > lastFrame ? lastFrame : position);
+            replayTime = position * replay.frameTime;
+            int frame = (int)position;
+            alpha = (float)(position - frame);
+            
+            //The masses hold the frame and the one after it, the previous and the current state the vertices are
+            //interpolated between. Played forwards, only the frame after is read
+            if(frame != replayFrame) {
+                int nextFrame = frame + 1 < replay.nFrames ? frame + 1 : frame;
+                bool ok = (replayFrame >= 0 && frame == replayFrame + 1) || world.replay(replay, frame);
+                for(size_t b = 0; b < world.bodies.size(); b++) {
+                    world.bodies[b]->particles.storePreviousPositions();
+                }
+                ok = ok && world.replay(replay, nextFrame);
+                if(!ok) {
+                    cout << replayFile << ": " << replay.error << endl;
+                    glfwSetWindowShouldClose(window, GL_TRUE);
+                }
+                replayFrame = frame;
+            }
+            replayedFrames++;
+            if(offline && frame == replay.nFrames - 1) {
+                glfwSetWindowShouldClose(window, GL_TRUE);
+            }
+        }
+        else {
+            int substeps = timestep.beginFrame(glfwGetTime());
+            PROFILE_SCOPE("simulate");
+            for(int s = 0; s < substeps; s++) {
+                //Keep the state before the last step, to interpolate between the last two states
+                if(s == substeps-1) {
+                    for(size_t b = 0; b < world.bodies.size(); b++) {
+                        world.bodies[b]->particles.storePreviousPositions();
+                    }
+                }
+                world.step(dt);
+                if(recording.isOpen() && ++stepCount % recordEvery == 0) {
+                    world.record(recording);
+                }
+            }
+            alpha = timestep.alpha();
         }
  
         // --------- Update positions of vertices ---------- //
-        // ------------- Check for collision -------------- //
-        for(int i = 0; i < myBox.nverts; i++){
-            //Update position of the vertices of the box with the new simulated positions of the masses
-            myBox.updateVertexArray(8*i, masses[i]->position.x, masses[i]->position.y, masses[i]->position.z);
-            if (!checkCollision(masses[i])){
-                //If the mass collides with the floor, change direction of the velocity in the y-direction
-                //Due to energy loss the resulting velocity will have a smaller amplitude
-                masses[i]->setVelocityY(-0.9*masses[i]->velocity.y);
+        {
+            PROFILE_SCOPE("vertices");
+            for(int b = 0; b < bodyMesh.ninstances; b++) {
+                //Update position of the vertices of every body with the simulated positions of the masses,
+                //interpolated to the time of the frame, packed one body after the other
+                const SoftBody& softBox = *world.bodies[b];
+                GLfloat* vertices = bodyMesh.instancePositions(b);
+                for(int i = 0; i < bodyMesh.nverts; i++){
+                    Vector position = softBox.particles.interpolatedPosition(softBox.vertexMass[i], alpha);
+                    vertices[3*i] = position.x;
+                    vertices[3*i+1] = position.y;
+                    vertices[3*i+2] = position.z;
+                }
+                //The normals are only recomputed if the body moved since the last frame
+                bodyNormals.update(b, vertices, 3, bodyMesh.instanceNormals(b), 3);
             }
         }
         
         // ---------- Bind buffers and render objects --------- //
-        myBox.generateVAO();
-        myBox.render();
-        myFloor.generateVAO();
-        myFloor.render();
+        //All bodies are drawn with one call, however many there are
+        {
+            PROFILE_SCOPE("upload");
+            bodyMesh.upload();
+        }
+        {
+            PROFILE_SCOPE("render");
+            PROFILE_GPU_SCOPE(gpuTimer, "GPU bodies");
+            glUseProgram(bodyShader.programID);
+            bodyMesh.render();
+        }
+        {
+            PROFILE_SCOPE("render");
+            PROFILE_GPU_SCOPE(gpuTimer, "GPU floor");
+            glUseProgram(myShader.programID);
+            myFloor.render();
+        }
         
         // Swap buffers, i.e. display the image and prepare for next frame.
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
         // Poll events (read keyboard and mouse input)
         glfwPollEvents();
         // Exit if the ESC key is pressed (and also if the window is closed).
@@ -541,10 +413,40 @@ int main(int argc, char *argv[])
         
         // Do this in the rendering loop to update the uniform variable " time "
         time = (float)glfwGetTime(); // Number of seconds since the program was started
-        glUseProgram(myShader.programID); // Activate the shader to set its variables
-        glUniform1f(location_time, time); // Copy the value to the shader program
+        uniform_time.set(time); // Copy the value to the shader program, which is still in use after the floor
+        
+        //The GPU times of earlier frames that have arrived, and the end of the frame for the profiler
+        PROFILE_GPU_COLLECT(gpuTimer);
+        PROFILE_FRAME();
+    }
+    
+    if(replayFile) {
+        // Report how fast the recording was shown
+        cout << "Replayed frames: " << replayedFrames << " in " << lastTime << " s" << endl;
+    }
+    else {
+        // Report how often the simulation could not keep up with real time
+        cout << "Simulated steps: " << timestep.steps << " in " << timestep.frames << " frames" << endl;
+        cout << "Behind real time in " << timestep.framesBehind << " frames (" << 100.0*timestep.behindRatio() << "%), "
+             << timestep.droppedTime << " s dropped" << endl;
+    }
+    if(recording.isOpen()) {
+        if(recording.close()) {
+            cout << "Recorded frames: " << recording.nFrames << " to " << recordFile << " (" << recording.bytesWritten / 1024 << " KB)" << endl;
+        }
+        else {
+            cout << recordFile << ": " << recording.error << endl;
+        }
     }
     
+#ifdef BOX3D_PROFILE
+    // Report how the time of a frame was spent
+    Profiler::printReport(cout);
+    if(Profiler::writeTrace("box3d_trace.json")) {
+        cout << "Trace written to box3d_trace.json" << endl;
+    }
+#endif
+    
     // Close the OpenGL window and terminate GLFW.
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,277 @@
+/*
+ * box3d_bench - micro-benchmarks of the physics kernels, with Google Benchmark.
+ * Every kernel is measured on lattices of n*n*n masses, from the 8 masses of the box (n = 2) up to a lattice of
+ * about a million springs (n = 50). Kernels that work on springs or masses report their throughput as items per
+ * second, so the sizes can be compared with each other. The particle system, the spring network and the step of a body
+ * are measured in each precision of Precision.hpp, as are the original Mass and SpringDamper classes.
+ *
+ * Usage: box3d_bench [--benchmark_filter=regex] [--benchmark_out=file.json] [any other Google Benchmark option]
+ *   ctest runs every benchmark once for a short time, to catch kernels that crash or hang. Runs saved with
+ *   --benchmark_out before and after a change can be compared with compare.py from Google Benchmark.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Scene.hpp"
+#include "SpringDamper.hpp"
+#include "Mat4.hpp"
+
+//Constants, the same as in the viewer
+static const float SPRING_CONSTANT = 20.0f;
+static const float DAMPER_CONSTANT = 2.0f;
+static const float SPRING_LENGTH = 0.3f;
+static const float WEIGHT = 2.0f;
+static const float DT = 0.0001f;
+
+//Function to add the lattice sizes, from the box to a million springs
+static void latticeSizes(benchmark::internal::Benchmark* b){
+    b->Arg(2)->Arg(5)->Arg(10)->Arg(20)->Arg(50)->Unit(benchmark::kMicrosecond);
+}
+
+//Function to create a lattice of n*n*n masses resting on the floor of the viewer, slightly squashed so the
+//springs have forces and some masses are inside the floor
+template<class Precision>
+static void createLattice(BasicSoftBody<Precision>& body, int n){
+    body.createLattice(n, n, n, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+    for(int i = 0; i < body.particles.nParticles; i++) {
+        body.particles.y[i] *= 0.9f;
+        body.particles.vx[i] = 0.01f * (i % 7);
+    }
+    body.translate(0.0f, 0.45f * SPRING_LENGTH * (n - 1) - 0.95f, 0.0f);
+}
+
+//The spring network of a lattice as objects of the original Mass and SpringDamper classes in one precision, which
+//hold pointers to their masses
+template<class Precision>
+struct ObjectLattice {
+    std::vector<BasicMass<Precision> > masses;
+    std::vector<BasicSpringDamper<Precision> > springs;
+
+    ObjectLattice(int n){
+        SoftBody body;
+        createLattice(body, n);
+        masses.reserve(body.particles.nParticles);
+        for(int i = 0; i < body.particles.nParticles; i++) {
+            masses.push_back(BasicMass<Precision>(WEIGHT));
+            masses.back().setStartPos(body.particles.x[i], body.particles.y[i], body.particles.z[i]);
+            masses.back().setVelocity(body.particles.vx[i], 0.0f, 0.0f);
+        }
+        const SpringNetwork& network = body.springs;
+        springs.reserve(network.nSprings);
+        for(int s = 0; s < network.nSprings; s++) {
+            springs.push_back(BasicSpringDamper<Precision>(&masses[network.mass1[s]], &masses[network.mass2[s]],
+                                                           network.springConstant[s], network.springMax[s], network.springMin[s],
+                                                           network.springLength[s], network.damperConstant[s]));
+        }
+    }
+};
+
+//Positions of the masses of a particle system, to put the masses back where they were before a pass that moves them
+struct SavedPositions {
+    std::vector<float> x, y, z;
+
+    void save(const ParticleSystem& particles){
+        x.assign(particles.x, particles.x + particles.nParticles);
+        y.assign(particles.y, particles.y + particles.nParticles);
+        z.assign(particles.z, particles.z + particles.nParticles);
+    }
+    void restore(ParticleSystem& particles) const {
+        std::copy(x.begin(), x.end(), particles.x);
+        std::copy(y.begin(), y.end(), particles.y);
+        std::copy(z.begin(), z.end(), particles.z);
+    }
+};
+
+// --------- The original classes ---------- //
+
+template<class Precision>
+static void BM_SpringDamperAddSDForce(benchmark::State& state){
+    ObjectLattice<Precision> lattice((int)state.range(0));
+    for(auto _ : state) {
+        for(size_t s = 0; s < lattice.springs.size(); s++) {
+            lattice.springs[s].force = BasicVector<typename Precision::Accumulator>();
+            lattice.springs[s].addSDForce();
+        }
+        benchmark::DoNotOptimize(lattice.springs[0].force);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)lattice.springs.size());
+}
+BENCHMARK_TEMPLATE(BM_SpringDamperAddSDForce, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringDamperAddSDForce, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringDamperAddSDForce, DoublePrecision)->Apply(latticeSizes);
+
+template<class Precision>
+static void BM_SpringDamperSimulateEuler(benchmark::State& state){
+    ObjectLattice<Precision> lattice((int)state.range(0));
+    for(size_t s = 0; s < lattice.springs.size(); s++) {
+        lattice.springs[s].addSDForce();
+    }
+    for(auto _ : state) {
+        for(size_t s = 0; s < lattice.springs.size(); s++) {
+            lattice.springs[s].simulateEuler(DT);
+        }
+        benchmark::DoNotOptimize(lattice.masses[0].position);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)lattice.springs.size());
+}
+BENCHMARK_TEMPLATE(BM_SpringDamperSimulateEuler, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringDamperSimulateEuler, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringDamperSimulateEuler, DoublePrecision)->Apply(latticeSizes);
+
+template<class Precision>
+static void BM_MassSimulateEuler(benchmark::State& state){
+    ObjectLattice<Precision> lattice((int)state.range(0));
+    for(auto _ : state) {
+        for(size_t i = 0; i < lattice.masses.size(); i++) {
+            lattice.masses[i].simulateEuler(DT);
+        }
+        benchmark::DoNotOptimize(lattice.masses[0].position);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)lattice.masses.size());
+}
+BENCHMARK_TEMPLATE(BM_MassSimulateEuler, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_MassSimulateEuler, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_MassSimulateEuler, DoublePrecision)->Apply(latticeSizes);
+
+// --------- The particle system and the spring network ---------- //
+
+template<class Precision>
+static void BM_SpringNetworkAddForces(benchmark::State& state){
+    BasicSoftBody<Precision> body;
+    createLattice(body, (int)state.range(0));
+    for(auto _ : state) {
+        body.particles.clearForces();
+        body.springs.addForces(body.particles);
+        benchmark::DoNotOptimize(body.particles.fx[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)body.springs.nSprings);
+}
+BENCHMARK_TEMPLATE(BM_SpringNetworkAddForces, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringNetworkAddForces, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SpringNetworkAddForces, DoublePrecision)->Apply(latticeSizes);
+
+template<class Precision>
+static void BM_ParticleSystemSimulateEuler(benchmark::State& state){
+    BasicSoftBody<Precision> body;
+    createLattice(body, (int)state.range(0));
+    body.springs.addForces(body.particles);
+    for(auto _ : state) {
+        body.particles.simulateEuler(DT);
+        benchmark::DoNotOptimize(body.particles.x[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)body.particles.nParticles);
+}
+BENCHMARK_TEMPLATE(BM_ParticleSystemSimulateEuler, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_ParticleSystemSimulateEuler, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_ParticleSystemSimulateEuler, DoublePrecision)->Apply(latticeSizes);
+
+template<class Precision>
+static void BM_SoftBodyStep(benchmark::State& state){
+    BasicSoftBody<Precision> body;
+    createLattice(body, (int)state.range(0));
+    for(auto _ : state) {
+        body.step(DT);
+        benchmark::DoNotOptimize(body.particles.x[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)body.springs.nSprings);
+}
+BENCHMARK_TEMPLATE(BM_SoftBodyStep, FloatPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SoftBodyStep, MixedPrecision)->Apply(latticeSizes);
+BENCHMARK_TEMPLATE(BM_SoftBodyStep, DoublePrecision)->Apply(latticeSizes);
+
+// --------- Collisions ---------- //
+
+static void BM_ColliderSetCollide(benchmark::State& state){
+    SoftBody body;
+    createLattice(body, (int)state.range(0));
+    //The floor of the viewer and a sphere and a capsule the lattice rests on
+    ColliderSet colliders;
+    colliders.addBox(0.0f, -1.0f, 0.0f, 20.0f, 0.1f, 20.0f, 0.5f, 0.5f);
+    colliders.addSphere(0.0f, -0.9f, 0.0f, 0.2f, 0.5f, 0.5f);
+    colliders.addCapsule(-1.0f, -0.9f, 1.0f, 1.0f, -0.9f, -1.0f, 0.1f, 0.5f, 0.5f);
+    //Every pass starts from the same positions, so every pass finds the same masses inside
+    SavedPositions saved;
+    saved.save(body.particles);
+    int inside = 0;
+    for(auto _ : state) {
+        state.PauseTiming();
+        saved.restore(body.particles);
+        state.ResumeTiming();
+        inside = colliders.collide(body.particles);
+        benchmark::DoNotOptimize(inside);
+    }
+    state.counters["inside"] = inside;
+    state.SetItemsProcessed(state.iterations() * (int64_t)body.particles.nParticles * (int64_t)colliders.colliders.size());
+}
+BENCHMARK(BM_ColliderSetCollide)->Apply(latticeSizes);
+
+static void BM_SceneCollide(benchmark::State& state){
+    //Bodies of 5*5*5 masses stacked closer than the contact distance
+    Scene world;
+    for(int b = 0; b < state.range(0); b++) {
+        SoftBody& body = world.addBody();
+        createLattice(body, 5);
+    }
+    world.arrange(0.95f * SPRING_LENGTH * 4);
+    world.contactDistance = SPRING_LENGTH;
+    //Every pass starts from the same positions, since the pass pushes the masses in contact apart
+    std::vector<SavedPositions> saved(world.bodies.size());
+    for(size_t b = 0; b < world.bodies.size(); b++) {
+        saved[b].save(world.bodies[b]->particles);
+    }
+    for(auto _ : state) {
+        state.PauseTiming();
+        for(size_t b = 0; b < world.bodies.size(); b++) {
+            saved[b].restore(world.bodies[b]->particles);
+        }
+        state.ResumeTiming();
+        world.collide();
+        benchmark::DoNotOptimize(world.nContacts);
+    }
+    state.counters["contacts"] = world.nContacts;
+    state.SetItemsProcessed(state.iterations() * (int64_t)world.massCount());
+}
+BENCHMARK(BM_SceneCollide)->Arg(2)->Arg(8)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+// --------- Matrices ---------- //
+
+static void BM_Mat4Multiply(benchmark::State& state){
+    Mat4 a = Mat4::trs(0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 1.0f, 2.0f, 3.0f);
+    Mat4 b = Mat4::perspective(1.0f, 1.5f, 0.1f, 100.0f);
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        Mat4 c = a * b;
+        benchmark::DoNotOptimize(c);
+    }
+}
+BENCHMARK(BM_Mat4Multiply);
+
+static void BM_Mat4Trs(benchmark::State& state){
+    float angle = 0.5f;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(angle);
+        Mat4 m = Mat4::trs(0.1f, 0.2f, 0.3f, angle, angle, angle, 1.0f, 1.0f, 1.0f);
+        benchmark::DoNotOptimize(m);
+    }
+}
+BENCHMARK(BM_Mat4Trs);
+
+static void BM_Mat4Transform(benchmark::State& state){
+    int n = (int)state.range(0);
+    Mat4 a = Mat4::perspective(1.0f, 1.5f, 0.1f, 100.0f);
+    std::vector<Mat4> in(n), out(n);
+    for(int i = 0; i < n; i++) {
+        in[i] = Mat4::trs(0.1f * i, 0.0f, 0.0f, 0.01f * i, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+    }
+    for(auto _ : state) {
+        Mat4::transform(a, &in[0], &out[0], n);
+        benchmark::DoNotOptimize(out[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_Mat4Transform)->Arg(1)->Arg(64)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,289 @@
+/*
+ * golden_test - regression tests that run fixed scenes and compare them with recorded golden trajectories.
+ * Every scene is simulated for a fixed number of steps with each SIMD kernel the processor has, and the positions
+ * of all masses are compared with the frames of its .b3dtraj file in tests/golden. A scene fails if any mass is
+ * further than the tolerance of the scene from its recorded position, and the first frame and mass are reported.
+ * The files are recorded with the scalar kernel. After a change that is meant to change the results, run
+ *   golden_test --update
+ * to record them again, and commit the new files with the change.
+ *
+ * Usage: golden_test [--update] [scene ...]
+ *   scene       name of a scene to test, see SCENES below, threads for the determinism test or precision for the
+ *               double precision test. All of them by default
+ *   --update    record the golden files of the scenes instead of testing them
+ *   ctest runs every scene as its own test.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Scene.hpp"
+
+//Constants, the same as in the viewer
+static const float SPRING_CONSTANT = 20.0f;
+static const float DAMPER_CONSTANT = 2.0f;
+static const float SPRING_LENGTH = 0.3f;
+static const float SPRING_MAX = 0.6f;
+static const float SPRING_MIN = 0.03f;
+static const float WEIGHT = 2.0f;
+
+//A scene recorded in a golden file
+struct GoldenScene {
+    const char* name;           // Name of the golden file, without .b3dtraj
+    bool lattice;               // A lattice of 4*4*4 masses instead of the 8-mass box
+    IntegrationMethod method;
+    int nBodies;                // Copies of the body, which collide with each other
+    float dt;
+    int steps;
+    int recordEvery;            // Number of steps between two frames of the golden file
+    float tolerance;            // Largest distance from the recorded position along any axis
+};
+
+//Every scene runs for 1.5 simulated seconds, long enough for the bodies to land on the floor and settle
+static const GoldenScene SCENES[] = {
+    { "box_symplectic",     false, SYMPLECTIC_EULER, 1, 0.0001f, 15000, 300, 1e-4f },
+    { "lattice_verlet",     true,  VELOCITY_VERLET,  1, 0.0001f, 15000, 300, 1e-4f },
+    { "lattice_rk4",        true,  RUNGE_KUTTA_4,    1, 0.0002f, 7500,  150, 1e-4f },
+    { "lattice_implicit",   true,  IMPLICIT_EULER,   1, 0.001f,  1500,  30,  1e-4f },
+    { "lattice_xpbd",       true,  XPBD,             1, 0.001f,  1500,  30,  1e-4f },
+    { "boxes_contact",      false, SYMPLECTIC_EULER, 4, 0.0001f, 15000, 300, 2e-4f },
+};
+
+//Function to build a scene the way box3d_sim does: the bodies are placed in columns above the floor of the viewer
+static void createScene(const GoldenScene& golden, Scene& world){
+    float extent = golden.lattice ? 3 * SPRING_LENGTH : 2.0f * 0.3f;
+    for(int b = 0; b < golden.nBodies; b++) {
+        SoftBody& body = world.addBody();
+        if(golden.lattice) {
+            body.createLattice(4, 4, 4, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+            body.translate(0.0f, 2.0f * SPRING_LENGTH, 0.0f);
+        }
+        else {
+            body.createBox(0.3f, 0.3f, 0.3f, 0.0f, 0.0f, 0.0f, WEIGHT);
+            body.springs.createBox(SPRING_CONSTANT, DAMPER_CONSTANT, SPRING_LENGTH, SPRING_MAX, SPRING_MIN,
+                                   SPRING_CONSTANT, DAMPER_CONSTANT);
+        }
+        body.method = golden.method;
+        //Tilt the bodies so they land on an edge and roll, which exercises friction and the contacts
+        for(int i = 0; i < body.particles.nParticles; i++) {
+            body.particles.vx[i] = 0.5f + 0.1f * b;
+            body.particles.vz[i] = 0.2f * body.particles.x[i];
+        }
+    }
+    float halfWidth = world.arrange(1.1f * extent);
+    world.contactDistance = golden.nBodies > 1 ? SPRING_LENGTH : 0.0f;
+    world.colliders.addBox(0.0f, -1.0f, 0.0f, halfWidth + 2.0f, 0.1f, halfWidth + 2.0f, 0.5f, 0.5f);
+}
+
+//Function to return the golden file of a scene
+static std::string goldenFile(const GoldenScene& golden){
+    return std::string(BOX3D_GOLDEN_DIR) + "/" + golden.name + ".b3dtraj";
+}
+
+//Function to simulate a scene and record it as its golden file, with the scalar kernel
+static bool recordGolden(const GoldenScene& golden){
+    ParticleSystem::setSimdLevel(SIMD_SCALAR);
+    Scene world;
+    createScene(golden, world);
+    TrajectoryWriter writer;
+    if(!writer.open(goldenFile(golden).c_str(), world.massCount(), golden.recordEvery * golden.dt)) {
+        printf("%s: %s\n", goldenFile(golden).c_str(), writer.error.c_str());
+        return false;
+    }
+    world.record(writer);
+    for(int s = 1; s <= golden.steps; s++) {
+        world.step(golden.dt);
+        if(s % golden.recordEvery == 0) {
+            world.record(writer);
+        }
+    }
+    if(!writer.close()) {
+        printf("%s: %s\n", goldenFile(golden).c_str(), writer.error.c_str());
+        return false;
+    }
+    printf("Recorded %s: %ld frames\n", goldenFile(golden).c_str(), writer.nFrames);
+    return true;
+}
+
+//Function to simulate a scene with the current SIMD kernel and compare every recorded frame. Returns false and
+//reports the first mass too far from its recorded position if there is one
+static bool testGolden(const GoldenScene& golden){
+    const char* kernel = ParticleSystem::simdLevelName(ParticleSystem::getSimdLevel());
+    TrajectoryReader reader;
+    if(!reader.open(goldenFile(golden).c_str())) {
+        printf("FAIL %s (%s): %s: %s\n", golden.name, kernel, goldenFile(golden).c_str(), reader.error.c_str());
+        return false;
+    }
+    Scene world;
+    createScene(golden, world);
+    int n = world.massCount();
+    if(reader.nMasses != n || reader.nFrames != golden.steps / golden.recordEvery + 1) {
+        printf("FAIL %s (%s): the golden file was recorded from another scene\n", golden.name, kernel);
+        return false;
+    }
+
+    std::vector<float> x(n), y(n), z(n);
+    float maxError = 0.0f;
+    for(int frame = 0; frame < reader.nFrames; frame++) {
+        for(int s = 0; frame > 0 && s < golden.recordEvery; s++) {
+            world.step(golden.dt);
+        }
+        if(!reader.readFrame(frame, &x[0], &y[0], &z[0])) {
+            printf("FAIL %s (%s): %s\n", golden.name, kernel, reader.error.c_str());
+            return false;
+        }
+        int offset = 0;
+        for(size_t b = 0; b < world.bodies.size(); b++) {
+            const ParticleSystem& particles = world.bodies[b]->particles;
+            for(int i = 0; i < particles.nParticles; i++) {
+                int m = offset + i;
+                float dx = fabsf(particles.x[i] - x[m]);
+                float dy = fabsf(particles.y[i] - y[m]);
+                float dz = fabsf(particles.z[i] - z[m]);
+                //Written so that a position that is not a number fails too
+                if(!(dx <= golden.tolerance && dy <= golden.tolerance && dz <= golden.tolerance)) {
+                    printf("FAIL %s (%s): frame %d (step %d), mass %d at (%g, %g, %g) instead of (%g, %g, %g)\n",
+                           golden.name, kernel, frame, frame * golden.recordEvery, m,
+                           particles.x[i], particles.y[i], particles.z[i], x[m], y[m], z[m]);
+                    return false;
+                }
+                maxError = fmaxf(maxError, fmaxf(dx, fmaxf(dy, dz)));
+            }
+            offset += particles.nParticles;
+        }
+    }
+    printf("ok   %s (%s): %d frames, largest error %.2e\n", golden.name, kernel, reader.nFrames, maxError);
+    return true;
+}
+
+//The springs are evaluated in colours, so the forces are added in the same order on any number of threads and
+//the results are identical to the last bit
+static bool testThreads(){
+    SoftBody single, threaded;
+    ThreadPool pool(4);
+    single.createLattice(10, 10, 10, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+    threaded.createLattice(10, 10, 10, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+    threaded.threadPool = &pool;
+    for(int s = 0; s < 200; s++) {
+        single.step(0.0001f);
+        threaded.step(0.0001f);
+    }
+    for(int i = 0; i < single.particles.nParticles; i++) {
+        if(single.particles.x[i] != threaded.particles.x[i] || single.particles.y[i] != threaded.particles.y[i]
+           || single.particles.z[i] != threaded.particles.z[i]) {
+            printf("FAIL threads: mass %d differs on %d threads\n", i, pool.size());
+            return false;
+        }
+    }
+    printf("ok   threads: identical on 1 and %d threads\n", pool.size());
+    return true;
+}
+
+//The springs only exert forces between the masses, so the centre of mass of a lattice in free fall follows the
+//symplectic Euler steps of a single mass exactly. In double precision it must stay within rounding errors of that,
+//and the masses must stay close to the float simulation of the same lattice
+static bool testPrecision(){
+    const int steps = 2000;
+    const float dt = 0.0001f;
+    SoftBody single;
+    BasicSoftBody<DoublePrecision> body;
+    single.createLattice(6, 6, 6, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+    body.createLattice(6, 6, 6, SPRING_LENGTH, WEIGHT, SPRING_CONSTANT, DAMPER_CONSTANT);
+    int n = body.particles.nParticles;
+    double start = 0.0;
+    for(int i = 0; i < n; i++) {
+        start += body.particles.y[i];
+    }
+    for(int s = 0; s < steps; s++) {
+        single.step(dt);
+        body.step(dt);
+    }
+    double centre = 0.0, largest = 0.0;
+    for(int i = 0; i < n; i++) {
+        centre += body.particles.y[i];
+        double dx = body.particles.x[i] - single.particles.x[i];
+        double dy = body.particles.y[i] - single.particles.y[i];
+        double dz = body.particles.z[i] - single.particles.z[i];
+        largest = std::max(largest, std::sqrt(dx*dx + dy*dy + dz*dz));
+    }
+    double exact = start / n - GRAVITY * dt * dt * ((double)steps * (steps + 1) / 2);
+    double error = std::fabs(centre / n - exact);
+    if(error > 1e-9 || largest > 1e-3) {
+        printf("FAIL precision: centre of mass %.3e from the exact fall, %.3e from float\n", error, largest);
+        return false;
+    }
+    printf("ok   precision: double centre of mass %.3e from the exact fall, %.3e from float\n", error, largest);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const int nScenes = (int)(sizeof(SCENES) / sizeof(SCENES[0]));
+    bool update = false;
+    std::vector<bool> selected(nScenes, false);
+    bool threads = false;
+    bool precision = false;
+    bool any = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--update") == 0) {
+            update = true;
+            continue;
+        }
+        any = true;
+        if(strcmp(argv[i], "threads") == 0) {
+            threads = true;
+            continue;
+        }
+        if(strcmp(argv[i], "precision") == 0) {
+            precision = true;
+            continue;
+        }
+        int s = 0;
+        while(s < nScenes && strcmp(argv[i], SCENES[s].name) != 0) {
+            s++;
+        }
+        if(s == nScenes) {
+            fprintf(stderr, "Usage: golden_test [--update] [threads|precision");
+            for(int t = 0; t < nScenes; t++) {
+                fprintf(stderr, "|%s", SCENES[t].name);
+            }
+            fprintf(stderr, " ...]\n");
+            return 1;
+        }
+        selected[s] = true;
+    }
+    if(!any) {
+        selected.assign(nScenes, true);
+        threads = !update;
+        precision = !update;
+    }
+
+    //Every scene is tested with every kernel up to the best one the processor has
+    SimdLevel best = ParticleSystem::getSimdLevel();
+    bool ok = true;
+    for(int s = 0; s < nScenes; s++) {
+        if(!selected[s]) {
+            continue;
+        }
+        if(update) {
+            ok = recordGolden(SCENES[s]) && ok;
+            continue;
+        }
+        for(int level = SIMD_SCALAR; level <= best; level++) {
+            ParticleSystem::setSimdLevel((SimdLevel)level);
+            ok = testGolden(SCENES[s]) && ok;
+        }
+    }
+    ParticleSystem::setSimdLevel(best);
+    if(threads) {
+        ok = testThreads() && ok;
+    }
+    if(precision) {
+        ok = testPrecision() && ok;
+    }
+    return ok ? 0 : 1;
+}